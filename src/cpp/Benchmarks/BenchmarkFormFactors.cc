@@ -0,0 +1,172 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+// Compares the rate, in pairs of points per second, at which form factors are
+// summed over all pairs of points by the tiled FormFactorKernel and by a
+// reference loop over the flat pair index, as ResultsCompiler computed them
+// before the kernel was added.  Points are uniform in the unit ball and the
+// q values are those used for form factors of an object of radius 1.  Both
+// run on a single thread.  The largest difference between the two sets of
+// form factors is also printed.
+//
+// Usage: benchmark-form-factors [numPoints]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+#include "../Timer.h"
+#include "../FormFactorKernel.h"
+
+#include "../Geometry/Sphere.h"
+#include "../Geometry/Vector3.h"
+
+#include "../RandomNumber/Philox.h"
+
+#include "../SpherePoint/RandomBallPointRejection.h"
+
+// ================================================================
+
+using BigUInt = FormFactorKernel::BigUInt;
+
+using RandomBallPointGenerator =
+  RandomBallPointRejection<double, Philox>;
+
+/// Returns sin(x)/x, using its Taylor expansion for small x, as in
+/// ResultsCompiler.
+///
+double
+computeSincReference(double x) {
+
+  if (x < 0.001) {
+    return 1. - pow(x, 2)/6.;
+  }
+  else {
+    return sin(x)/x;
+  }
+}
+
+/// Sums sin(qr)/(qr) for each q over all pairs of points, recovering each
+/// pair from its flat index.
+///
+void
+computeSumsReference(std::vector<Vector3<double> > const & points,
+		     std::vector<double> const & qs,
+		     std::vector<double> * sums) {
+
+  BigUInt numPairs = (points.size() * points.size() - points.size()) / 2;
+
+  for (BigUInt pairIndex = 0; pairIndex < numPairs; ++pairIndex) {
+
+    BigUInt j = round(sqrt(2*pairIndex + 1)) - 1;
+    BigUInt i = pairIndex - (j*j + j)/2;
+
+    ++j;
+
+    double distance = (points.at(i) - points.at(j)).getMagnitude();
+
+    for (std::size_t qNum = 0; qNum < qs.size(); ++qNum) {
+      sums->at(qNum) += computeSincReference(qs.at(qNum) * distance);
+    }
+  }
+}
+
+int
+main(int argc, char **argv) {
+
+  int numPoints = (argc > 1) ? atoi(argv[1]) : 2000;
+
+  const int numQs = 81;
+
+  Sphere<double> ball(Vector3<double>(0, 0, 0), 1);
+
+  std::vector<Vector3<double> > points(numPoints);
+
+  Philox rng(0, 1, 0);
+
+  RandomBallPointGenerator::generate(&rng, ball, numPoints, points.data());
+
+  std::vector<double> qs(numQs);
+
+  for (int qNum = 0; qNum < numQs; ++qNum) {
+    qs[qNum] = 0.01 * pow(10000, (double)qNum/(numQs - 1)) / ball.getRadius();
+  }
+
+  BigUInt numPairs = ((BigUInt)numPoints * numPoints - numPoints) / 2;
+
+  std::vector<double> referenceSums(numQs, 0);
+
+  Timer referenceTimer;
+  referenceTimer.start();
+
+  computeSumsReference(points, qs, &referenceSums);
+
+  referenceTimer.stop();
+
+  std::vector<double> tiledSums(numQs, 0);
+
+  Timer tiledTimer;
+  tiledTimer.start();
+
+  FormFactorKernel kernel(points, 1, qs);
+
+  kernel.addTiles(0, kernel.getNumTiles(), &tiledSums);
+
+  tiledTimer.stop();
+
+  double maxDifference = 0;
+
+  for (int qNum = 0; qNum < numQs; ++qNum) {
+    maxDifference = 
+      std::max(maxDifference, 
+	       fabs(tiledSums[qNum] - referenceSums[qNum]) / numPairs);
+  }
+
+  std::cout << "Points: " << numPoints << std::endl
+	    << "Pairs: " << numPairs << std::endl
+	    << "q values: " << numQs << std::endl
+	    << std::endl
+	    << std::setw(10) << "Kernel"
+	    << std::setw(16) << "Time (s)"
+	    << std::setw(16) << "Pairs/s"
+	    << std::endl
+	    << std::setw(10) << "Reference"
+	    << std::setw(16) << referenceTimer.getTime()
+	    << std::setw(16) << numPairs / referenceTimer.getTime()
+	    << std::endl
+	    << std::setw(10) << "Tiled"
+	    << std::setw(16) << tiledTimer.getTime()
+	    << std::setw(16) << numPairs / tiledTimer.getTime()
+	    << std::endl
+	    << std::endl
+	    << "Speedup: " 
+	    << referenceTimer.getTime() / tiledTimer.getTime() << std::endl
+	    << "Max form factor difference: " << maxDifference << std::endl;
+
+  return 0;
+}
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// mode: c++
+// End:
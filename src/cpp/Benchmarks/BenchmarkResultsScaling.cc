@@ -0,0 +1,170 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+// Measures the rate at which results are recorded into ResultsZeno and
+// ResultsInterior as the number of threads doubles from 1 up to the given
+// maximum.  Each thread records the same number of hits and misses, so with no
+// contention between threads the total rate grows linearly with the number of
+// threads.  Results are accumulated with running variances, or with
+// compensated sums if the third argument is nonzero.
+//
+// Usage: benchmark-results-scaling [maxNumThreads] [numRecordsPerThread]
+//                                  [compensatedSums]
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cstdlib>
+
+#include "../Timer.h"
+#include "../ThreadPool.h"
+#include "../ResultsZeno.h"
+#include "../ResultsInterior.h"
+
+#include "../Geometry/Sphere.h"
+#include "../Geometry/Vector3.h"
+
+#include "../RandomNumber/Philox.h"
+
+// ================================================================
+
+/// Records the given number of alternating hits and misses per thread into
+/// each results class using the given number of threads and accumulation
+/// mode, and prints the total and per-thread rates in records per second.
+///
+void
+benchmark(int numThreads,
+	  int numRecordsPerThread,
+	  bool compensatedSums) {
+
+  Sphere<double> boundingSphere(Vector3<double>(0, 0, 0), 1);
+
+  ResultsZeno resultsZeno(boundingSphere, 
+			  numThreads, 
+			  false, 
+			  false, 
+			  false, 
+			  compensatedSums,
+			  "");
+
+  ResultsInterior resultsInterior(numThreads, 
+				  boundingSphere.getVolume(), 
+				  false, 
+				  0,
+				  false,
+				  compensatedSums,
+				  "");
+
+  ThreadPool threadPool(numThreads);
+
+  Timer zenoTimer;
+  zenoTimer.start();
+
+  threadPool.run([&](int threadNum) {
+      Philox rng(threadNum, numThreads, 0);
+
+      Vector3<double> startPoint(0, 0, 1);
+      Vector3<double> endPoint(0.5, 0.5, 0.5);
+      Vector3<double> normal(0, 0, 1);
+
+      for (int recordNum = 0; recordNum < numRecordsPerThread; recordNum++) {
+	if (recordNum % 2 == 0) {
+	  resultsZeno.recordHit(threadNum, startPoint, endPoint, normal, &rng);
+	}
+	else {
+	  resultsZeno.recordMiss(threadNum);
+	}
+      }
+    });
+
+  zenoTimer.stop();
+
+  Timer interiorTimer;
+  interiorTimer.start();
+
+  threadPool.run([&](int threadNum) {
+      Philox rng(threadNum, numThreads, 0);
+
+      Vector3<double> point(0.25, 0.5, 0.75);
+
+      for (int recordNum = 0; recordNum < numRecordsPerThread; recordNum++) {
+	if (recordNum % 2 == 0) {
+	  resultsInterior.recordHit(threadNum, point, 1, false, &rng);
+	}
+	else {
+	  resultsInterior.recordMiss(threadNum);
+	}
+      }
+    });
+
+  interiorTimer.stop();
+
+  //reduce so the recorded values are used and checked
+  resultsZeno.reduce();
+  resultsInterior.reduce();
+
+  double numRecords = (double)numRecordsPerThread * numThreads;
+
+  if (resultsZeno.getNumWalks() != numRecords ||
+      resultsInterior.getNumSamples() != numRecords) {
+
+    std::cerr << "Error: wrong number of records" << std::endl;
+    exit(1);
+  }
+
+  double zenoRate     = numRecords / zenoTimer.getTime();
+  double interiorRate = numRecords / interiorTimer.getTime();
+
+  std::cout << std::setw(8)  << numThreads
+	    << std::setw(18) << zenoRate
+	    << std::setw(18) << zenoRate / numThreads
+	    << std::setw(18) << interiorRate
+	    << std::setw(18) << interiorRate / numThreads
+	    << std::endl;
+}
+
+int
+main(int argc, char **argv) {
+
+  int maxNumThreads       = (argc > 1) ? atoi(argv[1]) : 128;
+  int numRecordsPerThread = (argc > 2) ? atoi(argv[2]) : 1000000;
+  bool compensatedSums    = (argc > 3) ? (atoi(argv[3]) != 0) : false;
+
+  std::cout << "Records per thread: " << numRecordsPerThread << std::endl
+	    << "Compensated sums: " << (compensatedSums ? "yes" : "no") 
+	    << std::endl
+	    << std::endl
+	    << std::setw(8)  << "Threads"
+	    << std::setw(18) << "Zeno (rec/s)"
+	    << std::setw(18) << "per thread"
+	    << std::setw(18) << "Interior (rec/s)"
+	    << std::setw(18) << "per thread"
+	    << std::endl;
+
+  for (int numThreads = 1; numThreads <= maxNumThreads; numThreads *= 2) {
+    benchmark(numThreads, numRecordsPerThread, compensatedSums);
+  }
+
+  return 0;
+}
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// End:
@@ -0,0 +1,198 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+// Compares the build and nearest-surface-point query times of the sphere
+// center models as the number of distinct sphere radii grows.
+//
+// Usage: benchmark-sphere-center-models [numSpheres] [numQueries] [numThreads]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+
+#include "../Timer.h"
+
+#include "../Geometry/Sphere.h"
+#include "../Geometry/Vector3.h"
+
+#include "../NearestSurfacePoint/PointFromSphereCenters.h"
+
+#include "../SphereCenterModel/NanoFLANNSort.h"
+#include "../SphereCenterModel/SphereBVH.h"
+
+// ================================================================
+
+/// Generates spheres with centers uniformly distributed in a cube and radii
+/// chosen from the given number of distinct values in [0.5, 1.5].  The cube is
+/// sized so the total sphere volume is about half the cube volume.
+///
+void generateSpheres(int numSpheres,
+		     int numRadii,
+		     std::mt19937_64 * generator,
+		     std::vector<Sphere<double> > * spheres,
+		     double * cubeSize) {
+
+  *cubeSize = cbrt(2 * numSpheres * 4./3. * M_PI);
+
+  std::uniform_real_distribution<double> coordDistribution(0, *cubeSize);
+  std::uniform_int_distribution<int> radiusDistribution(0, numRadii - 1);
+
+  spheres->clear();
+  spheres->reserve(numSpheres);
+
+  for (int sphereNum = 0; sphereNum < numSpheres; sphereNum++) {
+    Vector3<double> center(coordDistribution(*generator),
+			   coordDistribution(*generator),
+			   coordDistribution(*generator));
+
+    double radius = 0.5;
+
+    if (numRadii > 1) {
+      radius += radiusDistribution(*generator) / (double)(numRadii - 1);
+    }
+
+    spheres->push_back(Sphere<double>(center, radius));
+  }
+}
+
+/// Builds the given sphere center model using the given number of threads and
+/// runs nearest surface point queries against it.  Returns the build and query
+/// times and the distances found.
+///
+template <class SphereCenterModel>
+void benchmarkModel(std::vector<Sphere<double> > const & spheres,
+		    std::vector<Vector3<double> > const & queryPoints,
+		    int numThreads,
+		    double * buildTime,
+		    double * queryTime,
+		    std::vector<double> * distances) {
+
+  Timer buildTimer;
+  buildTimer.start();
+
+  SphereCenterModel model;
+  model.preprocess(spheres, 0, numThreads);
+
+  buildTimer.stop();
+
+  PointFromSphereCenters<SphereCenterModel> finder(model);
+
+  distances->resize(queryPoints.size());
+
+  Timer queryTimer;
+  queryTimer.start();
+
+  for (unsigned int queryNum = 0; queryNum < queryPoints.size(); queryNum++) {
+    Vector3<double> normal;
+
+    finder.findNearestPoint(queryPoints[queryNum], 0,
+			    &normal, &(distances->at(queryNum)));
+  }
+
+  queryTimer.stop();
+
+  *buildTime = buildTimer.getTime();
+  *queryTime = queryTimer.getTime();
+}
+
+int
+main(int argc, char **argv) {
+
+  int numSpheres = (argc > 1) ? atoi(argv[1]) : 100000;
+  int numQueries = (argc > 2) ? atoi(argv[2]) : 200000;
+  int numThreads = (argc > 3) ? atoi(argv[3]) : 
+    std::max(1u, std::thread::hardware_concurrency());
+
+  const int numRadiiValues[] = {1, 4, 16, 64, 256, 1024};
+
+  std::mt19937_64 generator(0);
+
+  std::cout << "Spheres: " << numSpheres << std::endl
+	    << "Queries: " << numQueries << std::endl
+	    << "Build threads: " << numThreads << std::endl
+	    << std::endl
+	    << std::setw(8)  << "Radii"
+	    << std::setw(18) << "NanoFLANN build"
+	    << std::setw(18) << "NanoFLANN query"
+	    << std::setw(18) << "BVH build"
+	    << std::setw(18) << "BVH query"
+	    << std::setw(14) << "Speedup"
+	    << std::setw(14) << "Max diff"
+	    << std::endl;
+
+  for (int numRadii : numRadiiValues) {
+    std::vector<Sphere<double> > spheres;
+    double cubeSize = 0;
+
+    generateSpheres(numSpheres, numRadii, &generator, &spheres, &cubeSize);
+
+    std::uniform_real_distribution<double> coordDistribution(0, cubeSize);
+
+    std::vector<Vector3<double> > queryPoints;
+    queryPoints.reserve(numQueries);
+
+    for (int queryNum = 0; queryNum < numQueries; queryNum++) {
+      queryPoints.push_back(Vector3<double>(coordDistribution(generator),
+					    coordDistribution(generator),
+					    coordDistribution(generator)));
+    }
+
+    double nanoFLANNBuildTime = 0, nanoFLANNQueryTime = 0;
+    double bvhBuildTime = 0, bvhQueryTime = 0;
+
+    std::vector<double> nanoFLANNDistances, bvhDistances;
+
+    benchmarkModel<NanoFLANNSort>(spheres, queryPoints, numThreads,
+				  &nanoFLANNBuildTime, &nanoFLANNQueryTime,
+				  &nanoFLANNDistances);
+
+    benchmarkModel<SphereBVH>(spheres, queryPoints, numThreads,
+			      &bvhBuildTime, &bvhQueryTime,
+			      &bvhDistances);
+
+    double maxDiff = 0;
+
+    for (int queryNum = 0; queryNum < numQueries; queryNum++) {
+      maxDiff = std::max(maxDiff,
+			 std::abs(nanoFLANNDistances[queryNum] -
+				  bvhDistances[queryNum]));
+    }
+
+    std::cout << std::setw(8)  << numRadii
+	      << std::setw(18) << nanoFLANNBuildTime
+	      << std::setw(18) << nanoFLANNQueryTime
+	      << std::setw(18) << bvhBuildTime
+	      << std::setw(18) << bvhQueryTime
+	      << std::setw(14) << nanoFLANNQueryTime / bvhQueryTime
+	      << std::setw(14) << maxDiff
+	      << std::endl;
+  }
+
+  return 0;
+}
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// End:
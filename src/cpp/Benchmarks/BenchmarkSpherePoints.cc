@@ -0,0 +1,197 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+// Compares the rate at which points are generated one at a time and in bulk
+// by the uniform sphere, uniform ball, and biased sphere point generators.
+//
+// Usage: benchmark-sphere-points [numPoints] [batchSize]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+
+#include "../Timer.h"
+
+#include "../Geometry/Sphere.h"
+#include "../Geometry/Vector3.h"
+
+#include "../RandomNumber/Philox.h"
+
+#include "../SpherePoint/RandomSpherePointMarsaglia.h"
+#include "../SpherePoint/BiasedSpherePointDirect.h"
+#include "../SpherePoint/RandomBallPointRejection.h"
+
+// ================================================================
+
+using RandomSpherePointGenerator = 
+  RandomSpherePointMarsaglia<double, Philox>;
+
+using BiasedSpherePointGenerator = 
+  BiasedSpherePointDirect<double, Philox, RandomSpherePointGenerator>;
+
+using RandomBallPointGenerator =
+  RandomBallPointRejection<double, Philox>;
+
+/// Prints the rates, in points per second, for generating the given number of
+/// points one at a time and in bulk in the given times.  Also prints the mean
+/// of the points so the work cannot be optimized away.
+///
+void printRates(std::string const & name,
+		int numPoints,
+		double singleTime,
+		double bulkTime,
+		Vector3<double> const & pointSum) {
+
+  std::cout << std::setw(10) << name
+	    << std::setw(16) << numPoints / singleTime
+	    << std::setw(16) << numPoints / bulkTime
+	    << std::setw(10) << singleTime / bulkTime
+	    << "   " << pointSum / (double)(2 * numPoints)
+	    << std::endl;
+}
+
+int
+main(int argc, char **argv) {
+
+  int numPoints = (argc > 1) ? atoi(argv[1]) : 10000000;
+  int batchSize = (argc > 2) ? atoi(argv[2]) : 64;
+
+  Sphere<double> sphere(Vector3<double>(1, 2, 3), 2);
+
+  Vector3<double> distributionCenter(4, 5, 6);
+
+  const double alpha = 0.5;
+
+  std::vector<Vector3<double> > points(batchSize);
+
+  std::cout << "Points: " << numPoints << std::endl
+	    << "Batch size: " << batchSize << std::endl
+	    << std::endl
+	    << std::setw(10) << "Generator"
+	    << std::setw(16) << "Single (pts/s)"
+	    << std::setw(16) << "Bulk (pts/s)"
+	    << std::setw(10) << "Speedup"
+	    << "   Mean point"
+	    << std::endl;
+
+  {
+    Philox rng(0, 1, 0);
+    Vector3<double> pointSum(0, 0, 0);
+
+    Timer singleTimer;
+    singleTimer.start();
+
+    for (int pointNum = 0; pointNum < numPoints; pointNum++) {
+      pointSum += RandomSpherePointGenerator::generate(&rng, sphere);
+    }
+
+    singleTimer.stop();
+
+    Timer bulkTimer;
+    bulkTimer.start();
+
+    for (int pointNum = 0; pointNum < numPoints; pointNum += batchSize) {
+      RandomSpherePointGenerator::generate(&rng, sphere, 
+					   batchSize, points.data());
+
+      for (int i = 0; i < batchSize; i++) {
+	pointSum += points[i];
+      }
+    }
+
+    bulkTimer.stop();
+
+    printRates("Sphere", numPoints, 
+	       singleTimer.getTime(), bulkTimer.getTime(), pointSum);
+  }
+
+  {
+    Philox rng(0, 1, 0);
+    Vector3<double> pointSum(0, 0, 0);
+
+    Timer singleTimer;
+    singleTimer.start();
+
+    for (int pointNum = 0; pointNum < numPoints; pointNum++) {
+      pointSum += RandomBallPointGenerator::generate(&rng, sphere);
+    }
+
+    singleTimer.stop();
+
+    Timer bulkTimer;
+    bulkTimer.start();
+
+    for (int pointNum = 0; pointNum < numPoints; pointNum += batchSize) {
+      RandomBallPointGenerator::generate(&rng, sphere, 
+					 batchSize, points.data());
+
+      for (int i = 0; i < batchSize; i++) {
+	pointSum += points[i];
+      }
+    }
+
+    bulkTimer.stop();
+
+    printRates("Ball", numPoints, 
+	       singleTimer.getTime(), bulkTimer.getTime(), pointSum);
+  }
+
+  {
+    Philox rng(0, 1, 0);
+    Vector3<double> pointSum(0, 0, 0);
+
+    Timer singleTimer;
+    singleTimer.start();
+
+    for (int pointNum = 0; pointNum < numPoints; pointNum++) {
+      pointSum += BiasedSpherePointGenerator::generate(&rng, sphere, 
+						       distributionCenter,
+						       alpha);
+    }
+
+    singleTimer.stop();
+
+    Timer bulkTimer;
+    bulkTimer.start();
+
+    for (int pointNum = 0; pointNum < numPoints; pointNum += batchSize) {
+      BiasedSpherePointGenerator::generate(&rng, sphere, 
+					   distributionCenter, alpha,
+					   batchSize, points.data());
+
+      for (int i = 0; i < batchSize; i++) {
+	pointSum += points[i];
+      }
+    }
+
+    bulkTimer.stop();
+
+    printRates("Biased", numPoints, 
+	       singleTimer.getTime(), bulkTimer.getTime(), pointSum);
+  }
+
+  return 0;
+}
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// End:
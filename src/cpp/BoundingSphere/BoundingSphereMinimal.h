@@ -0,0 +1,269 @@
+// ================================================================
+// 
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+// 
+// ================================================================
+
+#ifndef BOUNDING_SPHERE_MINIMAL_H
+#define BOUNDING_SPHERE_MINIMAL_H
+
+#include <vector>
+#include <thread>
+
+#include "../Geometry/Vector3.h"
+#include "../Geometry/Sphere.h"
+
+/// Generates a nearly minimal bounding sphere around the given object.
+///
+/// Starts from a pair of far-apart spheres found as in Ritter's algorithm and
+/// grows a small core set of extreme spheres.  The minimal bounding sphere of
+/// the core set is approximated with Badoiu-Clarkson iterations, and the
+/// sphere of the object farthest outside it is added to the core set, until
+/// no sphere lies more than a small tolerance outside.  The radius of the
+/// result is always computed from all spheres, so the result encloses the
+/// object even though it is only approximately minimal.  The scans over all
+/// spheres are split across threads.
+///
+template <class T>
+class BoundingSphereMinimal {
+ public:
+  static Sphere<T> generate(std::vector<Sphere<T> > const & spheres,
+			    int numThreads);
+
+ private:
+  /// Stop adding to the core set once no sphere extends farther than this
+  /// fraction of the radius outside the bounding sphere of the core set.
+  ///
+  static constexpr T tolerance = 1e-3;
+
+  static const int maxCoreSetSize = 100;
+
+  static const int numCoreSetIterations = 1000;
+
+  static int findFarthest(std::vector<Sphere<T> > const & spheres,
+			  Vector3<T> const & point,
+			  int numThreads,
+			  T * farthestDistance);
+
+  static void findFarthestThread(std::vector<Sphere<T> > const & spheres,
+				 Vector3<T> const & point,
+				 int threadNum, int numThreads,
+				 int * farthestSphereNum,
+				 T * farthestDistance);
+
+  static Vector3<T> 
+  approximateCoreSetCenter(std::vector<Sphere<T> > const & coreSet,
+			   Vector3<T> const & initialCenter);
+
+  static T getFarthestDistance(Sphere<T> const & sphere,
+			       Vector3<T> const & point);
+};
+
+/// Returns the bounding sphere for the given set of spheres, using the given
+/// number of threads.
+///
+template <class T>
+Sphere<T> 
+BoundingSphereMinimal<T>::generate(std::vector<Sphere<T> > const & spheres,
+				   int numThreads) {
+
+  if (spheres.empty()) {
+    return Sphere<T>();
+  }
+
+  T distance = 0;
+
+  int firstSphereNum = 
+    findFarthest(spheres, spheres.front().getCenter(), numThreads, &distance);
+
+  int secondSphereNum = 
+    findFarthest(spheres, spheres.at(firstSphereNum).getCenter(), numThreads,
+		 &distance);
+
+  std::vector<Sphere<T> > coreSet;
+
+  coreSet.push_back(spheres.at(firstSphereNum));
+  coreSet.push_back(spheres.at(secondSphereNum));
+
+  Vector3<T> center = (coreSet.at(0).getCenter() + 
+		       coreSet.at(1).getCenter()) / 2;
+
+  T coreSetRadius = 0;
+
+  T radius = 0;
+
+  for (;;) {
+    center = approximateCoreSetCenter(coreSet, center);
+
+    coreSetRadius = 0;
+
+    for (Sphere<T> const & sphere : coreSet) {
+      coreSetRadius = std::max(coreSetRadius, 
+			       getFarthestDistance(sphere, center));
+    }
+
+    int farthestSphereNum = 
+      findFarthest(spheres, center, numThreads, &radius);
+
+    if (radius <= coreSetRadius * (1 + tolerance) ||
+	(int)coreSet.size() >= maxCoreSetSize) {
+
+      break;
+    }
+
+    coreSet.push_back(spheres.at(farthestSphereNum));
+  }
+
+  return Sphere<T>(center, radius);
+}
+
+/// Returns the index of the sphere with the point farthest from the given
+/// point, and sets the given distance to the distance to that point.
+///
+template <class T>
+int
+BoundingSphereMinimal<T>::findFarthest(std::vector<Sphere<T> > const & spheres,
+				       Vector3<T> const & point,
+				       int numThreads,
+				       T * farthestDistance) {
+
+  std::vector<int> threadSphereNums(numThreads, 0);
+  std::vector<T>   threadDistances(numThreads, 0);
+
+  std::thread * * threads = new std::thread *[numThreads];
+
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    threads[threadNum] = 
+      new std::thread(findFarthestThread,
+		      std::cref(spheres), std::cref(point),
+		      threadNum, numThreads,
+		      &threadSphereNums[threadNum],
+		      &threadDistances[threadNum]);
+  }
+
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    threads[threadNum]->join();
+
+    delete threads[threadNum];
+  }
+
+  delete [] threads;
+
+  int farthestSphereNum = 0;
+
+  *farthestDistance = 0;
+
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    if (threadDistances[threadNum] > *farthestDistance) {
+      farthestSphereNum = threadSphereNums[threadNum];
+      *farthestDistance = threadDistances[threadNum];
+    }
+  }
+
+  return farthestSphereNum;
+}
+
+template <class T>
+void
+BoundingSphereMinimal<T>::
+findFarthestThread(std::vector<Sphere<T> > const & spheres,
+		   Vector3<T> const & point,
+		   int threadNum, int numThreads,
+		   int * farthestSphereNum,
+		   T * farthestDistance) {
+
+  unsigned int beginSphereNum = 
+    (unsigned long long)spheres.size() * threadNum / numThreads;
+
+  unsigned int endSphereNum = 
+    (unsigned long long)spheres.size() * (threadNum + 1) / numThreads;
+
+  *farthestSphereNum = beginSphereNum;
+  *farthestDistance  = 0;
+
+  for (unsigned int sphereNum = beginSphereNum; 
+       sphereNum < endSphereNum; 
+       sphereNum++) {
+
+    T distance = getFarthestDistance(spheres[sphereNum], point);
+
+    if (distance > *farthestDistance) {
+      *farthestSphereNum = sphereNum;
+      *farthestDistance  = distance;
+    }
+  }
+}
+
+/// Returns the approximate center of the minimal bounding sphere of the given
+/// core set by repeatedly stepping from the current center toward the
+/// farthest point of the core set with shrinking step sizes.
+///
+template <class T>
+Vector3<T> 
+BoundingSphereMinimal<T>::
+approximateCoreSetCenter(std::vector<Sphere<T> > const & coreSet,
+			 Vector3<T> const & initialCenter) {
+
+  Vector3<T> center = initialCenter;
+
+  for (int iteration = 1; iteration <= numCoreSetIterations; iteration++) {
+    Sphere<T> const * farthestSphere = NULL;
+
+    T farthestDistance = -1;
+
+    for (Sphere<T> const & sphere : coreSet) {
+      T distance = getFarthestDistance(sphere, center);
+
+      if (distance > farthestDistance) {
+	farthestSphere   = &sphere;
+	farthestDistance = distance;
+      }
+    }
+
+    Vector3<T> direction = farthestSphere->getCenter() - center;
+
+    T centerDistance = direction.getMagnitude();
+
+    Vector3<T> farthestPoint = farthestSphere->getCenter();
+
+    if (centerDistance > 0) {
+      farthestPoint += direction * (farthestSphere->getRadius() / 
+				    centerDistance);
+    }
+
+    center += (farthestPoint - center) / (T)(iteration + 1);
+  }
+
+  return center;
+}
+
+/// Returns the distance from the given point to the farthest point of the
+/// given sphere.
+///
+template <class T>
+T
+BoundingSphereMinimal<T>::getFarthestDistance(Sphere<T> const & sphere,
+					      Vector3<T> const & point) {
+
+  return (sphere.getCenter() - point).getMagnitude() + sphere.getRadius();
+}
+
+#endif
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// End:
@@ -0,0 +1,80 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+#ifndef CACHE_ALIGNED_H_
+#define CACHE_ALIGNED_H_
+
+// ================================================================
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// ================================================================
+
+/// Size in bytes of a cache line on the targeted processors.  Data written
+/// by different threads is kept this far apart to avoid false sharing.
+///
+const std::size_t cacheLineSize = 64;
+
+/// Allocates and default-constructs an object at an address aligned to a
+/// cache line.  The type should be declared alignas(cacheLineSize) so that its
+/// size is also padded to whole cache lines.  Memory is placed on the NUMA node
+/// of the thread that first writes to it, so objects that are used by one
+/// thread should be allocated by that thread.  Throws std::bad_alloc on
+/// failure.
+///
+template <class T>
+T *
+newCacheAligned() {
+
+  void * memory = NULL;
+
+  if (posix_memalign(&memory, cacheLineSize, sizeof(T)) != 0) {
+    throw std::bad_alloc();
+  }
+
+  return new (memory) T();
+}
+
+/// Destroys and frees an object allocated with newCacheAligned().  Does
+/// nothing if the object is NULL.
+///
+template <class T>
+void
+deleteCacheAligned(T * object) {
+
+  if (object == NULL) {
+    return;
+  }
+
+  object->~T();
+
+  free(object);
+}
+
+// ================================================================
+
+#endif  // #ifndef CACHE_ALIGNED_H_
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// mode: c++
+// End:
@@ -0,0 +1,279 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+#include <cmath>
+#include <algorithm>
+
+#include "FormFactorKernel.h"
+
+// ================================================================
+
+/// Copies the given points, scaled by the given length scale, for summing
+/// over their pairs at the given q values.
+///
+FormFactorKernel::
+FormFactorKernel(std::vector<Vector3<double> > const & points,
+		 double lengthScale,
+		 std::vector<double> const & qs)
+  : numPoints(points.size()),
+    numBlocks((points.size() + tileSize - 1) / tileSize),
+    xs(points.size()),
+    ys(points.size()),
+    zs(points.size()),
+    qs(qs),
+    inverseQs(qs.size()) {
+
+  for (BigUInt pointNum = 0; pointNum < numPoints; ++pointNum) {
+    xs[pointNum] = points[pointNum].getX() * lengthScale;
+    ys[pointNum] = points[pointNum].getY() * lengthScale;
+    zs[pointNum] = points[pointNum].getZ() * lengthScale;
+  }
+
+  for (std::size_t qNum = 0; qNum < qs.size(); ++qNum) {
+    inverseQs[qNum] = 1 / qs[qNum];
+  }
+}
+
+FormFactorKernel::
+~FormFactorKernel() {
+
+}
+
+/// Returns the number of tiles, which are numbered along each column of
+/// blocks from the diagonal tile of the first column.
+///
+FormFactorKernel::BigUInt
+FormFactorKernel::
+getNumTiles() const {
+
+  return numBlocks * (numBlocks + 1) / 2;
+}
+
+/// Adds sin(qr)/(qr) for each q, summed over the pairs in the given range of
+/// tiles, to the given sums, which must have one entry per q.
+///
+void
+FormFactorKernel::
+addTiles(BigUInt startTileIndex,
+	 BigUInt endTileIndex,
+	 std::vector<double> * sums) const {
+
+  if (startTileIndex >= endTileIndex) {
+    return;
+  }
+
+  std::size_t numQs = qs.size();
+
+  //sums for each q and each column of a tile, summed over all rows of the
+  //tiles so the innermost loop has no dependence between iterations
+
+  std::vector<double> distances(tileSize);
+  std::vector<double> inverseDistances(tileSize);
+  std::vector<double> tileSums(numQs * tileSize, 0);
+
+  BigUInt numCoincidentPairs = 0;
+
+  BigUInt rowBlock = 0, columnBlock = 0;
+
+  tileIndexToBlocks(startTileIndex, &rowBlock, &columnBlock);
+
+  for (BigUInt tileIndex = startTileIndex;
+       tileIndex < endTileIndex;
+       ++tileIndex) {
+
+    addTile(rowBlock, 
+	    columnBlock, 
+	    distances.data(), 
+	    inverseDistances.data(),
+	    tileSums.data(),
+	    &numCoincidentPairs);
+
+    ++rowBlock;
+
+    if (rowBlock > columnBlock) {
+      rowBlock = 0;
+      ++columnBlock;
+    }
+  }
+
+  for (std::size_t qNum = 0; qNum < numQs; ++qNum) {
+    for (int columnNum = 0; columnNum < tileSize; ++columnNum) {
+      (*sums)[qNum] += tileSums[qNum * tileSize + columnNum];
+    }
+
+    (*sums)[qNum] += numCoincidentPairs;
+  }
+}
+
+/// Adds sin(qr)/(qr) for the pairs of points (i, j) with i in the given row
+/// block and j in the given column block to the sums for each q and each
+/// column of the tile.  In tiles on the diagonal only pairs with i < j are
+/// taken.
+///
+/// Dividing sin(qr) by qr is done by multiplying by precomputed 1/q and 1/r.
+/// Pairs of coincident points, for which sin(qr)/(qr) = 1, are given 1/r = 0
+/// and counted instead.
+///
+void
+FormFactorKernel::
+addTile(BigUInt rowBlock,
+	BigUInt columnBlock,
+	double * distances,
+	double * inverseDistances,
+	double * tileSums,
+	BigUInt * numCoincidentPairs) const {
+
+  BigUInt rowStart = rowBlock * tileSize;
+  BigUInt rowEnd = std::min<BigUInt>(rowStart + tileSize, numPoints);
+
+  BigUInt columnStart = columnBlock * tileSize;
+  BigUInt columnEnd = std::min<BigUInt>(columnStart + tileSize, numPoints);
+
+  int numColumns = columnEnd - columnStart;
+
+  double const * columnXs = xs.data() + columnStart;
+  double const * columnYs = ys.data() + columnStart;
+  double const * columnZs = zs.data() + columnStart;
+
+  std::size_t numQs = qs.size();
+
+  for (BigUInt i = rowStart; i < rowEnd; ++i) {
+
+    int firstColumn = (rowBlock == columnBlock) ? i - rowStart + 1 : 0;
+
+    double x = xs[i];
+    double y = ys[i];
+    double z = zs[i];
+
+    for (int columnNum = firstColumn; columnNum < numColumns; ++columnNum) {
+      double dx = x - columnXs[columnNum];
+      double dy = y - columnYs[columnNum];
+      double dz = z - columnZs[columnNum];
+
+      double distance = sqrt(dx*dx + dy*dy + dz*dz);
+
+      distances[columnNum] = distance;
+
+      if (distance > 0) {
+	inverseDistances[columnNum] = 1 / distance;
+      }
+      else {
+	inverseDistances[columnNum] = 0;
+
+	(*numCoincidentPairs)++;
+      }
+    }
+
+    for (std::size_t qNum = 0; qNum < numQs; ++qNum) {
+
+      double q = qs[qNum];
+      double inverseQ = inverseQs[qNum];
+
+      double * qSums = tileSums + qNum * tileSize;
+
+      for (int columnNum = firstColumn; columnNum < numColumns; ++columnNum) {
+	qSums[columnNum] += 
+	  computeSin(q * distances[columnNum]) * 
+	  inverseQ * inverseDistances[columnNum];
+      }
+    }
+  }
+}
+
+/// Returns sin(x).
+///
+/// Unlike sin() from the math library this is built only from arithmetic,
+/// with no branches, so loops over it vectorize.  x is reduced to r = x - n pi
+/// with |r| <= pi/2, and sin(x) = (-1)^n sin(r) is evaluated from the Taylor
+/// series of sin(r) to degree 21, whose relative truncation error is below
+/// 1e-18.  For |x| < pi/2, n = 0 and r = x, so the result has small relative
+/// error however small x is.  The reduction is exact for |x| below about 1e6,
+/// far beyond the largest qr used for form factors.
+///
+double
+FormFactorKernel::
+computeSin(double x) {
+
+  //adding and subtracting 1.5 * 2^52 rounds to the nearest integer
+  const double roundingConstant = 6755399441055744.0;
+
+  const double inversePi = 0.31830988618379067154;
+
+  //pi split so that n * piHigh is exact
+  const double piHigh = 3.1415926534682512;
+  const double piLow  = 1.2154201013012384e-10;
+
+  double n = (x * inversePi + roundingConstant) - roundingConstant;
+
+  double r = (x - n * piHigh) - n * piLow;
+
+  //n/2 is an integer for even n, and otherwise lies halfway between two
+  //integers and rounds to one of them
+  double halfN = 0.5 * n;
+  double halfNRounded = (halfN + roundingConstant) - roundingConstant;
+
+  double sign = 1 - 4 * fabs(halfN - halfNRounded);
+
+  double r2 = r * r;
+
+  double sinROverR =
+    1 + r2 * (-1. / 6 +
+    r2 * (1. / 120 +
+    r2 * (-1. / 5040 +
+    r2 * (1. / 362880 +
+    r2 * (-1. / 39916800 +
+    r2 * (1. / 6227020800 +
+    r2 * (-1. / 1307674368000 +
+    r2 * (1. / 355687428096000 +
+    r2 * (-1. / 121645100408832000 +
+    r2 * (1. / 51090942171709440000.))))))))));
+
+  return sign * sinROverR * r;
+}
+
+/// Inverts the formula:
+/// tileIndex = (columnBlock*columnBlock + columnBlock)/2 + rowBlock
+/// with rowBlock <= columnBlock.
+///
+void
+FormFactorKernel::
+tileIndexToBlocks(BigUInt tileIndex,
+		  BigUInt * rowBlock,
+		  BigUInt * columnBlock) const {
+
+  (*columnBlock) = (sqrt(8*(double)tileIndex + 1) - 1) / 2;
+
+  //correct for rounding in the square root
+
+  while ((*columnBlock) * ((*columnBlock) + 1) / 2 > tileIndex) {
+    --(*columnBlock);
+  }
+
+  while (((*columnBlock) + 1) * ((*columnBlock) + 2) / 2 <= tileIndex) {
+    ++(*columnBlock);
+  }
+
+  (*rowBlock) = tileIndex - (*columnBlock) * ((*columnBlock) + 1) / 2;
+}
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// mode: c++
+// End:
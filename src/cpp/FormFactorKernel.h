@@ -0,0 +1,94 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+#ifndef FORM_FACTOR_KERNEL_H_
+#define FORM_FACTOR_KERNEL_H_
+
+// ================================================================
+
+#include <vector>
+#include <cstdint>
+
+#include "Geometry/Vector3.h"
+
+// ================================================================
+
+/// Sums sin(qr)/(qr) over the distances r between all pairs of distinct
+/// points, for each of a fixed set of q values.
+///
+/// The points are copied into separate x, y, and z arrays and the pairs are
+/// taken in tiles of tileSize by tileSize points, so the points of a tile stay
+/// in cache while every q is evaluated for them.  Within a tile the distances
+/// from one point to a row of points are computed once and shared by all q,
+/// and the inner loops contain no function calls, so they vectorize.
+///
+class FormFactorKernel {
+public:
+  using BigUInt = uint_fast64_t;
+
+  FormFactorKernel(std::vector<Vector3<double> > const & points,
+		   double lengthScale,
+		   std::vector<double> const & qs);
+
+  ~FormFactorKernel();
+
+  BigUInt getNumTiles() const;
+
+  void addTiles(BigUInt startTileIndex,
+		BigUInt endTileIndex,
+		std::vector<double> * sums) const;
+
+  static double computeSin(double x);
+
+private:
+  /// Number of points along each side of a tile.
+  ///
+  static const int tileSize = 64;
+
+  void addTile(BigUInt rowBlock,
+	       BigUInt columnBlock,
+	       double * distances,
+	       double * inverseDistances,
+	       double * tileSums,
+	       BigUInt * numCoincidentPairs) const;
+
+  void tileIndexToBlocks(BigUInt tileIndex,
+			 BigUInt * rowBlock,
+			 BigUInt * columnBlock) const;
+
+  BigUInt numPoints;
+  BigUInt numBlocks;
+
+  std::vector<double> xs;
+  std::vector<double> ys;
+  std::vector<double> zs;
+
+  std::vector<double> qs;
+  std::vector<double> inverseQs;
+};
+
+// ================================================================
+
+#endif  // #ifndef FORM_FACTOR_KERNEL_H_
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// mode: c++
+// End:
@@ -0,0 +1,112 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+#ifndef SPHERE_VOLUME_TABLE_H
+#define SPHERE_VOLUME_TABLE_H
+
+#include <algorithm>
+#include <vector>
+
+#include "Sphere.h"
+
+// ================================================================
+
+/// Stores the running sum of the volumes of a set of spheres, so that a
+/// sphere can be chosen at random with probability proportional to its
+/// volume by a binary search.
+///
+template <class T>
+class SphereVolumeTable
+{
+public:
+  SphereVolumeTable(std::vector<Sphere<T> > const & spheres);
+  ~SphereVolumeTable();
+
+  T getTotalVolume() const;
+
+  Sphere<T> const & findSphere(T volumeFraction) const;
+
+private:
+  std::vector<Sphere<T> > const * spheres;
+
+  std::vector<T> cumulativeVolumes;
+};
+
+template <class T>
+SphereVolumeTable<T>::SphereVolumeTable(std::vector<Sphere<T> > const & 
+					spheres)
+  : spheres(&spheres),
+    cumulativeVolumes(spheres.size()) {
+
+  T volumeSum = 0;
+
+  for (unsigned int i = 0; i < spheres.size(); i++) {
+    volumeSum += spheres[i].getVolume();
+
+    cumulativeVolumes[i] = volumeSum;
+  }
+}
+
+template <class T>
+SphereVolumeTable<T>::~SphereVolumeTable() {
+
+}
+
+/// Returns the sum of the volumes of all the spheres, counting regions where
+/// spheres overlap once for each sphere.
+///
+template <class T>
+T
+SphereVolumeTable<T>::getTotalVolume() const {
+
+  if (cumulativeVolumes.empty()) {
+    return 0;
+  }
+
+  return cumulativeVolumes.back();
+}
+
+/// Returns the sphere whose share of the total volume contains the given
+/// fraction in [0, 1).  Each sphere is returned for a fraction of the range
+/// proportional to its volume.
+///
+template <class T>
+Sphere<T> const &
+SphereVolumeTable<T>::findSphere(T volumeFraction) const {
+
+  T volume = volumeFraction * getTotalVolume();
+
+  unsigned int sphereNum = 
+    std::upper_bound(cumulativeVolumes.begin(), cumulativeVolumes.end(),
+		     volume) - cumulativeVolumes.begin();
+
+  sphereNum = std::min(sphereNum, (unsigned int)(spheres->size() - 1));
+
+  return (*spheres)[sphereNum];
+}
+
+// ================================================================
+
+#endif  // #ifndef SPHERE_VOLUME_TABLE_H
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// mode: c++
+// End:
@@ -0,0 +1,354 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+#include "IndexCache.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ================================================================
+
+/// Identifies the cache file format.  Change this whenever the layout of the
+/// file or of any spatial data structure's saved data changes.
+///
+const char cacheMagic[8] = {'Z', 'E', 'N', 'O', 'I', 'D', 'X', '1'};
+
+const uint64_t fnvOffsetBasis = 14695981039346656037ULL;
+const uint64_t fnvPrime       = 1099511628211ULL;
+
+// ================================================================
+
+/// Prepares to cache the given input file in the given directory.  Reads the
+/// input file to compute the cache key.  If the directory name is empty or the
+/// input file cannot be read, the cache is disabled.
+///
+IndexCache::
+IndexCache(std::string const & cacheDirName,
+	   std::string const & inputFileName,
+	   double fracErrorBound,
+	   std::string const & modelName)
+  : key(fnvOffsetBasis),
+    fileName() {
+
+  if (cacheDirName.empty()) {
+    return;
+  }
+
+  FILE * inputFile = fopen(inputFileName.c_str(), "rb");
+
+  if (inputFile == NULL) {
+    return;
+  }
+
+  const int bufferSize = 1 << 20;
+
+  std::vector<char> buffer(bufferSize);
+
+  size_t numBytesRead = 0;
+
+  while ((numBytesRead = fread(buffer.data(), 1, bufferSize, inputFile)) > 0) {
+    hashBytes(buffer.data(), numBytesRead, &key);
+  }
+
+  bool readError = ferror(inputFile);
+
+  fclose(inputFile);
+
+  if (readError) {
+    return;
+  }
+
+  hashBytes(&fracErrorBound, sizeof(double), &key);
+  hashBytes(modelName.data(), modelName.size(), &key);
+  hashBytes(cacheMagic, sizeof(cacheMagic), &key);
+
+  std::ostringstream fileNameStream;
+
+  fileNameStream << cacheDirName << "/zeno-index-"
+		 << std::hex << std::setw(16) << std::setfill('0') << key
+		 << ".bin";
+
+  fileName = fileNameStream.str();
+}
+
+IndexCache::
+~IndexCache() {
+
+}
+
+/// Returns whether the cache can be used.
+///
+bool
+IndexCache::
+isEnabled() const {
+
+  return !fileName.empty();
+}
+
+/// Returns the name of the cache file.
+///
+std::string
+IndexCache::
+getFileName() const {
+
+  return fileName;
+}
+
+/// Updates the given FNV-1a hash with the given bytes.
+///
+void
+IndexCache::
+hashBytes(void const * data, size_t numBytes, uint64_t * hash) {
+
+  unsigned char const * bytes = static_cast<unsigned char const *>(data);
+
+  for (size_t i = 0; i < numBytes; i++) {
+    *hash ^= bytes[i];
+    *hash *= fnvPrime;
+  }
+}
+
+/// Reads the bod parameters and spheres from the cache file.  Returns whether
+/// the read succeeded.  On failure the parameters and spheres are unchanged.
+///
+bool
+IndexCache::
+loadInput(Parameters * parameters,
+	  Spheres<double> * spheres) const {
+
+  Header header;
+
+  long fileSize = 0;
+
+  FILE * file = openAndReadHeader(&header, &fileSize);
+
+  if (file == NULL) {
+    return false;
+  }
+
+  double parametersArray[Parameters::numBodParameters];
+
+  std::vector<double> sphereData(4 * header.numSpheres);
+
+  bool loaded =
+    (fread(parametersArray, sizeof(double),
+	   Parameters::numBodParameters, file) ==
+     (size_t)Parameters::numBodParameters) &&
+    (fread(sphereData.data(), sizeof(double),
+	   sphereData.size(), file) ==
+     sphereData.size());
+
+  fclose(file);
+
+  if (!loaded) {
+    return false;
+  }
+
+  parameters->setBodParameters(parametersArray);
+
+  for (int64_t sphereNum = 0; sphereNum < header.numSpheres; sphereNum++) {
+    double const * data = &sphereData[4 * sphereNum];
+
+    spheres->add(Sphere<double>(Vector3<double>(data[0], data[1], data[2]),
+				data[3]));
+  }
+
+  return true;
+}
+
+/// Opens the cache file and reads and checks its header, and returns the size
+/// of the file.  Returns NULL if the cache is disabled, the file does not
+/// exist, the header does not match, or the file is too short to hold the
+/// number of spheres given in the header.
+///
+FILE *
+IndexCache::
+openAndReadHeader(Header * header, long * fileSize) const {
+
+  if (!isEnabled()) {
+    return NULL;
+  }
+
+  FILE * file = fopen(fileName.c_str(), "rb");
+
+  if (file == NULL) {
+    return NULL;
+  }
+
+  if (fread(header, sizeof(Header), 1, file) != 1 ||
+      memcmp(header->magic, cacheMagic, sizeof(cacheMagic)) != 0 ||
+      header->key != key ||
+      header->numSpheres < 0) {
+
+    fclose(file);
+
+    return NULL;
+  }
+
+  long dataPosition = ftell(file);
+
+  if (fseek(file, 0, SEEK_END) != 0 ||
+      (*fileSize = ftell(file)) < 0 ||
+      fseek(file, dataPosition, SEEK_SET) != 0) {
+
+    fclose(file);
+
+    return NULL;
+  }
+
+  int64_t maxNumSpheres = 
+    (*fileSize - (long)sizeof(Header) - 
+     Parameters::numBodParameters * (long)sizeof(double)) / 
+    (4 * (long)sizeof(double));
+
+  if (header->numSpheres > maxNumSpheres) {
+    fclose(file);
+
+    return NULL;
+  }
+
+  return file;
+}
+
+/// Returns the position in the cache file at which the spatial data structure
+/// begins.
+///
+long
+IndexCache::
+getModelOffset(Header const & header) const {
+
+  return
+    sizeof(Header) +
+    Parameters::numBodParameters * sizeof(double) +
+    4 * header.numSpheres * sizeof(double);
+}
+
+/// Creates a temporary cache file with a unique name, returned in
+/// tempFileName, and writes the header, the given bod parameters, and the
+/// given spheres.  Returns NULL if the cache is disabled or the file cannot be
+/// created.
+///
+FILE *
+IndexCache::
+beginWrite(Parameters const & parameters,
+	   std::vector<Sphere<double> > const & spheres,
+	   std::string * tempFileName) const {
+
+  if (!isEnabled()) {
+    return NULL;
+  }
+
+  std::vector<char> tempFileNameChars(fileName.begin(), fileName.end());
+
+  const char suffix[] = ".XXXXXX";
+
+  tempFileNameChars.insert(tempFileNameChars.end(), 
+			   suffix, suffix + sizeof(suffix));
+
+  int fd = mkstemp(tempFileNameChars.data());
+
+  if (fd == -1) {
+    return NULL;
+  }
+
+  *tempFileName = tempFileNameChars.data();
+
+  // mkstemp() creates the file readable only by its owner, but a cache
+  // directory may be shared
+  fchmod(fd, 0644);
+
+  FILE * file = fdopen(fd, "wb");
+
+  if (file == NULL) {
+    close(fd);
+    remove(tempFileName->c_str());
+
+    return NULL;
+  }
+
+  Header header;
+
+  memset(&header, 0, sizeof(Header));
+
+  memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+
+  header.key        = key;
+  header.numSpheres = spheres.size();
+
+  fwrite(&header, sizeof(Header), 1, file);
+
+  double parametersArray[Parameters::numBodParameters];
+
+  parameters.getBodParameters(parametersArray);
+
+  fwrite(parametersArray, sizeof(double), Parameters::numBodParameters, file);
+
+  std::vector<double> sphereData(4 * spheres.size());
+
+  for (unsigned int sphereNum = 0; sphereNum < spheres.size(); sphereNum++) {
+    for (int dim = 0; dim < 3; dim++) {
+      sphereData[4*sphereNum + dim] = spheres[sphereNum].getCenter().get(dim);
+    }
+
+    sphereData[4*sphereNum + 3] = spheres[sphereNum].getRadius();
+  }
+
+  fwrite(sphereData.data(), sizeof(double), sphereData.size(), file);
+
+  return file;
+}
+
+/// Closes the given temporary cache file and, if everything was written,
+/// atomically renames it to its final name.  Otherwise removes it.  Returns
+/// whether the cache file was written.
+///
+bool
+IndexCache::
+endWrite(FILE * file, 
+	 std::string const & tempFileName, 
+	 bool modelSaved) const {
+
+  bool written = modelSaved && !ferror(file);
+
+  written = (fclose(file) == 0) && written;
+
+  if (!written) {
+    remove(tempFileName.c_str());
+
+    return false;
+  }
+
+  if (rename(tempFileName.c_str(), fileName.c_str()) != 0) {
+    remove(tempFileName.c_str());
+
+    return false;
+  }
+
+  return true;
+}
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// End:
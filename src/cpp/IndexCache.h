@@ -0,0 +1,163 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+#ifndef INDEX_CACHE_H_
+#define INDEX_CACHE_H_
+
+// ================================================================
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+#include "Parameters.h"
+
+#include "Geometry/Sphere.h"
+#include "Geometry/Spheres.h"
+
+// ================================================================
+
+/// Caches the contents of a bod file and the spatial data structure built
+/// from it in a single binary file, so later runs on the same input can skip
+/// parsing and preprocessing.  The cache file name is derived from a hash of
+/// the bod file contents, the fractional error bound, and the type of spatial
+/// data structure, so a changed input simply misses the cache.
+///
+/// The file holds a header, the bod parameters, the sphere centers and radii,
+/// and finally whatever the spatial data structure's save() method writes.
+///
+class IndexCache
+{
+public:
+  IndexCache(std::string const & cacheDirName,
+	     std::string const & inputFileName,
+	     double fracErrorBound,
+	     std::string const & modelName);
+
+  ~IndexCache();
+
+  bool isEnabled() const;
+
+  std::string getFileName() const;
+
+  bool loadInput(Parameters * parameters,
+		 Spheres<double> * spheres) const;
+
+  template <class SphereCenterModel>
+  bool loadModel(std::vector<Sphere<double> > const & spheres,
+		 SphereCenterModel * model) const;
+
+  template <class SphereCenterModel>
+  bool save(Parameters const & parameters,
+	    std::vector<Sphere<double> > const & spheres,
+	    SphereCenterModel const & model) const;
+
+private:
+  struct Header {
+    char magic[8];
+
+    uint64_t key;
+
+    int64_t numSpheres;
+  };
+
+  static void hashBytes(void const * data, size_t numBytes, uint64_t * hash);
+
+  FILE * openAndReadHeader(Header * header, long * fileSize) const;
+
+  long getModelOffset(Header const & header) const;
+
+  FILE * beginWrite(Parameters const & parameters,
+		    std::vector<Sphere<double> > const & spheres,
+		    std::string * tempFileName) const;
+
+  bool endWrite(FILE * file, 
+		std::string const & tempFileName, 
+		bool modelSaved) const;
+
+  uint64_t key;
+
+  std::string fileName;
+};
+
+/// Reads the spatial data structure for the given spheres from the cache file.
+/// The spheres must be those returned by loadInput(), or an identical copy.
+/// Returns whether the read succeeded, which requires the data structure to
+/// end exactly at the end of the file.
+///
+template <class SphereCenterModel>
+bool
+IndexCache::
+loadModel(std::vector<Sphere<double> > const & spheres,
+	  SphereCenterModel * model) const {
+
+  Header header;
+
+  long fileSize = 0;
+
+  FILE * file = openAndReadHeader(&header, &fileSize);
+
+  if (file == NULL) {
+    return false;
+  }
+
+  bool loaded =
+    (header.numSpheres == (int64_t)spheres.size()) &&
+    (fseek(file, getModelOffset(header), SEEK_SET) == 0) &&
+    model->load(file, spheres) &&
+    (ftell(file) == fileSize);
+
+  fclose(file);
+
+  return loaded;
+}
+
+/// Writes the given bod parameters, spheres, and spatial data structure to the
+/// cache file.  The file is written under a temporary name unique to this
+/// write and then renamed, so concurrent runs never see a partial file or
+/// write to the same one.  Returns whether the write succeeded.
+///
+template <class SphereCenterModel>
+bool
+IndexCache::
+save(Parameters const & parameters,
+     std::vector<Sphere<double> > const & spheres,
+     SphereCenterModel const & model) const {
+
+  std::string tempFileName;
+
+  FILE * file = beginWrite(parameters, spheres, &tempFileName);
+
+  if (file == NULL) {
+    return false;
+  }
+
+  return endWrite(file, tempFileName, model.save(file));
+}
+
+// ================================================================
+
+#endif  // #ifndef INDEX_CACHE_H_
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// mode: c++
+// End:
@@ -28,6 +28,9 @@
 #ifndef IN_OUT_SPHERE_CENTERS_H
 #define IN_OUT_SPHERE_CENTERS_H
 
+#include <vector>
+
+#include "../Geometry/Sphere.h"
 #include "../Geometry/Vector3.h"
 
 // ================================================================
@@ -46,6 +49,10 @@ public:
   bool isInside(Vector3<double> const & queryPoint,
 		double fracErrorBound) const;
 
+  int countContainingSpheres(Vector3<double> const & queryPoint,
+			     std::vector<Sphere<double> const *> * 
+			     candidateSpheres) const;
+
 private:
   SphereCenterModel const * sphereCenterModel;
 };
@@ -94,6 +101,42 @@ isInside(Vector3<double> const & queryPoint,
   return false;
 }
 
+/// Return the number of spheres that contain the given query point.  The
+/// given vector is used as scratch space for the candidate spheres, so that
+/// repeated calls do not need to allocate.
+///
+template <class SphereCenterModel>
+int
+InOutSphereCenters<SphereCenterModel>::
+countContainingSpheres(Vector3<double> const & queryPoint,
+		       std::vector<Sphere<double> const *> * 
+		       candidateSpheres) const {
+
+  int numContaining = 0;
+
+  for (unsigned int radiusNum = 0; 
+       radiusNum < sphereCenterModel->getNumRadii(); 
+       radiusNum ++) {
+
+    candidateSpheres->clear();
+
+    sphereCenterModel->findNearbySpheres(radiusNum,
+					 queryPoint,
+					 0,
+					 candidateSpheres);
+
+    for (Sphere<double> const * sphere : *candidateSpheres) {
+      Vector3<double> centerOffset = queryPoint - sphere->getCenter();
+
+      if (centerOffset.getMagnitudeSqr() <= sphere->getRadiusSqr()) {
+	numContaining ++;
+      }
+    }
+  }
+
+  return numContaining;
+}
+
 // ================================================================
 
 #endif  // #ifndef IN_OUT_SPHERE_CENTERS_H
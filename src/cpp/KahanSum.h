@@ -0,0 +1,102 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+#ifndef KAHAN_SUM_H_
+#define KAHAN_SUM_H_
+
+// ================================================================
+
+/// Accumulates a sum of values using Kahan compensated summation, which
+/// carries the rounding error of each addition forward into the next one.
+/// The type may be a scalar, Vector3, or Matrix3x3, in which case each
+/// component is compensated separately.
+///
+template <class T>
+class KahanSum {
+public:
+  KahanSum();
+
+  void add(T const & value);
+
+  T const & getSum() const;
+
+private:
+  T sum;
+  T compensation;
+};
+
+/// Returns the estimated variance of the sum of the given number of
+/// independent values, computed from their sum and their sum of squares.
+/// Fewer than two values give no variance estimate.
+///
+inline double
+getSumVariance(double sum, double sqrSum, double num) {
+
+  if (num < 2) {
+    return 0;
+  }
+
+  //sum of squared deviations from the mean, which can round to slightly
+  //below zero when all values are nearly equal
+  double M2 = sqrSum - sum * sum / num;
+
+  if (M2 < 0) {
+    M2 = 0;
+  }
+
+  return M2 * num / (num - 1);
+}
+
+template <class T>
+KahanSum<T>::
+KahanSum()
+  : sum(),
+    compensation() {
+
+}
+
+template <class T>
+void
+KahanSum<T>::
+add(T const & value) {
+
+  T correctedValue = value - compensation;
+  T newSum = sum + correctedValue;
+
+  compensation = (newSum - sum) - correctedValue;
+  sum = newSum;
+}
+
+template <class T>
+T const &
+KahanSum<T>::
+getSum() const {
+
+  return sum;
+}
+
+// ================================================================
+
+#endif  // #ifndef KAHAN_SUM_H_
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// mode: c++
+// End:
@@ -30,9 +30,12 @@
 #endif
 
 #include <thread>
+#include <atomic>
+#include <functional>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <sstream>
 #include <limits>
 #include <algorithm>
 #include <cstdlib>
@@ -48,16 +51,20 @@
 #include "ResultsZeno.h"
 #include "ResultsInterior.h"
 #include "ResultsCompiler.h"
+#include "PointsWriter.h"
 
 #include "Geometry/Sphere.h"
 #include "Geometry/Spheres.h"
+#include "Geometry/SphereVolumeTable.h"
 #include "Geometry/Vector3.h"
 
 #include "NearestSurfacePoint/PointFromSphereCenters.h"
+#include "NearestSurfacePoint/BuriedSpherePruner.h"
 
 #include "InsideOutside/InOutSphereCenters.h"
 
 #include "BoundingSphere/BoundingSphereAABB.h"
+#include "BoundingSphere/BoundingSphereMinimal.h"
 
 #include "SpherePoint/RandomSpherePointMarsaglia.h"
 #include "SpherePoint/BiasedSpherePointDirect.h"
@@ -65,23 +72,49 @@
 
 #include "Walker/WalkerExterior.h"
 #include "Walker/SamplerInterior.h"
+#include "Walker/SamplerUnion.h"
 
 #include "Timer.h"
+#include "ThreadPool.h"
+#include "IndexCache.h"
 
+#ifdef USE_SPHERE_BVH
+#include "SphereCenterModel/SphereBVH.h"
+#else
 #include "SphereCenterModel/NanoFLANNSort.h"
+#endif
 
+#ifdef USE_PHILOX_RNG
+#include "RandomNumber/Philox.h"
+#else
 #include "RandomNumber/SPRNG.h"
+#endif
 
+#ifdef USE_SPHERE_BVH
+using SpheresModel = SphereBVH;
+
+const std::string spheresModelName = "SphereBVH";
+#else
 using SpheresModel = NanoFLANNSort;
 
+const std::string spheresModelName = "NanoFLANNSort";
+#endif
+
 using SpheresNearestSurfacePointFinder = PointFromSphereCenters<SpheresModel>;
 using SpheresInsideOutsideTester       = InOutSphereCenters<SpheresModel>;
 
+#ifdef USE_PHILOX_RNG
+using RandomNumberGenerator = Philox;
+#else
 using RandomNumberGenerator = SPRNG;
+#endif
 
 using BoundingSphereGenerator = 
   BoundingSphereAABB<double>;
 
+using MinimalBoundingSphereGenerator = 
+  BoundingSphereMinimal<double>;
+
 using RandomSpherePointGenerator = 
   RandomSpherePointMarsaglia<double, 
 			     RandomNumberGenerator>;
@@ -95,15 +128,19 @@ using RandomBallPointGenerator =
   RandomBallPointRejection<double,
 			   RandomNumberGenerator>;
 
+/// Number of chunks each thread claims, on average, when walks or samples are
+/// scheduled dynamically.
+///
+const int numChunksPerThread = 64;
+
 // ================================================================
 
 int
 getInput(int argc, char **argv,
 	 Parameters * parameters,
-	 long long * numWalksInProcess,
-	 long long * numSamplesInProcess,
 	 Spheres<double> * spheres,
 	 bool * spheresLoaded,
+	 IndexCache * * indexCache,
 	 double * initializeTime,
 	 double * readTime,
 	 double * broadcastTime);
@@ -112,8 +149,11 @@ int
 preprocessWalkOnSpheres(bool spheresLoaded,
 			Parameters const & parameters,
 			Spheres<double> const & spheres,
+			IndexCache const * indexCache,
 			Sphere<double> * boundingSphere,
 			SpheresModel * spheresModel,
+			std::vector<Sphere<double> > * exposedSpheres,
+			SpheresModel * exposedSpheresModel,
 			SpheresNearestSurfacePointFinder * *
 			spheresNearestSurfacePointFinder,
 			double * preprocessTime);
@@ -122,35 +162,60 @@ void setupRNGs(Parameters const & parameters,
 	       std::vector<RandomNumberGenerator> * threadRNGs);
 
 int
-getWalkOnSpheresResults(long long numWalksInProcess,			
-			Parameters const & parameters,
+getWalkOnSpheresResults(Parameters const & parameters,
+			Timer const & totalTimer,
+			ThreadPool * threadPool,
 			Sphere<double> const & boundingSphere,
 			SpheresNearestSurfacePointFinder const * 
 			spheresNearestSurfacePointFinder,			
 			std::vector<RandomNumberGenerator> * threadRNGs,
 			ResultsZeno * * resultsZeno,
 			double * walkTime,
+			std::vector<double> * walkIdleTimes,
 			double * reduceTime);
 
 int
 preprocessInterior(bool spheresLoaded,
 		   Parameters const & parameters,
+		   Spheres<double> const & spheres,
 		   SpheresModel const & spheresModel,
 		   SpheresInsideOutsideTester * *
 		   spheresInsideOutsideTester,
+		   SphereVolumeTable<double> * * sphereVolumeTable,
 		   double * surfacePreprocessTime);
 
 int
-getInteriorResults(long long numSamplesInProcess,			
-		   Parameters const & parameters,
+getInteriorResults(Parameters const & parameters,
+		   Timer const & totalTimer,
+		   ThreadPool * threadPool,
 		   Sphere<double> const & boundingSphere,
 		   SpheresInsideOutsideTester const * 
 		   spheresInsideOutsideTester,			
+		   SphereVolumeTable<double> const * sphereVolumeTable,
 		   std::vector<RandomNumberGenerator> * threadRNGs,
 		   ResultsInterior * * resultsInterior,
 		   double * sampleTime,
+		   std::vector<double> * sampleIdleTimes,
 		   double * volumeReduceTime);
 
+int
+getConcurrentResults(Parameters const & parameters,
+		     Timer const & totalTimer,
+		     ThreadPool * threadPool,
+		     Sphere<double> const & boundingSphere,
+		     SpheresNearestSurfacePointFinder const * 
+		     spheresNearestSurfacePointFinder,
+		     SpheresInsideOutsideTester const * 
+		     spheresInsideOutsideTester,
+		     SphereVolumeTable<double> const * sphereVolumeTable,
+		     std::vector<RandomNumberGenerator> * threadRNGs,
+		     ResultsZeno * * resultsZeno,
+		     ResultsInterior * * resultsInterior,
+		     double * walkTime,
+		     std::vector<double> * idleTimes,
+		     double * reduceTime,
+		     double * volumeReduceTime);
+
 long long 
 computeNumInProcess(int mpiSize, int mpiRank,
 		    long long totalNumSamples);
@@ -161,6 +226,7 @@ parseBodFile(Parameters * parameters,
 
 void
 getBodData(Parameters * parameters,
+	   IndexCache const * indexCache,
 	   Spheres<double> * spheres,
 	   double * readTime,
 	   double * broadcastTime);
@@ -174,19 +240,59 @@ estimateTotalNum(double requestedError,
 		 long long numSoFar,
 		 Uncertain<double> const & currentValue);
 
+long long 
+estimateNumWalksRemaining(Parameters const & parameters,
+			  ThreadPool * threadPool,
+			  Sphere<double> const & boundingSphere,
+			  ResultsZeno const & resultsZeno);
+
+long long 
+estimateNumSamplesRemaining(Parameters const & parameters,
+			    ThreadPool * threadPool,
+			    Sphere<double> const & boundingSphere,
+			    ResultsInterior const & resultsInterior);
+
+double
+getRunTimeStopTime(Parameters const & parameters,
+		   Timer const & totalTimer,
+		   double runTimeFraction);
+
+double
+getRoundRunTimeFraction(Parameters const & parameters,
+			Timer const & totalTimer,
+			double stopTime,
+			double predictedRoundTime);
+
+double
+getMaxFormFactorTime(Parameters const & parameters,
+		     Timer const & totalTimer,
+		     ThreadPool * threadPool,
+		     Sphere<double> const & boundingSphere,
+		     double stopTime,
+		     double * formFactorPairRate);
+
+double
+getFormFactorTime(Parameters const & parameters,
+		  ResultsInterior const & resultsInterior,
+		  long long numSamplesRemaining,
+		  double formFactorPairRate,
+		  double maxFormFactorTime);
+
 void 
 doWalkOnSpheresSelector(Parameters const & parameters,
-			long long numWalksInProcess,
+			ThreadPool * threadPool,
+			long long numWalks,
 			Sphere<double> const & boundingSphere, 
 			SpheresNearestSurfacePointFinder const * 
 			spheresNearestSurfacePointFinder,
 			std::vector<RandomNumberGenerator> * threadRNGs,
 			ResultsZeno * resultsZeno,
-			double * walkTime);
+			double * walkTime,
+			std::vector<double> * walkIdleTimes);
 
 template <class NearestSurfacePointFinder>
 void
-doWalkOnSpheres(int numThreads,
+doWalkOnSpheres(ThreadPool * threadPool,
 		long long numWalksInProcess,
 		Sphere<double> const & boundingSphere, 
 		NearestSurfacePointFinder const & 
@@ -195,7 +301,8 @@ doWalkOnSpheres(int numThreads,
 		double shellThickness,
 		std::vector<RandomNumberGenerator> * threadRNGs,
 		ResultsZeno * resultsZeno,
-		double * walkTime);
+		double * walkTime,
+		std::vector<double> * walkIdleTimes);
 
 template <class NearestSurfacePointFinder>
 void
@@ -206,53 +313,237 @@ doWalkOnSpheresThread(Sphere<double> const & boundingSphere,
 		      double fracErrorBound,
 		      double shellThickness,
 		      long long numWalks,
+		      long long chunkSize,
+		      std::atomic<long long> * nextWalkNum,
 		      RandomNumberGenerator * randomNumberGenerator,
-		      ResultsZeno * resultsZeno);
+		      ResultsZeno * resultsZeno,
+		      double * busyTime);
 
 void
 doInteriorSamplingSelector(Parameters const & parameters,
-			   long long numSamplesInProcess,
+			   ThreadPool * threadPool,
+			   long long numSamples,
 			   Sphere<double> const & boundingSphere,
 			   SpheresInsideOutsideTester const *  
 			   spheresInsideOutsideTester,
+			   SphereVolumeTable<double> const * sphereVolumeTable,
 			   std::vector<RandomNumberGenerator> * threadRNGs,
 			   ResultsInterior * resultsInterior,
-			   double * sampleTime);
+			   double * sampleTime,
+			   std::vector<double> * sampleIdleTimes);
 
 template <class InsideOutsideTester>
 void
-doInteriorSampling(int numThreads,
+doInteriorSampling(ThreadPool * threadPool,
 		   long long numSamplesInProcess,
 		   Sphere<double> const & boundingSphere, 
 		   InsideOutsideTester const & insideOutsideTester,
+		   SphereVolumeTable<double> const * sphereVolumeTable,
 		   double fracErrorBound,
 		   std::vector<RandomNumberGenerator> * threadRNGs,
 		   ResultsInterior * resultsInterior,
-		   double * sampleTime);
+		   double * sampleTime,
+		   std::vector<double> * sampleIdleTimes);
 
 template <class InsideOutsideTester>
 void
 doInteriorSamplingThread(Sphere<double> const & boundingSphere, 
 			 InsideOutsideTester const & insideOutsideTester,
+			 SphereVolumeTable<double> const * sphereVolumeTable,
 			 int threadNum,
 			 double fracErrorBound,
 			 long long numSamples,
+			 long long chunkSize,
+			 std::atomic<long long> * nextSampleNum,
 			 RandomNumberGenerator * randomNumberGenerators,
-			 ResultsInterior * resultsInterior);
+			 ResultsInterior * resultsInterior,
+			 double * busyTime);
+
+template <class NearestSurfacePointFinder, class InsideOutsideTester>
+void
+doConcurrentSampling(ThreadPool * threadPool,
+		     long long numWalksInProcess,
+		     long long numSamplesInProcess,
+		     Sphere<double> const & boundingSphere, 
+		     NearestSurfacePointFinder const & 
+		     nearestSurfacePointFinder,
+		     InsideOutsideTester const & insideOutsideTester,
+		     SphereVolumeTable<double> const * sphereVolumeTable,
+		     double fracErrorBound,
+		     double shellThickness,
+		     std::vector<RandomNumberGenerator> * threadRNGs,
+		     ResultsZeno * resultsZeno,
+		     ResultsInterior * resultsInterior,
+		     double * time,
+		     std::vector<double> * idleTimes);
+
+template <class NearestSurfacePointFinder, class InsideOutsideTester>
+void
+doConcurrentSamplingThread(Sphere<double> const & boundingSphere, 
+			   NearestSurfacePointFinder const & 
+			   nearestSurfacePointFinder,
+			   InsideOutsideTester const & insideOutsideTester,
+			   SphereVolumeTable<double> const * sphereVolumeTable,
+			   int threadNum,
+			   double fracErrorBound,
+			   double shellThickness,
+			   long long numWalks,
+			   long long numSamples,
+			   long long walkChunkSize,
+			   long long sampleChunkSize,
+			   std::atomic<long long> * nextWalkNum,
+			   std::atomic<long long> * nextSampleNum,
+			   RandomNumberGenerator * randomNumberGenerator,
+			   ResultsZeno * resultsZeno,
+			   ResultsInterior * resultsInterior,
+			   double * busyTime);
+
+template <class Walker, class Sampler>
+void
+doConcurrentSamplingChunks(Walker * walker,
+			   Sampler * sampler,
+			   int threadNum,
+			   long long numWalks,
+			   long long numSamples,
+			   long long walkChunkSize,
+			   long long sampleChunkSize,
+			   std::atomic<long long> * nextWalkNum,
+			   std::atomic<long long> * nextSampleNum,
+			   RandomNumberGenerator * randomNumberGenerator,
+			   ResultsZeno * resultsZeno,
+			   ResultsInterior * resultsInterior);
+
+template <class Walker>
+bool
+doWalkOnSpheresChunk(Walker * walker,
+		     int threadNum,
+		     long long numWalks,
+		     long long chunkSize,
+		     std::atomic<long long> * nextWalkNum,
+		     RandomNumberGenerator * randomNumberGenerator,
+		     ResultsZeno * resultsZeno);
+
+template <class Sampler>
+bool
+doInteriorSamplingChunk(Sampler * sampler,
+			int threadNum,
+			long long numSamples,
+			long long chunkSize,
+			std::atomic<long long> * nextSampleNum,
+			ResultsInterior * resultsInterior);
+
+template <class Walker>
+void
+launchWalks(Walker * walker,
+	    int threadNum,
+	    long long numWalks,
+	    RandomNumberGenerator * randomNumberGenerator,
+	    ResultsZeno * resultsZeno);
+
+template <class Sampler>
+void
+takeSamples(Sampler * sampler,
+	    int threadNum,
+	    long long numSamples,
+	    ResultsInterior * resultsInterior);
+
+template <class NearestSurfacePointFinder>
+void
+doWalkOnSpheresBlocks(Parameters const & parameters,
+		      ThreadPool * threadPool,
+		      long long numWalks,
+		      Sphere<double> const & boundingSphere, 
+		      NearestSurfacePointFinder const & 
+		      nearestSurfacePointFinder,
+		      std::vector<RandomNumberGenerator> * blockRNGs,
+		      ResultsZeno * resultsZeno,
+		      double * walkTime,
+		      std::vector<double> * walkIdleTimes);
+
+template <class InsideOutsideTester>
+void
+doInteriorSamplingBlocks(Parameters const & parameters,
+			 ThreadPool * threadPool,
+			 long long numSamples,
+			 Sphere<double> const & boundingSphere, 
+			 InsideOutsideTester const & insideOutsideTester,
+			 SphereVolumeTable<double> const * sphereVolumeTable,
+			 std::vector<RandomNumberGenerator> * blockRNGs,
+			 ResultsInterior * resultsInterior,
+			 double * sampleTime,
+			 std::vector<double> * sampleIdleTimes);
+
+template <class NearestSurfacePointFinder, class InsideOutsideTester>
+void
+doConcurrentSamplingBlocks(Parameters const & parameters,
+			   ThreadPool * threadPool,
+			   long long numWalks,
+			   long long numSamples,
+			   Sphere<double> const & boundingSphere, 
+			   NearestSurfacePointFinder const & 
+			   nearestSurfacePointFinder,
+			   InsideOutsideTester const & insideOutsideTester,
+			   SphereVolumeTable<double> const * sphereVolumeTable,
+			   std::vector<RandomNumberGenerator> * blockRNGs,
+			   ResultsZeno * resultsZeno,
+			   ResultsInterior * resultsInterior,
+			   double * time,
+			   std::vector<double> * idleTimes);
+
+template <class NearestSurfacePointFinder>
+bool
+doWalkOnSpheresBlock(Parameters const & parameters,
+		     Sphere<double> const & boundingSphere, 
+		     NearestSurfacePointFinder const & 
+		     nearestSurfacePointFinder,
+		     long long numWalks,
+		     std::atomic<int> * nextBlockIndex,
+		     std::vector<RandomNumberGenerator> * blockRNGs,
+		     ResultsZeno * resultsZeno);
+
+template <class InsideOutsideTester>
+bool
+doInteriorSamplingBlock(Parameters const & parameters,
+			Sphere<double> const & boundingSphere, 
+			InsideOutsideTester const & insideOutsideTester,
+			SphereVolumeTable<double> const * sphereVolumeTable,
+			long long numSamples,
+			std::atomic<int> * nextBlockIndex,
+			std::vector<RandomNumberGenerator> * blockRNGs,
+			ResultsInterior * resultsInterior);
+
+int
+getNumResultsSlots(Parameters const & parameters);
+
+std::string
+getStreamPointsFileName(Parameters const & parameters,
+			std::string const & fileName);
+
+long long
+computeChunkSize(int numThreads, long long numInProcess);
+
+void
+recordIdleTimes(double totalTime,
+		std::vector<double> const & threadBusyTimes,
+		std::vector<double> * threadIdleTimes);
 
 void
 printOutput(Sphere<double> const & boundingSphere,
 	    ResultsInterior const * resultsInterior,
 	    ResultsZeno const * resultsZeno,
 	    Parameters const & parameters, 
+	    Timer const & totalTimer,
+	    ThreadPool * threadPool,
 	    double initializeTime,
 	    double readTime,
 	    double broadcastTime,
 	    double preprocessTime,
 	    double walkTime,
+	    std::vector<double> const & walkIdleTimes,
 	    double reduceTime,
 	    double surfacePreprocessTime,
 	    double sampleTime,
+	    std::vector<double> const & sampleIdleTimes,
 	    double volumeReduceTime);
 
 void
@@ -271,6 +562,13 @@ writePoints(std::string const & fileName,
 	    std::vector<Vector3<double> > const * points,
 	    std::vector<Vector3<char> > const * charges);
 
+void
+formatPoints(std::vector<Vector3<double> > const * points,
+	     std::vector<Vector3<char> > const * charges,
+	     std::size_t startIndex,
+	     std::size_t endIndex,
+	     std::ostream * outputStream);
+
 // ================================================================
 
 int main(int argc, char **argv) {
@@ -301,9 +599,6 @@ int main(int argc, char **argv) {
   parameters.setMpiSize(mpiSize);
   parameters.setMpiRank(mpiRank);
 
-  long long numWalksInProcess   = 0;
-  long long numSamplesInProcess = 0;
-
   double initializeTime = 0;
   double readTime       = 0;
   double broadcastTime  = 0;
@@ -312,15 +607,16 @@ int main(int argc, char **argv) {
 
   bool spheresLoaded = false;
 
+  IndexCache * indexCache = NULL;
+
   initializeTimer.stop();
 
   int getInputSuccess = 
     getInput(argc, argv,
 	     &parameters,
-	     &numWalksInProcess,
-	     &numSamplesInProcess,
 	     &spheres,
 	     &spheresLoaded,
+	     &indexCache,
 	     &initializeTime,
 	     &readTime,
 	     &broadcastTime);
@@ -331,8 +627,14 @@ int main(int argc, char **argv) {
 
   initializeTimer.start();
 
+  ThreadPool threadPool(parameters.getNumThreads());
+
   SpheresModel spheresModel;
 
+  std::vector<Sphere<double> > exposedSpheres;
+
+  SpheresModel exposedSpheresModel;
+
   SpheresNearestSurfacePointFinder * spheresNearestSurfacePointFinder = NULL;
 
   Sphere<double> boundingSphere;
@@ -345,8 +647,11 @@ int main(int argc, char **argv) {
     preprocessWalkOnSpheres(spheresLoaded,
 			    parameters,
 			    spheres,
+			    indexCache,
 			    &boundingSphere,
 			    &spheresModel,
+			    &exposedSpheres,
+			    &exposedSpheresModel,
 			    &spheresNearestSurfacePointFinder,
 			    &preprocessTime);
 
@@ -368,26 +673,16 @@ int main(int argc, char **argv) {
   double walkTime   = 0;
   double reduceTime = 0;
 
-  initializeTimer.stop();
-
-  int getWalkOnSpheresResultsSuccess = 
-    getWalkOnSpheresResults(numWalksInProcess,			
-			    parameters,
-			    boundingSphere,
-			    spheresNearestSurfacePointFinder,			
-			    &threadRNGs,
-			    &resultsZeno,
-			    &walkTime,
-			    &reduceTime);
+  std::vector<double> walkIdleTimes;
 
-  if (getWalkOnSpheresResultsSuccess != 0) {
-    return getWalkOnSpheresResultsSuccess;
-  }
+  initializeTimer.stop();
 
   initializeTimer.start();
 
   SpheresInsideOutsideTester * spheresInsideOutsideTester = NULL;
 
+  SphereVolumeTable<double> * sphereVolumeTable = NULL;
+
   double surfacePreprocessTime = 0;
 
   initializeTimer.stop();
@@ -395,8 +690,10 @@ int main(int argc, char **argv) {
   int preprocessInteriorSuccess = 
     preprocessInterior(spheresLoaded,
 		       parameters,
+		       spheres,
 		       spheresModel,
 		       &spheresInsideOutsideTester,
+		       &sphereVolumeTable,
 		       &surfacePreprocessTime);
 
   if (preprocessInteriorSuccess != 0) {
@@ -410,20 +707,64 @@ int main(int argc, char **argv) {
   double sampleTime       = 0;
   double volumeReduceTime = 0;
 
+  std::vector<double> sampleIdleTimes;
+
   initializeTimer.stop();
 
-  int getInteriorResultsSuccess = 
-    getInteriorResults(numSamplesInProcess,			
-		       parameters,
-		       boundingSphere,
-		       spheresInsideOutsideTester,			
-		       &threadRNGs,
-		       &resultsInterior,
-		       &sampleTime,
-		       &volumeReduceTime);
+  if (parameters.getConcurrentInteriorSampling()) {
+    int getConcurrentResultsSuccess = 
+      getConcurrentResults(parameters,
+			   totalTimer,
+			   &threadPool,
+			   boundingSphere,
+			   spheresNearestSurfacePointFinder,
+			   spheresInsideOutsideTester,
+			   sphereVolumeTable,
+			   &threadRNGs,
+			   &resultsZeno,
+			   &resultsInterior,
+			   &walkTime,
+			   &walkIdleTimes,
+			   &reduceTime,
+			   &volumeReduceTime);
+
+    if (getConcurrentResultsSuccess != 0) {
+      return getConcurrentResultsSuccess;
+    }
+  }
+  else {
+    int getWalkOnSpheresResultsSuccess = 
+      getWalkOnSpheresResults(parameters,
+			      totalTimer,
+			      &threadPool,
+			      boundingSphere,
+			      spheresNearestSurfacePointFinder,			
+			      &threadRNGs,
+			      &resultsZeno,
+			      &walkTime,
+			      &walkIdleTimes,
+			      &reduceTime);
+
+    if (getWalkOnSpheresResultsSuccess != 0) {
+      return getWalkOnSpheresResultsSuccess;
+    }
 
-  if (getInteriorResultsSuccess != 0) {
-    return getInteriorResultsSuccess;
+    int getInteriorResultsSuccess = 
+      getInteriorResults(parameters,
+			 totalTimer,
+			 &threadPool,
+			 boundingSphere,
+			 spheresInsideOutsideTester,			
+			 sphereVolumeTable,
+			 &threadRNGs,
+			 &resultsInterior,
+			 &sampleTime,
+			 &sampleIdleTimes,
+			 &volumeReduceTime);
+
+    if (getInteriorResultsSuccess != 0) {
+      return getInteriorResultsSuccess;
+    }
   }
 
   initializeTime += initializeTimer.getTime();
@@ -432,14 +773,18 @@ int main(int argc, char **argv) {
 	      resultsInterior,
 	      resultsZeno,
 	      parameters,
+	      totalTimer,
+	      &threadPool,
 	      initializeTime,
 	      readTime,
 	      broadcastTime,
 	      preprocessTime,
 	      walkTime,
+	      walkIdleTimes,
 	      reduceTime,
 	      surfacePreprocessTime,
 	      sampleTime,
+	      sampleIdleTimes,
 	      volumeReduceTime);
 
   savePointFiles(*resultsInterior,
@@ -453,6 +798,10 @@ int main(int argc, char **argv) {
 
   delete spheresInsideOutsideTester;
 
+  delete sphereVolumeTable;
+
+  delete indexCache;
+
 #ifdef USE_MPI
   MPI_Finalize();
 #endif
@@ -476,10 +825,9 @@ int main(int argc, char **argv) {
 int
 getInput(int argc, char **argv,
 	 Parameters * parameters,
-	 long long * numWalksInProcess,
-	 long long * numSamplesInProcess,
 	 Spheres<double> * spheres,
 	 bool * spheresLoaded,
+	 IndexCache * * indexCache,
 	 double * initializeTime,
 	 double * readTime,
 	 double * broadcastTime) {
@@ -508,6 +856,14 @@ getInput(int argc, char **argv,
     return 1;
   }
 
+  if (parameters->getDistanceGridSizeWasSet() &&
+      parameters->getDistanceGridSize() < 1) {
+
+    std::cout << "Error: Distance grid size must be positive" << std::endl;
+
+    return 1;
+  }
+
   if (parameters->getComputeFormWasSet() &&
       !(parameters->getTotalNumSamplesWasSet() |
 	parameters->getMaxErrorVolumeWasSet())) {
@@ -518,15 +874,49 @@ getInput(int argc, char **argv,
     return 1;
   }
 
-  *numWalksInProcess = 
-    computeNumInProcess(parameters->getMpiSize(), 
-			parameters->getMpiRank(), 
-			parameters->getTotalNumWalks());
+  if (parameters->getNumDeterministicBlocksWasSet() &&
+      parameters->getNumDeterministicBlocks() < 1) {
+
+    std::cout << "Error: Number of deterministic blocks must be positive"
+	      << std::endl;
+
+    return 1;
+  }
+
+  if (parameters->getMaxFormFactorPointsWasSet() &&
+      parameters->getMaxFormFactorPoints() < 2) {
+
+    std::cout << "Error: Max number of form factor points must be at least 2"
+	      << std::endl;
+
+    return 1;
+  }
+
+  if (parameters->getMaxErrorFormFactorsWasSet() &&
+      parameters->getMaxErrorFormFactors() <= 0) {
+
+    std::cout << "Error: Max standard deviation of form factors must be "
+	      << "positive" << std::endl;
+
+    return 1;
+  }
+
+  if (parameters->getMaxRunTimeWasSet() &&
+      parameters->getMaxRunTime() <= 0) {
+
+    std::cout << "Error: Max run time must be positive" << std::endl;
+
+    return 1;
+  }
+
+  if (parameters->getExteriorRunTimeFraction() <= 0 ||
+      parameters->getExteriorRunTimeFraction() > 1) {
 
-  *numSamplesInProcess = 
-    computeNumInProcess(parameters->getMpiSize(), 
-			parameters->getMpiRank(), 
-			parameters->getTotalNumSamples());
+    std::cout << "Error: Exterior run time fraction must be greater than 0 "
+	      << "and at most 1" << std::endl;
+
+    return 1;
+  }
 
   if (parameters->getPrintBenchmarks() && 
       parameters->getMpiRank() == 0) {
@@ -534,9 +924,17 @@ getInput(int argc, char **argv,
     printRAM("RAM after initialization: ");
   }
 
+  if (!parameters->getIndexCacheDirName().empty()) {
+    *indexCache = new IndexCache(parameters->getIndexCacheDirName(),
+				 parameters->getInputFileName(),
+				 parameters->getFracErrorBound(),
+				 spheresModelName);
+  }
+
   initializeTimer.stop();
 
   getBodData(parameters,
+	     *indexCache,
 	     spheres,
 	     readTime,
 	     broadcastTime);
@@ -558,14 +956,19 @@ getInput(int argc, char **argv,
 }
 
 /// Build the data structure used for the Walk-on-Spheres algorithm from either
-/// voxel or sphere data.
+/// voxel or sphere data.  If buried spheres are pruned, the walks use a 
+/// separate data structure holding only the exposed spheres, and the data
+/// structure holding all spheres is kept for interior sampling.
 ///
 int
 preprocessWalkOnSpheres(bool spheresLoaded,
 			Parameters const & parameters,
 			Spheres<double> const & spheres,
+			IndexCache const * indexCache,
 			Sphere<double> * boundingSphere,
 			SpheresModel * spheresModel,
+			std::vector<Sphere<double> > * exposedSpheres,
+			SpheresModel * exposedSpheresModel,
 			SpheresNearestSurfacePointFinder * *
 			spheresNearestSurfacePointFinder,
 			double * preprocessTime) {
@@ -574,13 +977,81 @@ preprocessWalkOnSpheres(bool spheresLoaded,
   preprocessTimer.start();
 
   if (spheresLoaded) {
-    *boundingSphere = BoundingSphereGenerator::generate(spheres.getVector());
+    if (parameters.getMinimalLaunchSphere()) {
+      *boundingSphere = 
+	MinimalBoundingSphereGenerator::generate(spheres.getVector(),
+						 parameters.getNumThreads());
+    }
+    else {
+      *boundingSphere = BoundingSphereGenerator::generate(spheres.getVector());
+    }
+
+    bool modelLoaded = 
+      (indexCache != NULL) &&
+      indexCache->loadModel(spheres.getVector(), spheresModel);
+
+    if (!modelLoaded) {
+      spheresModel->preprocess(spheres.getVector(), 
+			       parameters.getFracErrorBound(),
+			       parameters.getNumThreads());
+
+      if (indexCache != NULL && 
+	  parameters.getMpiRank() == 0 &&
+	  !indexCache->save(parameters, spheres.getVector(), *spheresModel)) {
+
+	std::cout << "Warning: could not write index cache file " 
+		  << indexCache->getFileName() << std::endl;
+      }
+    }
+
+    if (indexCache != NULL && 
+	parameters.getPrintBenchmarks() && 
+	parameters.getMpiRank() == 0) {
+
+      std::cout << "Index cache file: " << indexCache->getFileName()
+		<< (modelLoaded ? " (loaded)" : " (written)") << std::endl;
+    }
+
+    if (parameters.getPrintBenchmarks() && 
+	parameters.getMpiRank() == 0) {
+
+      spheresModel->printDataStructureStats();
+    }
+
+    SpheresModel const * exteriorSpheresModel = spheresModel;
+
+    if (parameters.getPruneBuriedSpheres()) {
+      BuriedSpherePruner<SpheresModel> pruner(spheres.getVector(),
+					      *spheresModel);
+
+      pruner.findExposedSpheres(parameters.getNumThreads(), exposedSpheres);
+
+      exposedSpheresModel->preprocess(*exposedSpheres,
+				      parameters.getFracErrorBound(),
+				      parameters.getNumThreads());
 
-    spheresModel->preprocess(spheres.getVector(), 
-			     parameters.getFracErrorBound());
+      exteriorSpheresModel = exposedSpheresModel;
+
+      if (parameters.getMpiRank() == 0) {
+	std::cout << "Buried spheres pruned: " 
+		  << spheres.getVector().size() - exposedSpheres->size()
+		  << " of " << spheres.getVector().size() << std::endl;
+
+	if (parameters.getPrintBenchmarks()) {
+	  exposedSpheresModel->printDataStructureStats();
+	}
+      }
+    }
 
     *spheresNearestSurfacePointFinder = 
-      new SpheresNearestSurfacePointFinder(*spheresModel);
+      new SpheresNearestSurfacePointFinder(*exteriorSpheresModel);
+
+    if (parameters.getDistanceGridSizeWasSet()) {
+      (*spheresNearestSurfacePointFinder)->
+	buildDistanceGrid(*boundingSphere,
+			  parameters.getDistanceGridSize(),
+			  parameters.getNumThreads());
+    }
   }
   else {
     std::cout << "Warning: no spheres loaded" << std::endl;
@@ -601,9 +1072,40 @@ preprocessWalkOnSpheres(bool spheresLoaded,
 /// Allocate a random number generator for each thread, ensuring that each has
 /// a unique stream ID across MPI processes.
 ///
+/// When work is divided into deterministic blocks, instead allocate one
+/// generator for the walks of each block owned by this MPI process, followed
+/// by one for the interior samples of each such block.  Stream IDs then depend
+/// only on the block number, not on the number of threads or processes.
+///
 void setupRNGs(Parameters const & parameters,
 	       std::vector<RandomNumberGenerator> * threadRNGs) {
 
+  if (parameters.getNumDeterministicBlocksWasSet()) {
+    int numBlocks = parameters.getNumDeterministicBlocks();
+
+    int numStreams = 2 * numBlocks;
+
+    threadRNGs->reserve(2 * computeNumInProcess(parameters.getMpiSize(), 
+						parameters.getMpiRank(), 
+						numBlocks));
+
+    for (int firstStreamNum = 0; 
+	 firstStreamNum < numStreams; 
+	 firstStreamNum += numBlocks) {
+
+      for (int blockNum = parameters.getMpiRank(); 
+	   blockNum < numBlocks; 
+	   blockNum += parameters.getMpiSize()) {
+
+	threadRNGs->emplace_back(firstStreamNum + blockNum, 
+				 numStreams, 
+				 parameters.getSeed());
+      }
+    }
+
+    return;
+  }
+
   int numStreams = 
     parameters.getNumThreads() * 
     parameters.getMpiSize();
@@ -622,101 +1124,112 @@ void setupRNGs(Parameters const & parameters,
 
 /// Perform Walk-on-Spheres walks until the stopping condition is achieved
 /// (either number of walks or error) and perform a parallel reduction on
-/// the results.
+/// the results.  If a max run time was given, walks are performed in rounds
+/// sized to stop early if needed to leave time for the rest of the run.
 ///
 int
-getWalkOnSpheresResults(long long numWalksInProcess,			
-			Parameters const & parameters,
+getWalkOnSpheresResults(Parameters const & parameters,
+			Timer const & totalTimer,
+			ThreadPool * threadPool,
 			Sphere<double> const & boundingSphere,
 			SpheresNearestSurfacePointFinder const * 
 			spheresNearestSurfacePointFinder,			
 			std::vector<RandomNumberGenerator> * threadRNGs,
 			ResultsZeno * * resultsZeno,
 			double * walkTime,
+			std::vector<double> * walkIdleTimes,
 			double * reduceTime) {
 
   Timer reduceTimer;
 
-  bool saveHitPoints = !parameters.getSurfacePointsFileName().empty();
-
-  if (parameters.getTotalNumWalksWasSet()) {
-
-    *resultsZeno = new ResultsZeno(boundingSphere,
-				   parameters.getNumThreads(),
-				   saveHitPoints);
+  bool saveHitPoints = 
+    !parameters.getSurfacePointsFileName().empty() &&
+    !parameters.getStreamPointsFiles();
 
-    doWalkOnSpheresSelector(parameters,
-			    numWalksInProcess,
-			    boundingSphere, 
-			    spheresNearestSurfacePointFinder,
-			    threadRNGs,
-			    *resultsZeno,
-			    walkTime);
+  bool walksAdaptive = 
+    !parameters.getTotalNumWalksWasSet() &&
+    (parameters.getMaxErrorCapacitanceWasSet() ||
+     parameters.getMaxErrorPolarizabilityWasSet());
 
-    reduceTimer.start();
-    (*resultsZeno)->reduce();
-    reduceTimer.stop();
-  }
-  else if (parameters.getMaxErrorCapacitanceWasSet() ||
-	   parameters.getMaxErrorPolarizabilityWasSet()) {
+  if (parameters.getTotalNumWalksWasSet() || walksAdaptive) {
 
     *resultsZeno = new ResultsZeno(boundingSphere,
-				   parameters.getNumThreads(),
-				   saveHitPoints);
-
-    ResultsCompiler resultsCompiler(parameters);
-
-    long long estimatedNumWalksRemaining = parameters.getMinTotalNumWalks();
+				   getNumResultsSlots(parameters),
+				   saveHitPoints,
+				   parameters.getNumDeterministicBlocksWasSet(),
+				   parameters.getExpectedCharges(),
+				   parameters.getCompensatedSums(),
+				   getStreamPointsFileName
+				   (parameters,
+				    parameters.getSurfacePointsFileName()));
+
+    //leave the interior samples their share of the time, if they follow
+    bool samplesFollow = 
+      parameters.getTotalNumSamplesWasSet() ||
+      parameters.getMaxErrorVolumeWasSet();
+
+    double stopTime = 
+      getRunTimeStopTime(parameters,
+			 totalTimer,
+			 samplesFollow ? 
+			 parameters.getExteriorRunTimeFraction() : 1);
+
+    Timer roundsTimer;
+
+    long long numWalksInRound = walksAdaptive ?
+      parameters.getMinTotalNumWalks() :
+      parameters.getTotalNumWalks();
+
+    //time a small first round before committing to a large one
+    if (parameters.getMaxRunTimeWasSet()) {
+      numWalksInRound = 
+	std::min(numWalksInRound, 
+		 std::max(parameters.getMinTotalNumWalks(), 1LL));
+    }
 
-    while (estimatedNumWalksRemaining > 0) {
+    while (numWalksInRound > 0) {
 
-      long long estimatedNumWalksRemainingInProcess = 
-	computeNumInProcess(parameters.getMpiSize(), 
-			    parameters.getMpiRank(), 
-			    estimatedNumWalksRemaining);
+      roundsTimer.start();
 
       doWalkOnSpheresSelector(parameters,
-			      estimatedNumWalksRemainingInProcess,
+			      threadPool,
+			      numWalksInRound,
 			      boundingSphere, 
 			      spheresNearestSurfacePointFinder,
 			      threadRNGs,
 			      *resultsZeno,
-			      walkTime);
+			      walkTime,
+			      walkIdleTimes);
 
       reduceTimer.start();
       (*resultsZeno)->reduce();
       reduceTimer.stop();
 
-      resultsCompiler.compile(*resultsZeno,
-			      NULL,
-			      boundingSphere,
-			      false);
-
-      long long estimatedTotalNumWalks = 0;
+      roundsTimer.stop();
 
-      long long capacitanceEstimatedTotalNumWalks = 
-  	estimateTotalNum(parameters.getMaxErrorCapacitance(),
-  			 (*resultsZeno)->getNumWalks(),
-  			 resultsCompiler.getCapacitance());
+      long long numWalksSoFar = (*resultsZeno)->getNumWalks();
 
-      estimatedTotalNumWalks = std::max(estimatedTotalNumWalks,
-  					capacitanceEstimatedTotalNumWalks);
+      long long numWalksRemaining = walksAdaptive ?
+	estimateNumWalksRemaining(parameters,
+				  threadPool,
+				  boundingSphere,
+				  **resultsZeno) :
+	parameters.getTotalNumWalks() - numWalksSoFar;
 
-      long long polarizabilityEstimatedTotalNumWalks = 
-  	estimateTotalNum(parameters.getMaxErrorPolarizability(),
-  			 (*resultsZeno)->getNumWalks(),
-  			 resultsCompiler.getMeanPolarizability());
+      double runTimeFraction = 
+	getRoundRunTimeFraction(parameters,
+				totalTimer,
+				stopTime,
+				roundsTimer.getTime() * 
+				numWalksRemaining / numWalksSoFar);
 
-      estimatedTotalNumWalks = std::max(estimatedTotalNumWalks,
-  					polarizabilityEstimatedTotalNumWalks);
+      numWalksInRound = ceil(numWalksRemaining * runTimeFraction);
 
-      estimatedNumWalksRemaining = 
-	estimatedTotalNumWalks - (*resultsZeno)->getNumWalks();
+      if (numWalksRemaining > 0 && numWalksInRound == 0 &&
+	  parameters.getMpiRank() == 0) {
 
-      if (estimatedNumWalksRemaining > 0) {
-	estimatedNumWalksRemaining = 
-	  std::max(estimatedNumWalksRemaining,
-		   parameters.getMinTotalNumWalks());
+	std::cout << "Walks stopped after " << numWalksSoFar 
+		  << " to finish within the max run time" << std::endl;
       }
     }
   }
@@ -733,14 +1246,17 @@ getWalkOnSpheresResults(long long numWalksInProcess,
 }
 
 /// Build the data structure used for the Interior Sampling algorithm from 
-/// either voxel or sphere data.
+/// either voxel or sphere data.  If samples are taken inside the union of
+/// spheres, also build the table used to choose spheres by volume.
 ///
 int
 preprocessInterior(bool spheresLoaded,
 		   Parameters const & parameters,
+		   Spheres<double> const & spheres,
 		   SpheresModel const & spheresModel,
 		   SpheresInsideOutsideTester * *
 		   spheresInsideOutsideTester,
+		   SphereVolumeTable<double> * * sphereVolumeTable,
 		   double * surfacePreprocessTime) {
 
   Timer surfacePreprocessTimer;
@@ -748,6 +1264,10 @@ preprocessInterior(bool spheresLoaded,
 
   if (spheresLoaded) {
     *spheresInsideOutsideTester = new SpheresInsideOutsideTester(spheresModel);
+
+    if (parameters.getUnionInteriorSampling()) {
+      *sphereVolumeTable = new SphereVolumeTable<double>(spheres.getVector());
+    }
   }
 
   surfacePreprocessTimer.stop();
@@ -758,103 +1278,412 @@ preprocessInterior(bool spheresLoaded,
 
 /// Perform Interior samples until the stopping condition is achieved
 /// (either number of walks or error) and perform a parallel reduction on
-/// the results.
+/// the results.  If a max run time was given, samples are taken in rounds
+/// sized to stop early if needed to leave time for the rest of the run.
 ///
 int
-getInteriorResults(long long numSamplesInProcess,			
-		   Parameters const & parameters,
+getInteriorResults(Parameters const & parameters,
+		   Timer const & totalTimer,
+		   ThreadPool * threadPool,
 		   Sphere<double> const & boundingSphere,
 		   SpheresInsideOutsideTester const * 
 		   spheresInsideOutsideTester,			
+		   SphereVolumeTable<double> const * sphereVolumeTable,
 		   std::vector<RandomNumberGenerator> * threadRNGs,
 		   ResultsInterior * * resultsInterior,
 		   double * sampleTime,
+		   std::vector<double> * sampleIdleTimes,
 		   double * volumeReduceTime) {
 
+  //form factors use a reservoir of hit points, if its size was given
   bool saveInteriorPoints = 
-    !parameters.getInteriorPointsFileName().empty() ||
-    parameters.getComputeFormWasSet();
+    (!parameters.getInteriorPointsFileName().empty() &&
+     !parameters.getStreamPointsFiles()) ||
+    (parameters.getComputeFormWasSet() &&
+     !parameters.getMaxFormFactorPointsWasSet());
+
+  long long reservoirSize = 
+    (parameters.getComputeFormWasSet() &&
+     parameters.getMaxFormFactorPointsWasSet()) ?
+    parameters.getMaxFormFactorPoints() : 0;
+
+  double sampledVolume = (sphereVolumeTable != NULL) ?
+    sphereVolumeTable->getTotalVolume() :
+    boundingSphere.getVolume();
 
   Timer volumeReduceTimer;
 
-  if (parameters.getTotalNumSamplesWasSet()) {
+  bool samplesAdaptive = 
+    !parameters.getTotalNumSamplesWasSet() &&
+    parameters.getMaxErrorVolumeWasSet();
+
+  if (parameters.getTotalNumSamplesWasSet() || samplesAdaptive) {
+
+    *resultsInterior = 
+      new ResultsInterior(getNumResultsSlots(parameters),
+			  sampledVolume,
+			  saveInteriorPoints,
+			  reservoirSize,
+			  parameters.getNumDeterministicBlocksWasSet(),
+			  parameters.getCompensatedSums(),
+			  getStreamPointsFileName
+			  (parameters,
+			   parameters.getInteriorPointsFileName()));
+
+    double stopTime = getRunTimeStopTime(parameters, totalTimer, 1);
+
+    double formFactorPairRate = 0;
+
+    double maxFormFactorTime = 
+      getMaxFormFactorTime(parameters,
+			   totalTimer,
+			   threadPool,
+			   boundingSphere,
+			   stopTime,
+			   &formFactorPairRate);
+
+    Timer roundsTimer;
+
+    long long numSamplesInRound = samplesAdaptive ?
+      parameters.getMinTotalNumSamples() :
+      parameters.getTotalNumSamples();
+
+    //time a small first round before committing to a large one
+    if (parameters.getMaxRunTimeWasSet()) {
+      numSamplesInRound = 
+	std::min(numSamplesInRound, 
+		 std::max(parameters.getMinTotalNumSamples(), 1LL));
+    }
+
+    while (numSamplesInRound > 0) {
 
-    *resultsInterior = new ResultsInterior(parameters.getNumThreads(),
-					   saveInteriorPoints);
+      roundsTimer.start();
 
-    doInteriorSamplingSelector(parameters,
-			       numSamplesInProcess,
-			       boundingSphere,
-			       spheresInsideOutsideTester,
-			       threadRNGs,
-			       *resultsInterior,
-			       sampleTime);
+      doInteriorSamplingSelector(parameters,
+				 threadPool,
+				 numSamplesInRound,
+				 boundingSphere, 
+				 spheresInsideOutsideTester,
+				 sphereVolumeTable,
+				 threadRNGs,
+				 *resultsInterior,
+				 sampleTime,
+				 sampleIdleTimes);
+
+      volumeReduceTimer.start();
+      (*resultsInterior)->reduce();
+      volumeReduceTimer.stop();
+
+      roundsTimer.stop();
+
+      long long numSamplesSoFar = (*resultsInterior)->getNumSamples();
+
+      long long numSamplesRemaining = samplesAdaptive ?
+	estimateNumSamplesRemaining(parameters,
+				    threadPool,
+				    boundingSphere,
+				    **resultsInterior) :
+	parameters.getTotalNumSamples() - numSamplesSoFar;
 
+      //form factors over the expected points must also finish in time
+      double formFactorTime = 
+	getFormFactorTime(parameters,
+			  **resultsInterior,
+			  numSamplesRemaining,
+			  formFactorPairRate,
+			  maxFormFactorTime);
+
+      double runTimeFraction = 
+	getRoundRunTimeFraction(parameters,
+				totalTimer,
+				stopTime - formFactorTime,
+				roundsTimer.getTime() * 
+				numSamplesRemaining / numSamplesSoFar);
+
+      numSamplesInRound = ceil(numSamplesRemaining * runTimeFraction);
+
+      if (numSamplesRemaining > 0 && numSamplesInRound == 0 &&
+	  parameters.getMpiRank() == 0) {
+
+	std::cout << "Interior samples stopped after " << numSamplesSoFar 
+		  << " to finish within the max run time" << std::endl;
+      }
+    }
+  }
+
+  if (parameters.getComputeFormWasSet()) {
     volumeReduceTimer.start();
-    (*resultsInterior)->reduce();
+    (*resultsInterior)->gatherHitPointsFromAllProcesses();
     volumeReduceTimer.stop();
   }
-  else if (parameters.getMaxErrorVolumeWasSet()) {
 
-    *resultsInterior = new ResultsInterior(parameters.getNumThreads(),
-					   saveInteriorPoints);
+  if (parameters.getPrintBenchmarks() && 
+      parameters.getMpiRank() == 0) {
+
+    printRAM("RAM after interior samples: ");
+  }
+
+  *volumeReduceTime = volumeReduceTimer.getTime();
+
+  return 0;
+}
+
+/// Performs Walk-on-Spheres walks and Interior samples at the same time on
+/// the given thread pool, in rounds, until each has achieved its own stopping
+/// condition (either number or error), and performs a parallel reduction on
+/// the results after each round.  The time for both is recorded as walk time.
+/// If a max run time was given, both are scaled down by the same fraction in
+/// rounds that would not finish in time.
+///
+int
+getConcurrentResults(Parameters const & parameters,
+		     Timer const & totalTimer,
+		     ThreadPool * threadPool,
+		     Sphere<double> const & boundingSphere,
+		     SpheresNearestSurfacePointFinder const * 
+		     spheresNearestSurfacePointFinder,
+		     SpheresInsideOutsideTester const * 
+		     spheresInsideOutsideTester,
+		     SphereVolumeTable<double> const * sphereVolumeTable,
+		     std::vector<RandomNumberGenerator> * threadRNGs,
+		     ResultsZeno * * resultsZeno,
+		     ResultsInterior * * resultsInterior,
+		     double * walkTime,
+		     std::vector<double> * idleTimes,
+		     double * reduceTime,
+		     double * volumeReduceTime) {
+
+  assert(spheresNearestSurfacePointFinder != NULL &&
+	 spheresInsideOutsideTester != NULL);
+
+  Timer reduceTimer;
+  Timer volumeReduceTimer;
+
+  bool saveHitPoints = 
+    !parameters.getSurfacePointsFileName().empty() &&
+    !parameters.getStreamPointsFiles();
+
+  //form factors use a reservoir of hit points, if its size was given
+  bool saveInteriorPoints = 
+    (!parameters.getInteriorPointsFileName().empty() &&
+     !parameters.getStreamPointsFiles()) ||
+    (parameters.getComputeFormWasSet() &&
+     !parameters.getMaxFormFactorPointsWasSet());
+
+  long long reservoirSize = 
+    (parameters.getComputeFormWasSet() &&
+     parameters.getMaxFormFactorPointsWasSet()) ?
+    parameters.getMaxFormFactorPoints() : 0;
+
+  double sampledVolume = (sphereVolumeTable != NULL) ?
+    sphereVolumeTable->getTotalVolume() :
+    boundingSphere.getVolume();
+
+  bool walksAdaptive = 
+    !parameters.getTotalNumWalksWasSet() &&
+    (parameters.getMaxErrorCapacitanceWasSet() ||
+     parameters.getMaxErrorPolarizabilityWasSet());
+
+  bool samplesAdaptive = 
+    !parameters.getTotalNumSamplesWasSet() &&
+    parameters.getMaxErrorVolumeWasSet();
+
+  bool walksLeft   = parameters.getTotalNumWalksWasSet()   || walksAdaptive;
+  bool samplesLeft = parameters.getTotalNumSamplesWasSet() || samplesAdaptive;
+
+  if (walksLeft) {
+    *resultsZeno = new ResultsZeno(boundingSphere,
+				   getNumResultsSlots(parameters),
+				   saveHitPoints,
+				   parameters.getNumDeterministicBlocksWasSet(),
+				   parameters.getExpectedCharges(),
+				   parameters.getCompensatedSums(),
+				   getStreamPointsFileName
+				   (parameters,
+				    parameters.getSurfacePointsFileName()));
+  }
+
+  if (samplesLeft) {
+    *resultsInterior = 
+      new ResultsInterior(getNumResultsSlots(parameters),
+			  sampledVolume,
+			  saveInteriorPoints,
+			  reservoirSize,
+			  parameters.getNumDeterministicBlocksWasSet(),
+			  parameters.getCompensatedSums(),
+			  getStreamPointsFileName
+			  (parameters,
+			   parameters.getInteriorPointsFileName()));
+  }
 
-    ResultsCompiler resultsCompiler(parameters);
+  long long numWalksInRound = walksAdaptive ?
+    parameters.getMinTotalNumWalks() :
+    parameters.getTotalNumWalks();
 
-    long long estimatedNumSamplesRemaining = parameters.getMinTotalNumSamples();
+  long long numSamplesInRound = samplesAdaptive ?
+    parameters.getMinTotalNumSamples() :
+    parameters.getTotalNumSamples();
 
-    while (estimatedNumSamplesRemaining > 0) {
+  double stopTime = getRunTimeStopTime(parameters, totalTimer, 1);
 
-      long long estimatedNumSamplesRemainingInProcess = 
-	computeNumInProcess(parameters.getMpiSize(), 
-			    parameters.getMpiRank(), 
-			    estimatedNumSamplesRemaining);
+  double formFactorPairRate = 0;
 
-      doInteriorSamplingSelector(parameters,
-				 estimatedNumSamplesRemainingInProcess,
-				 boundingSphere, 
-				 spheresInsideOutsideTester,
+  double maxFormFactorTime = samplesLeft ?
+    getMaxFormFactorTime(parameters,
+			 totalTimer,
+			 threadPool,
+			 boundingSphere,
+			 stopTime,
+			 &formFactorPairRate) : 0;
+
+  Timer roundsTimer;
+
+  //time a small first round before committing to a large one
+  if (parameters.getMaxRunTimeWasSet()) {
+    numWalksInRound = 
+      std::min(numWalksInRound, 
+	       std::max(parameters.getMinTotalNumWalks(), 1LL));
+
+    numSamplesInRound = 
+      std::min(numSamplesInRound, 
+	       std::max(parameters.getMinTotalNumSamples(), 1LL));
+  }
+
+  while (walksLeft || samplesLeft) {
+
+    roundsTimer.start();
+
+    if (parameters.getNumDeterministicBlocksWasSet()) {
+      doConcurrentSamplingBlocks(parameters,
+				 threadPool,
+				 walksLeft ? numWalksInRound : 0,
+				 samplesLeft ? numSamplesInRound : 0,
+				 boundingSphere,
+				 *spheresNearestSurfacePointFinder,
+				 *spheresInsideOutsideTester,
+				 sphereVolumeTable,
 				 threadRNGs,
+				 *resultsZeno,
 				 *resultsInterior,
-				 sampleTime);
+				 walkTime,
+				 idleTimes);
+    }
+    else {
+      doConcurrentSampling(threadPool,
+			   walksLeft ? 
+			   computeNumInProcess(parameters.getMpiSize(), 
+					       parameters.getMpiRank(), 
+					       numWalksInRound) : 0,
+			   samplesLeft ? 
+			   computeNumInProcess(parameters.getMpiSize(), 
+					       parameters.getMpiRank(), 
+					       numSamplesInRound) : 0,
+			   boundingSphere,
+			   *spheresNearestSurfacePointFinder,
+			   *spheresInsideOutsideTester,
+			   sphereVolumeTable,
+			   parameters.getFracErrorBound(),
+			   parameters.getSkinThickness(),
+			   threadRNGs,
+			   *resultsZeno,
+			   *resultsInterior,
+			   walkTime,
+			   idleTimes);
+    }
+
+    long long numWalksSoFar       = 0;
+    long long numWalksRemaining   = 0;
+    long long numSamplesSoFar     = 0;
+    long long numSamplesRemaining = 0;
+
+    if (walksLeft) {
+      reduceTimer.start();
+      (*resultsZeno)->reduce();
+      reduceTimer.stop();
 
+      numWalksSoFar = (*resultsZeno)->getNumWalks();
+
+      numWalksRemaining = walksAdaptive ?
+	estimateNumWalksRemaining(parameters,
+				  threadPool,
+				  boundingSphere,
+				  **resultsZeno) :
+	parameters.getTotalNumWalks() - numWalksSoFar;
+    }
+
+    if (samplesLeft) {
       volumeReduceTimer.start();
       (*resultsInterior)->reduce();
       volumeReduceTimer.stop();
 
-      resultsCompiler.compile(NULL,
-			      *resultsInterior,
-			      boundingSphere,
-			      false);
+      numSamplesSoFar = (*resultsInterior)->getNumSamples();
 
-      long long estimatedTotalNumSamples = 
-	estimateTotalNum(parameters.getMaxErrorVolume(),
-			 (*resultsInterior)->getNumSamples(),
-			 resultsCompiler.getVolume());
+      numSamplesRemaining = samplesAdaptive ?
+	estimateNumSamplesRemaining(parameters,
+				    threadPool,
+				    boundingSphere,
+				    **resultsInterior) :
+	parameters.getTotalNumSamples() - numSamplesSoFar;
+    }
 
-      estimatedNumSamplesRemaining = 
-	estimatedTotalNumSamples - (*resultsInterior)->getNumSamples();
+    roundsTimer.stop();
 
-      if (estimatedNumSamplesRemaining > 0) {
-	estimatedNumSamplesRemaining = 
-	  std::max(estimatedNumSamplesRemaining,
-		   parameters.getMinTotalNumSamples());
-      }
+    //the round time is bounded by the time of all rounds so far scaled by
+    //the larger of the two ratios of remaining to completed work
+    double workRatio = 0;
+
+    if (numWalksRemaining > 0) {
+      workRatio = std::max(workRatio, 
+			   (double)numWalksRemaining / numWalksSoFar);
+    }
+
+    if (numSamplesRemaining > 0) {
+      workRatio = std::max(workRatio, 
+			   (double)numSamplesRemaining / numSamplesSoFar);
+    }
+
+    //form factors over the expected points must also finish in time
+    double formFactorTime = (*resultsInterior != NULL) ?
+      getFormFactorTime(parameters,
+			**resultsInterior,
+			numSamplesRemaining,
+			formFactorPairRate,
+			maxFormFactorTime) : 0;
+
+    double runTimeFraction = 
+      getRoundRunTimeFraction(parameters,
+			      totalTimer,
+			      stopTime - formFactorTime,
+			      roundsTimer.getTime() * workRatio);
+
+    numWalksInRound   = ceil(numWalksRemaining * runTimeFraction);
+    numSamplesInRound = ceil(numSamplesRemaining * runTimeFraction);
+
+    if (runTimeFraction == 0 && workRatio > 0 &&
+	parameters.getMpiRank() == 0) {
+
+      std::cout << "Walks and interior samples stopped after " 
+		<< numWalksSoFar << " and " << numSamplesSoFar
+		<< " to finish within the max run time" << std::endl;
     }
+
+    walksLeft   = (numWalksInRound > 0);
+    samplesLeft = (numSamplesInRound > 0);
   }
 
   if (parameters.getComputeFormWasSet()) {
     volumeReduceTimer.start();
-    (*resultsInterior)->gatherHitPoints();
+    (*resultsInterior)->gatherHitPointsFromAllProcesses();
     volumeReduceTimer.stop();
   }
 
   if (parameters.getPrintBenchmarks() && 
       parameters.getMpiRank() == 0) {
 
-    printRAM("RAM after interior samples: ");
+    printRAM("RAM after walk on spheres and interior samples: ");
   }
 
+  *reduceTime       = reduceTimer.getTime();
   *volumeReduceTime = volumeReduceTimer.getTime();
 
   return 0;
@@ -903,10 +1732,12 @@ parseBodFile(Parameters * parameters,
 }
 
 /// Gets the data from the bod file given as input either by parsing the file
-/// or by an MPI brodcast, depending on the MPI rank of the process.
+/// (or reading it from the index cache, if one is given) or by an MPI 
+/// brodcast, depending on the MPI rank of the process.
 ///
 void
 getBodData(Parameters * parameters,
+	   IndexCache const * indexCache,
 	   Spheres<double> * spheres,
 	   double * readTime,
 	   double * broadcastTime) {
@@ -916,7 +1747,13 @@ getBodData(Parameters * parameters,
 
   if (parameters->getMpiRank() == 0) {
     readTimer.start();
-    parseBodFile(parameters, spheres);
+
+    if (indexCache == NULL || 
+	!indexCache->loadInput(parameters, spheres)) {
+
+      parseBodFile(parameters, spheres);
+    }
+
     readTimer.stop();
 
     broadcastTimer.start();
@@ -986,41 +1823,277 @@ estimateTotalNum(double requestedError,
   return estimatedTotalNum;
 }
 
-/// Makes a call to the doWalkOnSpheres function with either sphere or voxel
-/// data, depending which is not NULL.
+/// Estimates how many more Walk-on-Spheres walks are needed to acheive the
+/// requested capacitance and polarizability errors, given the reduced results
+/// so far.  Returns 0 if no more are needed.
 ///
-void 
-doWalkOnSpheresSelector(Parameters const & parameters,
-			long long numWalksInProcess,
-			Sphere<double> const & boundingSphere, 
-			SpheresNearestSurfacePointFinder const * 
-			spheresNearestSurfacePointFinder,
-			std::vector<RandomNumberGenerator> * threadRNGs,
-			ResultsZeno * resultsZeno,
-			double * walkTime) {
+long long 
+estimateNumWalksRemaining(Parameters const & parameters,
+			  ThreadPool * threadPool,
+			  Sphere<double> const & boundingSphere,
+			  ResultsZeno const & resultsZeno) {
+
+  ResultsCompiler resultsCompiler(parameters, threadPool);
+
+  resultsCompiler.compile(&resultsZeno,
+			  NULL,
+			  boundingSphere,
+			  false,
+			  std::numeric_limits<double>::infinity());
+
+  long long estimatedTotalNumWalks = 0;
+
+  long long capacitanceEstimatedTotalNumWalks = 
+    estimateTotalNum(parameters.getMaxErrorCapacitance(),
+		     resultsZeno.getNumWalks(),
+		     resultsCompiler.getCapacitance());
+
+  estimatedTotalNumWalks = std::max(estimatedTotalNumWalks,
+				    capacitanceEstimatedTotalNumWalks);
+
+  long long polarizabilityEstimatedTotalNumWalks = 
+    estimateTotalNum(parameters.getMaxErrorPolarizability(),
+		     resultsZeno.getNumWalks(),
+		     resultsCompiler.getMeanPolarizability());
+
+  estimatedTotalNumWalks = std::max(estimatedTotalNumWalks,
+				    polarizabilityEstimatedTotalNumWalks);
+
+  long long estimatedNumWalksRemaining = 
+    estimatedTotalNumWalks - resultsZeno.getNumWalks();
+
+  if (estimatedNumWalksRemaining > 0) {
+    estimatedNumWalksRemaining = 
+      std::max(estimatedNumWalksRemaining,
+	       parameters.getMinTotalNumWalks());
+  }
+
+  return std::max(estimatedNumWalksRemaining, 0LL);
+}
+
+/// Estimates how many more Interior samples are needed to acheive the
+/// requested volume error, given the reduced results so far.  Returns 0 if no
+/// more are needed.
+///
+long long 
+estimateNumSamplesRemaining(Parameters const & parameters,
+			    ThreadPool * threadPool,
+			    Sphere<double> const & boundingSphere,
+			    ResultsInterior const & resultsInterior) {
+
+  ResultsCompiler resultsCompiler(parameters, threadPool);
+
+  resultsCompiler.compile(NULL,
+			  &resultsInterior,
+			  boundingSphere,
+			  false,
+			  std::numeric_limits<double>::infinity());
+
+  long long estimatedTotalNumSamples = 
+    estimateTotalNum(parameters.getMaxErrorVolume(),
+		     resultsInterior.getNumSamples(),
+		     resultsCompiler.getVolume());
+
+  long long estimatedNumSamplesRemaining = 
+    estimatedTotalNumSamples - resultsInterior.getNumSamples();
+
+  if (estimatedNumSamplesRemaining > 0) {
+    estimatedNumSamplesRemaining = 
+      std::max(estimatedNumSamplesRemaining,
+	       parameters.getMinTotalNumSamples());
+  }
+
+  return std::max(estimatedNumSamplesRemaining, 0LL);
+}
+
+/// Returns the time on the total timer by which walks or samples should stop
+/// in order to finish the run within the max run time.  This leaves time at
+/// the end for computing and writing results, and gives the caller the given
+/// fraction of the time left until then.  Returns infinity if no max run time
+/// was set.
+///
+double
+getRunTimeStopTime(Parameters const & parameters,
+		   Timer const & totalTimer,
+		   double runTimeFraction) {
+
+  if (!parameters.getMaxRunTimeWasSet()) {
+    return std::numeric_limits<double>::infinity();
+  }
+
+  double maxRunTime = parameters.getMaxRunTime();
+
+  double outputTime = std::min(0.05 * maxRunTime, 60.);
+
+  double currentTime = totalTimer.getTime();
+
+  double timeLeft = std::max(maxRunTime - outputTime - currentTime, 0.);
+
+  return currentTime + runTimeFraction * timeLeft;
+}
+
+/// Returns the fraction of the remaining walks or samples to perform in the
+/// next round, given the predicted time for performing all of them, so that
+/// the rounds stop by the given stop time.  A round that would not finish
+/// with a margin to spare is cut to use half of the time left, so rounds
+/// approach the stop time geometrically.  Returns 0 once the time left is
+/// too short for a useful round.  The decision is made by MPI process 0 so
+/// that all processes agree.
+///
+double
+getRoundRunTimeFraction(Parameters const & parameters,
+			Timer const & totalTimer,
+			double stopTime,
+			double predictedRoundTime) {
+
+  if (!parameters.getMaxRunTimeWasSet()) {
+    return 1;
+  }
+
+  double runTimeFraction = 0;
+
+  if (parameters.getMpiRank() == 0) {
+    double timeLeft = stopTime - totalTimer.getTime();
+
+    double minRoundTime = 0.01 * parameters.getMaxRunTime();
+
+    if (predictedRoundTime <= 0.9 * timeLeft) {
+      runTimeFraction = 1;
+    }
+    else if (timeLeft / 2 >= minRoundTime) {
+      runTimeFraction = timeLeft / 2 / predictedRoundTime;
+    }
+  }
+
+#ifdef USE_MPI
+  MPI_Bcast(&runTimeFraction, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+#endif
 
-  if (spheresNearestSurfacePointFinder != NULL) {
-    doWalkOnSpheres(parameters.getNumThreads(),
-		    numWalksInProcess,
+  return runTimeFraction;
+}
+
+/// Returns the most time that interior samples should leave before the given
+/// stop time for computing form factors, which is half of the time left until
+/// then, and measures the rate at which form factors are computed over pairs
+/// of points.  Form factors that would take longer are estimated from random
+/// pairs in the time left.  Returns 0, with a rate of 0, unless form factors
+/// are computed under a max run time.  Every process must call this.
+///
+double
+getMaxFormFactorTime(Parameters const & parameters,
+		     Timer const & totalTimer,
+		     ThreadPool * threadPool,
+		     Sphere<double> const & boundingSphere,
+		     double stopTime,
+		     double * formFactorPairRate) {
+
+  *formFactorPairRate = 0;
+
+  if (!parameters.getComputeFormWasSet() ||
+      !parameters.getMaxRunTimeWasSet()) {
+
+    return 0;
+  }
+
+  ResultsCompiler resultsCompiler(parameters, threadPool);
+
+  *formFactorPairRate = 
+    resultsCompiler.measureFormFactorPairRate(boundingSphere);
+
+  return 0.5 * std::max(stopTime - totalTimer.getTime(), 0.);
+}
+
+/// Returns the time to leave for computing form factors over all pairs of the
+/// interior points expected once the given number of remaining samples are
+/// taken, at the given rate, but at most the given max time.  Each hit point
+/// is kept with probability equal to its weight, so the weighted number of
+/// hits so far gives the expected number of points.
+///
+double
+getFormFactorTime(Parameters const & parameters,
+		  ResultsInterior const & resultsInterior,
+		  long long numSamplesRemaining,
+		  double formFactorPairRate,
+		  double maxFormFactorTime) {
+
+  if (formFactorPairRate <= 0 || resultsInterior.getNumSamples() == 0) {
+    return 0;
+  }
+
+  double expectedNumPoints = 
+    resultsInterior.getNumHits().getMean() *
+    (resultsInterior.getNumSamples() + numSamplesRemaining) / 
+    resultsInterior.getNumSamples();
+
+  if (parameters.getMaxFormFactorPointsWasSet()) {
+    expectedNumPoints = 
+      std::min<double>(expectedNumPoints, 
+		       parameters.getMaxFormFactorPoints());
+  }
+
+  double expectedNumPairs = 
+    expectedNumPoints * std::max(expectedNumPoints - 1, 0.) / 2;
+
+  //with the margin that ResultsCompiler leaves before sampling pairs instead
+  double formFactorTime = expectedNumPairs / (0.9 * formFactorPairRate);
+
+  return std::min(formFactorTime, maxFormFactorTime);
+}
+
+/// Makes a call to the doWalkOnSpheres function with either sphere or voxel
+/// data, depending which is not NULL.  The given number of walks is the total
+/// across all MPI processes, and is divided either evenly between the
+/// processes or into deterministic blocks.
+///
+void 
+doWalkOnSpheresSelector(Parameters const & parameters,
+			ThreadPool * threadPool,
+			long long numWalks,
+			Sphere<double> const & boundingSphere, 
+			SpheresNearestSurfacePointFinder const * 
+			spheresNearestSurfacePointFinder,
+			std::vector<RandomNumberGenerator> * threadRNGs,
+			ResultsZeno * resultsZeno,
+			double * walkTime,
+			std::vector<double> * walkIdleTimes) {
+
+  if (spheresNearestSurfacePointFinder != NULL &&
+      parameters.getNumDeterministicBlocksWasSet()) {
+
+    doWalkOnSpheresBlocks(parameters,
+			  threadPool,
+			  numWalks,
+			  boundingSphere, 
+			  *spheresNearestSurfacePointFinder,
+			  threadRNGs,
+			  resultsZeno,
+			  walkTime,
+			  walkIdleTimes);
+  }
+  else if (spheresNearestSurfacePointFinder != NULL) {
+    doWalkOnSpheres(threadPool,
+		    computeNumInProcess(parameters.getMpiSize(), 
+					parameters.getMpiRank(), 
+					numWalks),
 		    boundingSphere, 
 		    *spheresNearestSurfacePointFinder,
 		    parameters.getFracErrorBound(),
 		    parameters.getSkinThickness(),
 		    threadRNGs,
 		    resultsZeno,
-		    walkTime);
+		    walkTime,
+		    walkIdleTimes);
   }
   else {
     assert(0);
   }
 }
 
-/// Launches a set of Walk-on-Spheres walks in each of a set of parallel 
-/// threads.
+/// Launches a set of Walk-on-Spheres walks in each thread of the given pool.
 ///
 template <class NearestSurfacePointFinder>
 void
-doWalkOnSpheres(int numThreads,
+doWalkOnSpheres(ThreadPool * threadPool,
 		long long numWalksInProcess,
 		Sphere<double> const & boundingSphere, 
 		NearestSurfacePointFinder const & 
@@ -1029,49 +2102,44 @@ doWalkOnSpheres(int numThreads,
 		double shellThickness,
 		std::vector<RandomNumberGenerator> * threadRNGs,
 		ResultsZeno * resultsZeno,
-		double * walkTime) {
+		double * walkTime,
+		std::vector<double> * walkIdleTimes) {
 
   Timer walkTimer;
   walkTimer.start();
 
-  std::thread * * threads = new std::thread *[numThreads];
+  int numThreads = threadPool->getNumThreads();
 
-  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+  long long chunkSize = computeChunkSize(numThreads, numWalksInProcess);
 
-    long long numWalksInThread = numWalksInProcess / numThreads;
+  std::atomic<long long> nextWalkNum(0);
 
-    if (threadNum < numWalksInProcess % numThreads) {
-      numWalksInThread ++;
-    }
+  std::vector<double> threadBusyTimes(numThreads, 0);
 
-    threads[threadNum] = 
-      new std::thread(doWalkOnSpheresThread<NearestSurfacePointFinder>,
-		      boundingSphere, 
-		      nearestSurfacePointFinder,
-		      threadNum,
-		      fracErrorBound,
-		      shellThickness,
-		      numWalksInThread,
-		      &(threadRNGs->at(threadNum)),
-		      resultsZeno);
-  }
-
-  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
-    threads[threadNum]->join();
-  }
-
-  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
-    delete threads[threadNum];
-  }
-
-  delete [] threads;
+  threadPool->run([&](int threadNum) {
+      doWalkOnSpheresThread(boundingSphere, 
+			    nearestSurfacePointFinder,
+			    threadNum,
+			    fracErrorBound,
+			    shellThickness,
+			    numWalksInProcess,
+			    chunkSize,
+			    &nextWalkNum,
+			    &(threadRNGs->at(threadNum)),
+			    resultsZeno,
+			    &threadBusyTimes[threadNum]);
+    });
 
   walkTimer.stop();
   *walkTime += walkTimer.getTime();
+
+  recordIdleTimes(walkTimer.getTime(), threadBusyTimes, walkIdleTimes);
 }
 
-/// Launches a given number of Walk-on-Spheres walks and records the results.
-/// Runs in a single thread.
+/// Repeatedly claims the next chunk of the given number of Walk-on-Spheres
+/// walks from the shared counter, launches the walks, and records the results,
+/// until no walks are left.  Runs in a single thread.  Sets the given busy
+/// time to the time spent before running out of walks.
 ///
 template <class NearestSurfacePointFinder>
 void
@@ -1082,8 +2150,14 @@ doWalkOnSpheresThread(Sphere<double> const & boundingSphere,
 		      double fracErrorBound,
 		      double shellThickness,
 		      long long numWalks,
+		      long long chunkSize,
+		      std::atomic<long long> * nextWalkNum,
 		      RandomNumberGenerator * randomNumberGenerator,
-		      ResultsZeno * resultsZeno) {
+		      ResultsZeno * resultsZeno,
+		      double * busyTime) {
+
+  Timer busyTimer;
+  busyTimer.start();
 
   WalkerExterior<double, 
 		 RandomNumberGenerator,
@@ -1096,17 +2170,75 @@ doWalkOnSpheresThread(Sphere<double> const & boundingSphere,
            fracErrorBound,
 	   shellThickness);
 
+  while (doWalkOnSpheresChunk(&walker,
+			      threadNum,
+			      numWalks,
+			      chunkSize,
+			      nextWalkNum,
+			      randomNumberGenerator,
+			      resultsZeno)) {
+  }
+
+  busyTimer.stop();
+  *busyTime = busyTimer.getTime();
+}
+
+/// Claims the next chunk of the given number of Walk-on-Spheres walks from the
+/// shared counter, launches the walks with the given walker, and records the
+/// results.  Returns false without doing anything if no walks are left.
+///
+template <class Walker>
+bool
+doWalkOnSpheresChunk(Walker * walker,
+		     int threadNum,
+		     long long numWalks,
+		     long long chunkSize,
+		     std::atomic<long long> * nextWalkNum,
+		     RandomNumberGenerator * randomNumberGenerator,
+		     ResultsZeno * resultsZeno) {
+
+  long long beginWalkNum = nextWalkNum->fetch_add(chunkSize);
+
+  if (beginWalkNum >= numWalks) {
+    return false;
+  }
+
+  long long endWalkNum = std::min(beginWalkNum + chunkSize, numWalks);
+
+  launchWalks(walker,
+	      threadNum,
+	      endWalkNum - beginWalkNum,
+	      randomNumberGenerator,
+	      resultsZeno);
+
+  return true;
+}
+
+/// Launches the given number of Walk-on-Spheres walks with the given walker,
+/// and records the results under the given thread number.
+///
+template <class Walker>
+void
+launchWalks(Walker * walker,
+	    int threadNum,
+	    long long numWalks,
+	    RandomNumberGenerator * randomNumberGenerator,
+	    ResultsZeno * resultsZeno) {
+
   for (long long walkNum = 0; walkNum < numWalks; walkNum++) {
 
-    bool hitObject = false;
-    int numSteps   = 0;
+    bool hitObject   = false;
+    int numSteps     = 0;
+    int numGridSteps = 0;
 
     Vector3<double> startPoint;
     Vector3<double> endPoint;
     Vector3<double> normal;
 
-    walker.walk(&hitObject, &numSteps,
-		&startPoint, &endPoint, &normal);
+    walker->walk(&hitObject, &numSteps, &numGridSteps,
+		 &startPoint, &endPoint, &normal);
+
+    resultsZeno->recordSteps(threadNum, numSteps, numGridSteps);
 
     if (hitObject) {
       resultsZeno->recordHit(threadNum, 
@@ -1120,106 +2252,202 @@ doWalkOnSpheresThread(Sphere<double> const & boundingSphere,
 }
 
 /// Makes a call to the doInteriorSampling function with either sphere or voxel
-/// data, depending which is not NULL.
+/// data, depending which is not NULL.  The given number of samples is the
+/// total across all MPI processes, and is divided either evenly between the
+/// processes or into deterministic blocks.
 ///
 void
 doInteriorSamplingSelector(Parameters const & parameters,
-			   long long numSamplesInProcess,
+			   ThreadPool * threadPool,
+			   long long numSamples,
 			   Sphere<double> const & boundingSphere,
 			   SpheresInsideOutsideTester const *  
 			   spheresInsideOutsideTester,
+			   SphereVolumeTable<double> const * sphereVolumeTable,
 			   std::vector<RandomNumberGenerator> * threadRNGs,
 			   ResultsInterior * resultsInterior,
-			   double * sampleTime) {
-
-  if (spheresInsideOutsideTester != NULL) {
-    doInteriorSampling(parameters.getNumThreads(),
-		       numSamplesInProcess,
+			   double * sampleTime,
+			   std::vector<double> * sampleIdleTimes) {
+
+  if (spheresInsideOutsideTester != NULL &&
+      parameters.getNumDeterministicBlocksWasSet()) {
+
+    doInteriorSamplingBlocks(parameters,
+			     threadPool,
+			     numSamples,
+			     boundingSphere, 
+			     *spheresInsideOutsideTester,
+			     sphereVolumeTable,
+			     threadRNGs,
+			     resultsInterior,
+			     sampleTime,
+			     sampleIdleTimes);
+  }
+  else if (spheresInsideOutsideTester != NULL) {
+    doInteriorSampling(threadPool,
+		       computeNumInProcess(parameters.getMpiSize(), 
+					   parameters.getMpiRank(), 
+					   numSamples),
 		       boundingSphere, 
 		       *spheresInsideOutsideTester,
+		       sphereVolumeTable,
 		       parameters.getFracErrorBound(),
 		       threadRNGs,
 		       resultsInterior,
-		       sampleTime);
+		       sampleTime,
+		       sampleIdleTimes);
   }
   else {
     assert(0);
   }
 }
 
-/// Launches a set of Interior samples in each of a set of parallel 
-/// threads.
+/// Launches a set of Interior samples in each thread of the given pool.
 ///
 template <class InsideOutsideTester>
 void
-doInteriorSampling(int numThreads,
+doInteriorSampling(ThreadPool * threadPool,
 		   long long numSamplesInProcess,
 		   Sphere<double> const & boundingSphere, 
 		   InsideOutsideTester const & insideOutsideTester,
+		   SphereVolumeTable<double> const * sphereVolumeTable,
 		   double fracErrorBound,
 		   std::vector<RandomNumberGenerator> * threadRNGs,
 		   ResultsInterior * resultsInterior,
-		   double * sampleTime) {
+		   double * sampleTime,
+		   std::vector<double> * sampleIdleTimes) {
 
   Timer sampleTimer;
   sampleTimer.start();
 
-  std::thread * * threads = new std::thread *[numThreads];
-
-  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+  int numThreads = threadPool->getNumThreads();
 
-    long long numSamplesInThread = numSamplesInProcess / numThreads;
+  long long chunkSize = computeChunkSize(numThreads, numSamplesInProcess);
 
-    if (threadNum < numSamplesInProcess % numThreads) {
-      numSamplesInThread ++;
-    }
-
-    threads[threadNum] = 
-      new std::thread(doInteriorSamplingThread<InsideOutsideTester>,
-		      boundingSphere, 
-		      insideOutsideTester,
-		      threadNum,
-		      fracErrorBound,
-		      numSamplesInThread,
-		      &(threadRNGs->at(threadNum)),
-		      resultsInterior);
-  }
-
-  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
-    threads[threadNum]->join();
-  }
+  std::atomic<long long> nextSampleNum(0);
 
-  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
-    delete threads[threadNum];
-  }
+  std::vector<double> threadBusyTimes(numThreads, 0);
 
-  delete [] threads;
+  threadPool->run([&](int threadNum) {
+      doInteriorSamplingThread(boundingSphere, 
+			       insideOutsideTester,
+			       sphereVolumeTable,
+			       threadNum,
+			       fracErrorBound,
+			       numSamplesInProcess,
+			       chunkSize,
+			       &nextSampleNum,
+			       &(threadRNGs->at(threadNum)),
+			       resultsInterior,
+			       &threadBusyTimes[threadNum]);
+    });
 
   sampleTimer.stop();
   *sampleTime += sampleTimer.getTime();
+
+  recordIdleTimes(sampleTimer.getTime(), threadBusyTimes, sampleIdleTimes);
 }
 
-/// Performs a given number of Interior samples and records the results.
-/// Runs in a single thread.
+/// Repeatedly claims the next chunk of the given number of Interior samples
+/// from the shared counter, takes the samples, and records the results, until
+/// no samples are left.  Runs in a single thread.  Sets the given busy time to
+/// the time spent before running out of samples.
 ///
 template <class InsideOutsideTester>
 void
 doInteriorSamplingThread(Sphere<double> const & boundingSphere, 
 			 InsideOutsideTester const & insideOutsideTester,
+			 SphereVolumeTable<double> const * sphereVolumeTable,
 			 int threadNum,
 			 double fracErrorBound,
 			 long long numSamples,
+			 long long chunkSize,
+			 std::atomic<long long> * nextSampleNum,
 			 RandomNumberGenerator * randomNumberGenerator,
-			 ResultsInterior * resultsInterior) {
+			 ResultsInterior * resultsInterior,
+			 double * busyTime) {
 
-  SamplerInterior<double, 
+  Timer busyTimer;
+  busyTimer.start();
+
+  if (sphereVolumeTable != NULL) {
+    SamplerUnion<double, 
 		 RandomNumberGenerator,
 		 InsideOutsideTester,
 		 RandomBallPointGenerator>
-    sampler(randomNumberGenerator, 
-	    boundingSphere, 
-	    insideOutsideTester,
-	    fracErrorBound);
+      sampler(randomNumberGenerator, 
+	      *sphereVolumeTable, 
+	      insideOutsideTester);
+
+    while (doInteriorSamplingChunk(&sampler,
+				   threadNum,
+				   numSamples,
+				   chunkSize,
+				   nextSampleNum,
+				   resultsInterior)) {
+    }
+  }
+  else {
+    SamplerInterior<double, 
+		    RandomNumberGenerator,
+		    InsideOutsideTester,
+		    RandomBallPointGenerator>
+      sampler(randomNumberGenerator, 
+	      boundingSphere, 
+	      insideOutsideTester,
+	      fracErrorBound);
+
+    while (doInteriorSamplingChunk(&sampler,
+				   threadNum,
+				   numSamples,
+				   chunkSize,
+				   nextSampleNum,
+				   resultsInterior)) {
+    }
+  }
+
+  busyTimer.stop();
+  *busyTime = busyTimer.getTime();
+}
+
+/// Claims the next chunk of the given number of Interior samples from the
+/// shared counter, takes the samples with the given sampler, and records the
+/// results.  Returns false without doing anything if no samples are left.
+///
+template <class Sampler>
+bool
+doInteriorSamplingChunk(Sampler * sampler,
+			int threadNum,
+			long long numSamples,
+			long long chunkSize,
+			std::atomic<long long> * nextSampleNum,
+			ResultsInterior * resultsInterior) {
+
+  long long beginSampleNum = nextSampleNum->fetch_add(chunkSize);
+
+  if (beginSampleNum >= numSamples) {
+    return false;
+  }
+
+  long long endSampleNum = std::min(beginSampleNum + chunkSize, numSamples);
+
+  takeSamples(sampler,
+	      threadNum,
+	      endSampleNum - beginSampleNum,
+	      resultsInterior);
+
+  return true;
+}
+
+/// Takes the given number of Interior samples with the given sampler, and
+/// records the results under the given thread number.
+///
+template <class Sampler>
+void
+takeSamples(Sampler * sampler,
+	    int threadNum,
+	    long long numSamples,
+	    ResultsInterior * resultsInterior) {
 
   for (long long sampleNum = 0; sampleNum < numSamples; sampleNum++) {
 
@@ -1227,12 +2455,21 @@ doInteriorSamplingThread(Sphere<double> const & boundingSphere,
 
     Vector3<double> hitPoint;
 
-    sampler.sample(&hitObject,
-		   &hitPoint);
+    double hitWeight = 0;
+
+    bool keepHitPoint = false;
+
+    sampler->sample(&hitObject,
+		    &hitPoint,
+		    &hitWeight,
+		    &keepHitPoint);
 
     if (hitObject) {
       resultsInterior->recordHit(threadNum,
-				 hitPoint);
+				 hitPoint,
+				 hitWeight,
+				 keepHitPoint,
+				 sampler->getRandomNumberGenerator());
     }
     else {
       resultsInterior->recordMiss(threadNum);
@@ -1240,24 +2477,609 @@ doInteriorSamplingThread(Sphere<double> const & boundingSphere,
   }
 }
 
+/// Launches a set of Walk-on-Spheres walks and a set of Interior samples at
+/// the same time in each thread of the given pool.
+///
+template <class NearestSurfacePointFinder, class InsideOutsideTester>
+void
+doConcurrentSampling(ThreadPool * threadPool,
+		     long long numWalksInProcess,
+		     long long numSamplesInProcess,
+		     Sphere<double> const & boundingSphere, 
+		     NearestSurfacePointFinder const & 
+		     nearestSurfacePointFinder,
+		     InsideOutsideTester const & insideOutsideTester,
+		     SphereVolumeTable<double> const * sphereVolumeTable,
+		     double fracErrorBound,
+		     double shellThickness,
+		     std::vector<RandomNumberGenerator> * threadRNGs,
+		     ResultsZeno * resultsZeno,
+		     ResultsInterior * resultsInterior,
+		     double * time,
+		     std::vector<double> * idleTimes) {
+
+  Timer timer;
+  timer.start();
+
+  int numThreads = threadPool->getNumThreads();
+
+  long long walkChunkSize = computeChunkSize(numThreads, numWalksInProcess);
+
+  long long sampleChunkSize = 
+    computeChunkSize(numThreads, numSamplesInProcess);
+
+  std::atomic<long long> nextWalkNum(0);
+  std::atomic<long long> nextSampleNum(0);
+
+  std::vector<double> threadBusyTimes(numThreads, 0);
+
+  threadPool->run([&](int threadNum) {
+      doConcurrentSamplingThread(boundingSphere, 
+				 nearestSurfacePointFinder,
+				 insideOutsideTester,
+				 sphereVolumeTable,
+				 threadNum,
+				 fracErrorBound,
+				 shellThickness,
+				 numWalksInProcess,
+				 numSamplesInProcess,
+				 walkChunkSize,
+				 sampleChunkSize,
+				 &nextWalkNum,
+				 &nextSampleNum,
+				 &(threadRNGs->at(threadNum)),
+				 resultsZeno,
+				 resultsInterior,
+				 &threadBusyTimes[threadNum]);
+    });
+
+  timer.stop();
+  *time += timer.getTime();
+
+  recordIdleTimes(timer.getTime(), threadBusyTimes, idleTimes);
+}
+
+/// Alternately claims chunks of Walk-on-Spheres walks and chunks of Interior
+/// samples from the shared counters and performs them, until neither are
+/// left.  Runs in a single thread.  Sets the given busy time to the time spent
+/// before running out of work.
+///
+template <class NearestSurfacePointFinder, class InsideOutsideTester>
+void
+doConcurrentSamplingThread(Sphere<double> const & boundingSphere, 
+			   NearestSurfacePointFinder const & 
+			   nearestSurfacePointFinder,
+			   InsideOutsideTester const & insideOutsideTester,
+			   SphereVolumeTable<double> const * sphereVolumeTable,
+			   int threadNum,
+			   double fracErrorBound,
+			   double shellThickness,
+			   long long numWalks,
+			   long long numSamples,
+			   long long walkChunkSize,
+			   long long sampleChunkSize,
+			   std::atomic<long long> * nextWalkNum,
+			   std::atomic<long long> * nextSampleNum,
+			   RandomNumberGenerator * randomNumberGenerator,
+			   ResultsZeno * resultsZeno,
+			   ResultsInterior * resultsInterior,
+			   double * busyTime) {
+
+  Timer busyTimer;
+  busyTimer.start();
+
+  WalkerExterior<double, 
+		 RandomNumberGenerator,
+		 NearestSurfacePointFinder,
+		 RandomSpherePointGenerator,
+		 BiasedSpherePointGenerator>
+    walker(randomNumberGenerator, 
+	   boundingSphere, 
+           nearestSurfacePointFinder,
+           fracErrorBound,
+	   shellThickness);
+
+  if (sphereVolumeTable != NULL) {
+    SamplerUnion<double, 
+		 RandomNumberGenerator,
+		 InsideOutsideTester,
+		 RandomBallPointGenerator>
+      sampler(randomNumberGenerator, 
+	      *sphereVolumeTable, 
+	      insideOutsideTester);
+
+    doConcurrentSamplingChunks(&walker,
+			       &sampler,
+			       threadNum,
+			       numWalks,
+			       numSamples,
+			       walkChunkSize,
+			       sampleChunkSize,
+			       nextWalkNum,
+			       nextSampleNum,
+			       randomNumberGenerator,
+			       resultsZeno,
+			       resultsInterior);
+  }
+  else {
+    SamplerInterior<double, 
+		    RandomNumberGenerator,
+		    InsideOutsideTester,
+		    RandomBallPointGenerator>
+      sampler(randomNumberGenerator, 
+	      boundingSphere, 
+	      insideOutsideTester,
+	      fracErrorBound);
+
+    doConcurrentSamplingChunks(&walker,
+			       &sampler,
+			       threadNum,
+			       numWalks,
+			       numSamples,
+			       walkChunkSize,
+			       sampleChunkSize,
+			       nextWalkNum,
+			       nextSampleNum,
+			       randomNumberGenerator,
+			       resultsZeno,
+			       resultsInterior);
+  }
+
+  busyTimer.stop();
+  *busyTime = busyTimer.getTime();
+}
+
+/// Alternately claims chunks of Walk-on-Spheres walks and chunks of Interior
+/// samples from the shared counters and performs them with the given walker
+/// and sampler, until neither are left.  Interleaving keeps both kinds of work
+/// in flight on every thread, so neither phase waits on the other.
+///
+template <class Walker, class Sampler>
+void
+doConcurrentSamplingChunks(Walker * walker,
+			   Sampler * sampler,
+			   int threadNum,
+			   long long numWalks,
+			   long long numSamples,
+			   long long walkChunkSize,
+			   long long sampleChunkSize,
+			   std::atomic<long long> * nextWalkNum,
+			   std::atomic<long long> * nextSampleNum,
+			   RandomNumberGenerator * randomNumberGenerator,
+			   ResultsZeno * resultsZeno,
+			   ResultsInterior * resultsInterior) {
+
+  bool walksLeft   = true;
+  bool samplesLeft = true;
+
+  while (walksLeft || samplesLeft) {
+    if (walksLeft) {
+      walksLeft = doWalkOnSpheresChunk(walker,
+				       threadNum,
+				       numWalks,
+				       walkChunkSize,
+				       nextWalkNum,
+				       randomNumberGenerator,
+				       resultsZeno);
+    }
+
+    if (samplesLeft) {
+      samplesLeft = doInteriorSamplingChunk(sampler,
+					    threadNum,
+					    numSamples,
+					    sampleChunkSize,
+					    nextSampleNum,
+					    resultsInterior);
+    }
+  }
+}
+
+/// Launches Walk-on-Spheres walks in each thread of the given pool, one
+/// deterministic block at a time.  The given number of walks is the total
+/// across all MPI processes.
+///
+template <class NearestSurfacePointFinder>
+void
+doWalkOnSpheresBlocks(Parameters const & parameters,
+		      ThreadPool * threadPool,
+		      long long numWalks,
+		      Sphere<double> const & boundingSphere, 
+		      NearestSurfacePointFinder const & 
+		      nearestSurfacePointFinder,
+		      std::vector<RandomNumberGenerator> * blockRNGs,
+		      ResultsZeno * resultsZeno,
+		      double * walkTime,
+		      std::vector<double> * walkIdleTimes) {
+
+  Timer walkTimer;
+  walkTimer.start();
+
+  std::atomic<int> nextBlockIndex(0);
+
+  std::vector<double> threadBusyTimes(threadPool->getNumThreads(), 0);
+
+  threadPool->run([&](int threadNum) {
+      Timer busyTimer;
+      busyTimer.start();
+
+      while (doWalkOnSpheresBlock(parameters,
+				  boundingSphere, 
+				  nearestSurfacePointFinder,
+				  numWalks,
+				  &nextBlockIndex,
+				  blockRNGs,
+				  resultsZeno)) {
+      }
+
+      busyTimer.stop();
+      threadBusyTimes[threadNum] = busyTimer.getTime();
+    });
+
+  walkTimer.stop();
+  *walkTime += walkTimer.getTime();
+
+  recordIdleTimes(walkTimer.getTime(), threadBusyTimes, walkIdleTimes);
+}
+
+/// Takes Interior samples in each thread of the given pool, one deterministic
+/// block at a time.  The given number of samples is the total across all MPI
+/// processes.
+///
+template <class InsideOutsideTester>
+void
+doInteriorSamplingBlocks(Parameters const & parameters,
+			 ThreadPool * threadPool,
+			 long long numSamples,
+			 Sphere<double> const & boundingSphere, 
+			 InsideOutsideTester const & insideOutsideTester,
+			 SphereVolumeTable<double> const * sphereVolumeTable,
+			 std::vector<RandomNumberGenerator> * blockRNGs,
+			 ResultsInterior * resultsInterior,
+			 double * sampleTime,
+			 std::vector<double> * sampleIdleTimes) {
+
+  Timer sampleTimer;
+  sampleTimer.start();
+
+  std::atomic<int> nextBlockIndex(0);
+
+  std::vector<double> threadBusyTimes(threadPool->getNumThreads(), 0);
+
+  threadPool->run([&](int threadNum) {
+      Timer busyTimer;
+      busyTimer.start();
+
+      while (doInteriorSamplingBlock(parameters,
+				     boundingSphere, 
+				     insideOutsideTester,
+				     sphereVolumeTable,
+				     numSamples,
+				     &nextBlockIndex,
+				     blockRNGs,
+				     resultsInterior)) {
+      }
+
+      busyTimer.stop();
+      threadBusyTimes[threadNum] = busyTimer.getTime();
+    });
+
+  sampleTimer.stop();
+  *sampleTime += sampleTimer.getTime();
+
+  recordIdleTimes(sampleTimer.getTime(), threadBusyTimes, sampleIdleTimes);
+}
+
+/// Launches Walk-on-Spheres walks and takes Interior samples at the same time
+/// in each thread of the given pool, alternating between a block of each.  The
+/// given numbers of walks and samples are the totals across all MPI processes.
+///
+template <class NearestSurfacePointFinder, class InsideOutsideTester>
+void
+doConcurrentSamplingBlocks(Parameters const & parameters,
+			   ThreadPool * threadPool,
+			   long long numWalks,
+			   long long numSamples,
+			   Sphere<double> const & boundingSphere, 
+			   NearestSurfacePointFinder const & 
+			   nearestSurfacePointFinder,
+			   InsideOutsideTester const & insideOutsideTester,
+			   SphereVolumeTable<double> const * sphereVolumeTable,
+			   std::vector<RandomNumberGenerator> * blockRNGs,
+			   ResultsZeno * resultsZeno,
+			   ResultsInterior * resultsInterior,
+			   double * time,
+			   std::vector<double> * idleTimes) {
+
+  Timer timer;
+  timer.start();
+
+  std::atomic<int> nextWalkBlockIndex(0);
+  std::atomic<int> nextSampleBlockIndex(0);
+
+  std::vector<double> threadBusyTimes(threadPool->getNumThreads(), 0);
+
+  threadPool->run([&](int threadNum) {
+      Timer busyTimer;
+      busyTimer.start();
+
+      bool walksLeft   = (numWalks > 0);
+      bool samplesLeft = (numSamples > 0);
+
+      while (walksLeft || samplesLeft) {
+	if (walksLeft) {
+	  walksLeft = doWalkOnSpheresBlock(parameters,
+					   boundingSphere, 
+					   nearestSurfacePointFinder,
+					   numWalks,
+					   &nextWalkBlockIndex,
+					   blockRNGs,
+					   resultsZeno);
+	}
+
+	if (samplesLeft) {
+	  samplesLeft = doInteriorSamplingBlock(parameters,
+						boundingSphere, 
+						insideOutsideTester,
+						sphereVolumeTable,
+						numSamples,
+						&nextSampleBlockIndex,
+						blockRNGs,
+						resultsInterior);
+	}
+      }
+
+      busyTimer.stop();
+      threadBusyTimes[threadNum] = busyTimer.getTime();
+    });
+
+  timer.stop();
+  *time += timer.getTime();
+
+  recordIdleTimes(timer.getTime(), threadBusyTimes, idleTimes);
+}
+
+/// Claims the next deterministic block owned by this MPI process from the
+/// shared counter, and launches that block's share of the given total number
+/// of Walk-on-Spheres walks.  Each block uses its own random number generator
+/// and its own results slot, and a fresh walker, so its results depend only
+/// on the block number and not on which thread runs it.  Returns false
+/// without doing anything if no blocks are left.
+///
+template <class NearestSurfacePointFinder>
+bool
+doWalkOnSpheresBlock(Parameters const & parameters,
+		     Sphere<double> const & boundingSphere, 
+		     NearestSurfacePointFinder const & 
+		     nearestSurfacePointFinder,
+		     long long numWalks,
+		     std::atomic<int> * nextBlockIndex,
+		     std::vector<RandomNumberGenerator> * blockRNGs,
+		     ResultsZeno * resultsZeno) {
+
+  int numBlocks = parameters.getNumDeterministicBlocks();
+
+  int blockIndex = nextBlockIndex->fetch_add(1);
+
+  int blockNum = parameters.getMpiRank() + blockIndex * parameters.getMpiSize();
+
+  if (blockNum >= numBlocks) {
+    return false;
+  }
+
+  RandomNumberGenerator * randomNumberGenerator = &(blockRNGs->at(blockIndex));
+
+  WalkerExterior<double, 
+		 RandomNumberGenerator,
+		 NearestSurfacePointFinder,
+		 RandomSpherePointGenerator,
+		 BiasedSpherePointGenerator>
+    walker(randomNumberGenerator, 
+	   boundingSphere, 
+           nearestSurfacePointFinder,
+           parameters.getFracErrorBound(),
+	   parameters.getSkinThickness());
+
+  launchWalks(&walker,
+	      blockNum,
+	      computeNumInProcess(numBlocks, blockNum, numWalks),
+	      randomNumberGenerator,
+	      resultsZeno);
+
+  return true;
+}
+
+/// Claims the next deterministic block owned by this MPI process from the
+/// shared counter, and takes that block's share of the given total number of
+/// Interior samples, using the block's own random number generator and
+/// results slot.  Returns false without doing anything if no blocks are left.
+///
+template <class InsideOutsideTester>
+bool
+doInteriorSamplingBlock(Parameters const & parameters,
+			Sphere<double> const & boundingSphere, 
+			InsideOutsideTester const & insideOutsideTester,
+			SphereVolumeTable<double> const * sphereVolumeTable,
+			long long numSamples,
+			std::atomic<int> * nextBlockIndex,
+			std::vector<RandomNumberGenerator> * blockRNGs,
+			ResultsInterior * resultsInterior) {
+
+  int numBlocks = parameters.getNumDeterministicBlocks();
+
+  int blockIndex = nextBlockIndex->fetch_add(1);
+
+  int blockNum = parameters.getMpiRank() + blockIndex * parameters.getMpiSize();
+
+  if (blockNum >= numBlocks) {
+    return false;
+  }
+
+  //the generators for interior samples follow those for walks
+  int numBlocksInProcess = 
+    computeNumInProcess(parameters.getMpiSize(), 
+			parameters.getMpiRank(), 
+			numBlocks);
+
+  RandomNumberGenerator * randomNumberGenerator = 
+    &(blockRNGs->at(numBlocksInProcess + blockIndex));
+
+  long long numSamplesInBlock = 
+    computeNumInProcess(numBlocks, blockNum, numSamples);
+
+  if (sphereVolumeTable != NULL) {
+    SamplerUnion<double, 
+		 RandomNumberGenerator,
+		 InsideOutsideTester,
+		 RandomBallPointGenerator>
+      sampler(randomNumberGenerator, 
+	      *sphereVolumeTable, 
+	      insideOutsideTester);
+
+    takeSamples(&sampler,
+		blockNum,
+		numSamplesInBlock,
+		resultsInterior);
+  }
+  else {
+    SamplerInterior<double, 
+		    RandomNumberGenerator,
+		    InsideOutsideTester,
+		    RandomBallPointGenerator>
+      sampler(randomNumberGenerator, 
+	      boundingSphere, 
+	      insideOutsideTester,
+	      parameters.getFracErrorBound());
+
+    takeSamples(&sampler,
+		blockNum,
+		numSamplesInBlock,
+		resultsInterior);
+  }
+
+  return true;
+}
+
+/// Returns the number of slots that results are recorded in: one for each
+/// thread, or one for each block when work is divided into deterministic
+/// blocks.
+///
+int
+getNumResultsSlots(Parameters const & parameters) {
+
+  if (parameters.getNumDeterministicBlocksWasSet()) {
+    return parameters.getNumDeterministicBlocks();
+  }
+
+  return parameters.getNumThreads();
+}
+
+/// Returns the name of the file to stream the given points file to, or an
+/// empty string if points files are not being streamed.  With more than one
+/// MPI process, the rank is inserted before any ".gz" suffix so that each
+/// process writes its own file.
+///
+std::string
+getStreamPointsFileName(Parameters const & parameters,
+			std::string const & fileName) {
+
+  if (!parameters.getStreamPointsFiles() || fileName.empty()) {
+    return "";
+  }
+
+  if (parameters.getMpiSize() == 1) {
+    return fileName;
+  }
+
+  std::string const & gzSuffix = PointsWriter::compressedSuffix;
+
+  std::string rankSuffix = "." + std::to_string(parameters.getMpiRank());
+
+  if (fileName.size() > gzSuffix.size() &&
+      fileName.compare(fileName.size() - gzSuffix.size(), 
+		       gzSuffix.size(), gzSuffix) == 0) {
+
+    return 
+      fileName.substr(0, fileName.size() - gzSuffix.size()) + 
+      rankSuffix + gzSuffix;
+  }
+
+  return fileName + rankSuffix;
+}
+
+/// Returns the number of walks or samples that a thread should claim at a
+/// time when the given number are shared between the given number of threads.
+/// Chunks are small enough that threads finish at nearly the same time even
+/// though walk lengths vary widely, but large enough that the shared counter
+/// is rarely contended.
+///
+long long
+computeChunkSize(int numThreads, long long numInProcess) {
+
+  long long chunkSize = numInProcess / (numThreads * numChunksPerThread);
+
+  return std::max(chunkSize, 1LL);
+}
+
+/// Adds the time each thread spent waiting for the others to finish, given the
+/// total time and the time each thread was busy, to the given idle times.
+///
+void
+recordIdleTimes(double totalTime,
+		std::vector<double> const & threadBusyTimes,
+		std::vector<double> * threadIdleTimes) {
+
+  threadIdleTimes->resize(threadBusyTimes.size(), 0);
+
+  for (unsigned int threadNum = 0; 
+       threadNum < threadBusyTimes.size(); 
+       threadNum++) {
+
+    (*threadIdleTimes)[threadNum] += 
+      std::max(totalTime - threadBusyTimes[threadNum], 0.);
+  }
+}
+
 /// Prints parameters, results, and (optionally) detailed running time
-/// benchmarks on MPI process 0.
+/// benchmarks on MPI process 0.  Results are compiled on every process, since
+/// form factors are computed by all processes together.  If a max run time
+/// was given, form factors are limited to the time left before output.
 ///
 void
 printOutput(Sphere<double> const & boundingSphere,
 	    ResultsInterior const * resultsInterior,
 	    ResultsZeno const * resultsZeno,
 	    Parameters const & parameters, 
+	    Timer const & totalTimer,
+	    ThreadPool * threadPool,
 	    double initializeTime,
 	    double readTime,
 	    double broadcastTime,
 	    double preprocessTime,
 	    double walkTime,
+	    std::vector<double> const & walkIdleTimes,
 	    double reduceTime,
 	    double surfacePreprocessTime,
 	    double sampleTime,
+	    std::vector<double> const & sampleIdleTimes,
 	    double volumeReduceTime) {
 
+  //form factors may take the time left until output must start, as seen by
+  //MPI process 0 so that all processes agree
+  double maxFormFactorTime = 
+    getRunTimeStopTime(parameters, totalTimer, 1) - totalTimer.getTime();
+
+#ifdef USE_MPI
+  MPI_Bcast(&maxFormFactorTime, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+#endif
+
+  ResultsCompiler resultsCompiler(parameters, threadPool);
+
+  resultsCompiler.compile(resultsZeno,
+			  resultsInterior,
+			  boundingSphere,
+			  parameters.getComputeFormWasSet(),
+			  maxFormFactorTime);
+
   if (parameters.getMpiRank() == 0) {
     std::cout << std::endl
 	      << "Parameters" << std::endl
@@ -1285,13 +3107,6 @@ printOutput(Sphere<double> const & boundingSphere,
 		<< std::endl;
     }
 
-    ResultsCompiler resultsCompiler(parameters);
-
-    resultsCompiler.compile(resultsZeno,
-			    resultsInterior,
-			    boundingSphere,
-			    parameters.getComputeFormWasSet());
-
     resultsCompiler.print(parameters.getPrintCounts());
 
     if (parameters.getPrintBenchmarks()) {
@@ -1307,6 +3122,47 @@ printOutput(Sphere<double> const & boundingSphere,
 		<< "Volume Sample (s):      " << sampleTime << std::endl
 		<< "Volume Reduce (s):      " << volumeReduceTime << std::endl
 		<< std::endl;
+
+      if (resultsZeno != NULL && resultsZeno->getNumWalks() > 0) {
+	std::cout << "Mean steps per walk:    " 
+		  << resultsZeno->getNumSteps() / resultsZeno->getNumWalks()
+		  << std::endl;
+
+	if (walkTime > 0) {
+	  std::cout << "Walks per second:       " 
+		    << resultsZeno->getNumWalks() / walkTime
+		    << std::endl;
+	}
+
+	if (parameters.getDistanceGridSizeWasSet() &&
+	    resultsZeno->getNumSteps() > 0) {
+
+	  std::cout << "Grid step fraction:     " 
+		    << resultsZeno->getNumGridSteps() / 
+		       resultsZeno->getNumSteps()
+		    << std::endl;
+	}
+
+	std::cout << std::endl;
+      }
+
+      unsigned int numThreads = 
+	std::max(walkIdleTimes.size(), sampleIdleTimes.size());
+
+      for (unsigned int threadNum = 0; threadNum < numThreads; threadNum++) {
+	std::cout << "Thread " << threadNum << " Idle (s):"
+		  << " Exterior Walk " 
+		  << ((threadNum < walkIdleTimes.size()) ? 
+		      walkIdleTimes[threadNum] : 0)
+		  << ", Volume Sample " 
+		  << ((threadNum < sampleIdleTimes.size()) ? 
+		      sampleIdleTimes[threadNum] : 0)
+		  << std::endl;
+      }
+
+      if (numThreads > 0) {
+	std::cout << std::endl;
+      }
     }
   }
 }
@@ -1319,19 +3175,29 @@ savePointFiles(ResultsInterior & resultsInterior,
 	       Parameters const & parameters) {
 
   if (!parameters.getSurfacePointsFileName().empty()) {
-    resultsZeno.gatherHitPoints();
+    if (parameters.getStreamPointsFiles()) {
+      resultsZeno.flushHitPoints();
+    }
+    else {
+      resultsZeno.gatherHitPoints();
 
-    writePoints(parameters.getSurfacePointsFileName(), 
-		resultsZeno.getPoints(), 
-		resultsZeno.getCharges());
+      writePoints(parameters.getSurfacePointsFileName(), 
+		  resultsZeno.getPoints(), 
+		  resultsZeno.getCharges());
+    }
   }
 
   if (!parameters.getInteriorPointsFileName().empty()) {
-    resultsInterior.gatherHitPoints();
+    if (parameters.getStreamPointsFiles()) {
+      resultsInterior.flushHitPoints();
+    }
+    else {
+      resultsInterior.gatherHitPoints();
 
-    writePoints(parameters.getInteriorPointsFileName(), 
-		resultsInterior.getPoints(), 
-		NULL);
+      writePoints(parameters.getInteriorPointsFileName(), 
+		  resultsInterior.getPoints(), 
+		  NULL);
+    }
   }
 }
 
@@ -1376,11 +3242,86 @@ printRAM(std::string const & label) {
 
 /// Writes the given set of points and (if not NULL) charges to disk.
 ///
+/// With MPI, each process passes only its own points.  Every line of text has
+/// the same length, so each process writes at the offset given by the number
+/// of points on lower ranks, and points appear in rank order.  Points are
+/// formatted and written with collective MPI-IO writes a bounded chunk at a
+/// time, so no process holds the text of all its points or any other
+/// process's points.
+///
 void
 writePoints(std::string const & fileName, 
 	    std::vector<Vector3<double> > const * points,
 	    std::vector<Vector3<char> > const * charges) {
 
+#ifdef USE_MPI
+  //three charge characters, three fields of width 16, and a newline
+  const long long lineSize = ((charges != NULL) ? 3 : 0) + 3*16 + 1;
+
+  const long long numPointsPerChunk = 1 << 16;
+
+  long long numPoints      = points->size();
+  long long numPointsBelow = 0;
+
+  MPI_Exscan(&numPoints, &numPointsBelow, 1, MPI_LONG_LONG, MPI_SUM, 
+	     MPI_COMM_WORLD);
+
+  int mpiRank = 0;
+
+  MPI_Comm_rank(MPI_COMM_WORLD, &mpiRank);
+
+  //MPI_Exscan leaves the result on rank 0 undefined
+  if (mpiRank == 0) {
+    numPointsBelow = 0;
+  }
+
+  MPI_File outputFile;
+
+  if (MPI_File_open(MPI_COMM_WORLD, (char *)fileName.c_str(), 
+		    MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL,
+		    &outputFile) != MPI_SUCCESS) {
+
+    std::cout << "Error opening output file " << fileName << std::endl;
+    exit(1);
+  }
+
+  MPI_File_set_size(outputFile, 0);
+
+  //the writes are collective, so every process makes the same number of them
+  long long numChunks = 
+    (numPoints + numPointsPerChunk - 1) / numPointsPerChunk;
+
+  long long maxNumChunks = 0;
+
+  MPI_Allreduce(&numChunks, &maxNumChunks, 1, MPI_LONG_LONG, MPI_MAX,
+		MPI_COMM_WORLD);
+
+  std::ostringstream chunkText;
+
+  for (long long chunkNum = 0; chunkNum < maxNumChunks; chunkNum++) {
+    long long chunkStart = std::min(chunkNum * numPointsPerChunk, numPoints);
+    long long chunkEnd   = std::min(chunkStart + numPointsPerChunk, numPoints);
+
+    chunkText.str("");
+
+    formatPoints(points, charges, chunkStart, chunkEnd, &chunkText);
+
+    std::string const data = chunkText.str();
+
+    if ((long long)data.size() != (chunkEnd - chunkStart) * lineSize) {
+      std::cout << "Error formatting points for output file " << fileName
+		<< std::endl;
+      exit(1);
+    }
+
+    MPI_File_write_at_all(outputFile, 
+			  (numPointsBelow + chunkStart) * lineSize,
+			  (void *)data.data(), (int)data.size(),
+			  MPI_CHAR, MPI_STATUS_IGNORE);
+  }
+
+  MPI_File_close(&outputFile);
+#else
   std::ofstream outputFile;
 
   outputFile.open(fileName, std::ofstream::out);
@@ -1391,20 +3332,34 @@ writePoints(std::string const & fileName,
     exit(1);
   }
 
-  for (unsigned int i = 0; i < points->size(); i++) {
+  formatPoints(points, charges, 0, points->size(), &outputFile);
+
+  outputFile.close();
+#endif
+}
+
+/// Writes the given range of points and (if not NULL) charges as text to the
+/// given stream, one point per line.
+///
+void
+formatPoints(std::vector<Vector3<double> > const * points,
+	     std::vector<Vector3<char> > const * charges,
+	     std::size_t startIndex,
+	     std::size_t endIndex,
+	     std::ostream * outputStream) {
+
+  for (std::size_t i = startIndex; i < endIndex; i++) {
 
     if (charges != NULL) {
-      outputFile << charges->at(i).get(0)
-		 << charges->at(i).get(1)
-		 << charges->at(i).get(2);
+      *outputStream << charges->at(i).get(0)
+		    << charges->at(i).get(1)
+		    << charges->at(i).get(2);
     }
 
-    outputFile << std::setw(16) << points->at(i).get(0)
-	       << std::setw(16) << points->at(i).get(1)
-	       << std::setw(16) << points->at(i).get(2) << std::endl;
+    *outputStream << std::setw(16) << points->at(i).get(0)
+		  << std::setw(16) << points->at(i).get(1)
+		  << std::setw(16) << points->at(i).get(2) << "\n";
   }
-
-  outputFile.close();
 }
 
 // ================================================================
@@ -0,0 +1,291 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+#ifndef BURIED_SPHERE_PRUNER_H
+#define BURIED_SPHERE_PRUNER_H
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+
+#include "../Geometry/Sphere.h"
+#include "../Geometry/Vector3.h"
+
+// ================================================================
+
+/// Finds the spheres that contribute to the surface of a union of spheres.
+/// A sphere whose entire surface lies strictly inside other spheres is
+/// buried: every point on the surface of the union then lies on the surface of
+/// some sphere that is not buried, so the distance from any point outside the
+/// union to the union is unchanged if all buried spheres are removed at once.
+/// Buried spheres can still enclose volume, so they must be kept for interior
+/// sampling.
+///
+/// The surface of each sphere is covered by the cells of a cube map.  A cell
+/// is covered if the point at its center is inside another sphere by more
+/// than a bound on the distance from the center to any point in the cell.
+/// Cells that are partially covered are subdivided up to a maximum depth.  A
+/// sphere is only reported as buried if all its cells are covered, so the
+/// test never removes a sphere that contributes to the surface.
+///
+template <class SphereCenterModel>
+class BuriedSpherePruner
+{
+public:
+  BuriedSpherePruner(std::vector<Sphere<double> > const & spheres,
+		     SphereCenterModel const & sphereCenterModel);
+
+  ~BuriedSpherePruner();
+
+  void findExposedSpheres(int numThreads,
+			  std::vector<Sphere<double> > * exposedSpheres) const;
+
+private:
+  /// Number of cube map cells along each side of each cube face before
+  /// subdivision.
+  ///
+  static const int initialCellsPerSide = 2;
+
+  /// Maximum number of times a cube map cell may be subdivided.
+  ///
+  static const int maxDepth = 6;
+
+  void findBuriedSpheresThread(int threadNum, int numThreads,
+			       std::vector<char> * buried) const;
+
+  bool isBuried(Sphere<double> const & sphere,
+		std::vector<Sphere<double> const *> * neighbors) const;
+
+  bool isCellCovered(Sphere<double> const & sphere,
+		     std::vector<Sphere<double> const *> const & neighbors,
+		     int face, double u, double v, double cellSize,
+		     int depth) const;
+
+  static Vector3<double> getCubeMapDirection(int face, double u, double v);
+
+  std::vector<Sphere<double> > const * spheres;
+
+  SphereCenterModel const * sphereCenterModel;
+};
+
+/// Constructs a pruner for the given spheres.  The given spatial data
+/// structure must contain the same spheres and is used to find neighbors.
+///
+template <class SphereCenterModel>
+BuriedSpherePruner<SphereCenterModel>::
+BuriedSpherePruner(std::vector<Sphere<double> > const & spheres,
+		   SphereCenterModel const & sphereCenterModel)
+  : spheres(&spheres),
+    sphereCenterModel(&sphereCenterModel) {
+
+}
+
+template <class SphereCenterModel>
+BuriedSpherePruner<SphereCenterModel>::
+~BuriedSpherePruner() {
+
+}
+
+/// Computes the list of spheres that are not buried, in their original order,
+/// using the given number of threads.
+///
+template <class SphereCenterModel>
+void
+BuriedSpherePruner<SphereCenterModel>::
+findExposedSpheres(int numThreads,
+		   std::vector<Sphere<double> > * exposedSpheres) const {
+
+  std::vector<char> buried(spheres->size(), 0);
+
+  std::thread * * threads = new std::thread *[numThreads];
+
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    threads[threadNum] =
+      new std::thread(&BuriedSpherePruner::findBuriedSpheresThread,
+		      this, threadNum, numThreads, &buried);
+  }
+
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    threads[threadNum]->join();
+
+    delete threads[threadNum];
+  }
+
+  delete [] threads;
+
+  exposedSpheres->clear();
+
+  for (unsigned int sphereNum = 0; sphereNum < spheres->size(); sphereNum++) {
+    if (!buried[sphereNum]) {
+      exposedSpheres->push_back(spheres->at(sphereNum));
+    }
+  }
+}
+
+template <class SphereCenterModel>
+void
+BuriedSpherePruner<SphereCenterModel>::
+findBuriedSpheresThread(int threadNum, int numThreads,
+			std::vector<char> * buried) const {
+
+  std::vector<Sphere<double> const *> neighbors;
+
+  for (unsigned int sphereNum = threadNum;
+       sphereNum < spheres->size();
+       sphereNum += numThreads) {
+
+    (*buried)[sphereNum] = isBuried(spheres->at(sphereNum), &neighbors);
+  }
+}
+
+/// Returns whether the surface of the given sphere lies strictly inside the
+/// other spheres.  The given list is used as scratch space for neighbors.
+///
+template <class SphereCenterModel>
+bool
+BuriedSpherePruner<SphereCenterModel>::
+isBuried(Sphere<double> const & sphere,
+	 std::vector<Sphere<double> const *> * neighbors) const {
+
+  neighbors->clear();
+
+  for (unsigned int radiusNum = 0;
+       radiusNum < sphereCenterModel->getNumRadii();
+       radiusNum++) {
+
+    sphereCenterModel->findNearbySpheres(radiusNum,
+					 sphere.getCenter(),
+					 sphere.getRadius(),
+					 neighbors);
+  }
+
+  neighbors->erase(std::remove(neighbors->begin(), neighbors->end(), &sphere),
+		   neighbors->end());
+
+  if (neighbors->empty()) {
+    return false;
+  }
+
+  //check the largest neighbors first since they are most likely to cover
+  std::sort(neighbors->begin(), neighbors->end(),
+	    [](Sphere<double> const * a, Sphere<double> const * b) {
+	      return a->getRadius() > b->getRadius();
+	    });
+
+  double cellSize = 2. / initialCellsPerSide;
+
+  for (int face = 0; face < 6; face++) {
+    for (int i = 0; i < initialCellsPerSide; i++) {
+      for (int j = 0; j < initialCellsPerSide; j++) {
+	if (!isCellCovered(sphere, *neighbors, face,
+			   -1 + i * cellSize, -1 + j * cellSize, cellSize,
+			   0)) {
+	  return false;
+	}
+      }
+    }
+  }
+
+  return true;
+}
+
+/// Returns whether the cube map cell on the given face with the given lower
+/// corner and size, projected onto the surface of the given sphere, lies
+/// strictly inside the given neighbors.
+///
+template <class SphereCenterModel>
+bool
+BuriedSpherePruner<SphereCenterModel>::
+isCellCovered(Sphere<double> const & sphere,
+	      std::vector<Sphere<double> const *> const & neighbors,
+	      int face, double u, double v, double cellSize,
+	      int depth) const {
+
+  Vector3<double> centerDirection =
+    getCubeMapDirection(face, u + cellSize/2, v + cellSize/2);
+
+  //points on the cube face are at least unit distance from the origin, and
+  //normalizing such points never increases the distance between them, so the
+  //distance from the center of a cell to its corners on the cube face bounds
+  //the distance on the sphere
+  double cellRadius = (cellSize * sqrt(0.5) + 1e-12) * sphere.getRadius();
+
+  Vector3<double> point =
+    sphere.getCenter() + centerDirection * sphere.getRadius();
+
+  bool pointCovered = false;
+
+  for (Sphere<double> const * neighbor : neighbors) {
+    double depthInNeighbor =
+      neighbor->getRadius() - (point - neighbor->getCenter()).getMagnitude();
+
+    if (depthInNeighbor > cellRadius) {
+      return true;
+    }
+
+    if (depthInNeighbor > 0) {
+      pointCovered = true;
+    }
+  }
+
+  if (!pointCovered || depth == maxDepth) {
+    return false;
+  }
+
+  double halfSize = cellSize / 2;
+
+  return
+    isCellCovered(sphere, neighbors, face, u, v, halfSize, depth + 1) &&
+    isCellCovered(sphere, neighbors, face, u + halfSize, v, halfSize,
+		  depth + 1) &&
+    isCellCovered(sphere, neighbors, face, u, v + halfSize, halfSize,
+		  depth + 1) &&
+    isCellCovered(sphere, neighbors, face, u + halfSize, v + halfSize,
+		  halfSize, depth + 1);
+}
+
+/// Returns the unit vector through the given point, with coordinates in
+/// [-1, 1], on the given face of the cube map.
+///
+template <class SphereCenterModel>
+Vector3<double>
+BuriedSpherePruner<SphereCenterModel>::
+getCubeMapDirection(int face, double u, double v) {
+
+  int axis = face / 2;
+
+  Vector3<double> direction;
+
+  direction.set(axis, (face % 2 == 0) ? 1 : -1);
+  direction.set((axis + 1) % 3, u);
+  direction.set((axis + 2) % 3, v);
+
+  return direction.normalized();
+}
+
+// ================================================================
+
+#endif  // #ifndef BURIED_SPHERE_PRUNER_H
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// mode: c++
+// End:
@@ -0,0 +1,180 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+#ifndef DISTANCE_GRID_H
+#define DISTANCE_GRID_H
+
+#include <vector>
+#include <cmath>
+
+#include "../Geometry/Sphere.h"
+#include "../Geometry/Vector3.h"
+
+// ================================================================
+
+/// A uniform grid over the cube enclosing a bounding sphere that stores the
+/// distance from each cell center to the nearest point on the object.  Since
+/// distance to the object changes by at most the distance moved, the stored
+/// value minus the distance from the query point to its cell center is a
+/// guaranteed lower bound on the distance from the query point to the object.
+///
+/// Bounds are only returned if they are at least one cell diagonal.  In that
+/// case the exact distance is at most twice the bound, so a walk-on-spheres
+/// step using the bound is at least half as large as an exact step.
+///
+template <class T>
+class DistanceGrid
+{
+public:
+  DistanceGrid(Sphere<T> const & boundingSphere, int gridSize);
+  ~DistanceGrid();
+
+  long long getNumCells() const;
+
+  Vector3<T> getCellCenter(long long cellNum) const;
+
+  void setCenterDistance(long long cellNum, T distance);
+
+  T getLowerBound(Vector3<T> const & queryPoint) const;
+
+  double getUsedMemory() const;
+
+private:
+  Vector3<T> minCornerCoords;
+
+  T cellSize;
+  T inverseCellSize;
+
+  int gridSize;
+
+  T minUsefulBound;
+
+  // Stored in single precision, rounded down.
+  std::vector<float> centerDistances;
+};
+
+/// Constructs a grid with the given number of cells along each side,
+/// covering the given bounding sphere.  All cell distances are initially 0.
+///
+template <class T>
+DistanceGrid<T>::DistanceGrid(Sphere<T> const & boundingSphere, int gridSize)
+  : minCornerCoords(boundingSphere.getCenter() - boundingSphere.getRadius()),
+    cellSize(2 * boundingSphere.getRadius() / gridSize),
+    inverseCellSize(gridSize / (2 * boundingSphere.getRadius())),
+    gridSize(gridSize),
+    minUsefulBound(sqrt(3.) * 2 * boundingSphere.getRadius() / gridSize),
+    centerDistances((long long)gridSize * gridSize * gridSize, 0) {
+
+}
+
+template <class T>
+DistanceGrid<T>::~DistanceGrid() {
+
+}
+
+template <class T>
+long long
+DistanceGrid<T>::getNumCells() const {
+
+  return centerDistances.size();
+}
+
+/// Returns the coordinates of the center of the given cell.
+///
+template <class T>
+Vector3<T>
+DistanceGrid<T>::getCellCenter(long long cellNum) const {
+
+  int i = cellNum % gridSize;
+  int j = (cellNum / gridSize) % gridSize;
+  int k = cellNum / ((long long)gridSize * gridSize);
+
+  return minCornerCoords + Vector3<T>((i + 0.5) * cellSize,
+				      (j + 0.5) * cellSize,
+				      (k + 0.5) * cellSize);
+}
+
+/// Sets the exact distance from the center of the given cell to the object.
+/// Negative distances indicate the center is inside the object.
+///
+template <class T>
+void
+DistanceGrid<T>::setCenterDistance(long long cellNum, T distance) {
+
+  float roundedDistance = distance;
+
+  if (roundedDistance > distance) {
+    roundedDistance = std::nextafter(roundedDistance, -HUGE_VALF);
+  }
+
+  centerDistances.at(cellNum) = roundedDistance;
+}
+
+/// Returns a lower bound on the distance from the given query point to the
+/// object, or 0 if the query point is outside the grid or no useful bound is
+/// available.
+///
+template <class T>
+T
+DistanceGrid<T>::getLowerBound(Vector3<T> const & queryPoint) const {
+
+  Vector3<T> gridCoords = (queryPoint - minCornerCoords) * inverseCellSize;
+
+  if (gridCoords.getMin() < 0 || gridCoords.getMax() >= gridSize) {
+    return 0;
+  }
+
+  int i = (int)gridCoords.getX();
+  int j = (int)gridCoords.getY();
+  int k = (int)gridCoords.getZ();
+
+  long long cellNum = ((long long)k * gridSize + j) * gridSize + i;
+
+  Vector3<T> centerOffset(gridCoords.getX() - (i + 0.5),
+			  gridCoords.getY() - (j + 0.5),
+			  gridCoords.getZ() - (k + 0.5));
+
+  T lowerBound =
+    centerDistances[cellNum] - centerOffset.getMagnitude() * cellSize;
+
+  if (lowerBound < minUsefulBound) {
+    return 0;
+  }
+
+  return lowerBound;
+}
+
+/// Returns the memory used by the grid in bytes.
+///
+template <class T>
+double
+DistanceGrid<T>::getUsedMemory() const {
+
+  return centerDistances.size() * sizeof(float);
+}
+
+// ================================================================
+
+#endif  // #ifndef DISTANCE_GRID_H
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// mode: c++
+// End:
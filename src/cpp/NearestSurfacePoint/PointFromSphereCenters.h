@@ -31,6 +31,11 @@
 #include "../Geometry/Sphere.h"
 #include "../Geometry/Vector3.h"
 
+#include <thread>
+
+#include "SphereNeighborList.h"
+#include "DistanceGrid.h"
+
 // ================================================================
 
 /// Finds the nearest point on the surface of an object represented by
@@ -41,22 +46,57 @@ template <class SphereCenterModel>
 class PointFromSphereCenters
 {
 public:
+  typedef SphereNeighborList<double> NeighborList;
+
   PointFromSphereCenters(SphereCenterModel const & sphereCenterModel);
   ~PointFromSphereCenters();
 
+  //the distance grid is owned, so copies are not allowed
+  PointFromSphereCenters(PointFromSphereCenters const &) = delete;
+  PointFromSphereCenters & operator=(PointFromSphereCenters const &) = delete;
+
+  void findNearestPoint(Vector3<double> const & queryPoint,
+			double fracErrorBound,
+			Vector3<double> * nearestPointNormal,
+			double * distance) const;
+
   void findNearestPoint(Vector3<double> const & queryPoint,
 			double fracErrorBound,
+			NeighborList * neighborList,
 			Vector3<double> * nearestPointNormal,
 			double * distance) const;
 
+  void buildDistanceGrid(Sphere<double> const & boundingSphere,
+			 int gridSize,
+			 int numThreads);
+
+  DistanceGrid<double> const * getDistanceGrid() const;
+
+  double getDistanceLowerBound(Vector3<double> const & queryPoint) const;
+
 private:
+  /// Ratio of the neighbor list bubble radius to the distance from the
+  /// bubble center to the surface.
+  ///
+  static constexpr double bubbleRadiusFactor = 4;
+
+  void findNearestSphere(Vector3<double> const & queryPoint,
+			 double fracErrorBound,
+			 Sphere<double> const * * nearestSphere,
+			 double * distance) const;
+
+  void computeDistanceGridThread(int threadNum, int numThreads);
+
   SphereCenterModel const * sphereCenterModel;
+
+  DistanceGrid<double> * distanceGrid;
 };
 
 template <class SphereCenterModel>
 PointFromSphereCenters<SphereCenterModel>::
 PointFromSphereCenters(SphereCenterModel const & sphereCenterModel) 
-  : sphereCenterModel(&sphereCenterModel) {
+  : sphereCenterModel(&sphereCenterModel),
+    distanceGrid(NULL) {
   
 }
 
@@ -64,6 +104,7 @@ template <class SphereCenterModel>
 PointFromSphereCenters<SphereCenterModel>::
 ~PointFromSphereCenters() {
 
+  delete distanceGrid;
 }
 
 /// Compute the distance from the given query point to the nearest point on the 
@@ -80,6 +121,148 @@ findNearestPoint(Vector3<double> const & queryPoint,
 
   Sphere<double> const * nearestSphere = NULL;
 
+  findNearestSphere(queryPoint, fracErrorBound, &nearestSphere, distance);
+
+  (*nearestPointNormal) = queryPoint - nearestSphere->getCenter();
+}
+
+/// Same as above, but first tries the given per-walker neighbor list.  If the
+/// query point is inside the list's bubble the spatial data structure is not
+/// searched at all.  Otherwise, if the query point is near the surface
+/// relative to the size of the nearest sphere, the list is rebuilt around the
+/// query point with a bubble radius proportional to the surface distance.
+///
+template <class SphereCenterModel>
+void 
+PointFromSphereCenters<SphereCenterModel>::
+findNearestPoint(Vector3<double> const & queryPoint,
+		 double fracErrorBound, 
+		 NeighborList * neighborList,
+		 Vector3<double> * nearestPointNormal,
+		 double * distance) const {
+
+  Sphere<double> const * nearestSphere = NULL;
+
+  if (neighborList->contains(queryPoint)) {
+    neighborList->findNearestSphere(queryPoint, &nearestSphere, distance);
+  }
+  else {
+    findNearestSphere(queryPoint, fracErrorBound, &nearestSphere, distance);
+
+    double bubbleRadius = bubbleRadiusFactor * (*distance);
+
+    if (bubbleRadius > 0 && bubbleRadius < nearestSphere->getRadius()) {
+      neighborList->reset(queryPoint, bubbleRadius);
+
+      for (unsigned int radiusNum = 0; 
+	   radiusNum < sphereCenterModel->getNumRadii(); 
+	   radiusNum ++) {
+
+	sphereCenterModel->findNearbySpheres(radiusNum,
+					     queryPoint,
+					     *distance + 2 * bubbleRadius,
+					     neighborList->getSpheres());
+      }
+
+      neighborList->pack();
+    }
+  }
+
+  (*nearestPointNormal) = queryPoint - nearestSphere->getCenter();
+}
+
+/// Builds a grid with the given number of cells along each side, covering the
+/// given bounding sphere, that stores exact distances from the cell centers to
+/// the surface.  The distances are computed using the given number of
+/// threads.
+///
+template <class SphereCenterModel>
+void 
+PointFromSphereCenters<SphereCenterModel>::
+buildDistanceGrid(Sphere<double> const & boundingSphere,
+		  int gridSize,
+		  int numThreads) {
+
+  delete distanceGrid;
+
+  distanceGrid = new DistanceGrid<double>(boundingSphere, gridSize);
+
+  std::thread * * threads = new std::thread *[numThreads];
+
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    threads[threadNum] = 
+      new std::thread(&PointFromSphereCenters::computeDistanceGridThread,
+		      this, threadNum, numThreads);
+  }
+
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    threads[threadNum]->join();
+
+    delete threads[threadNum];
+  }
+
+  delete [] threads;
+}
+
+template <class SphereCenterModel>
+void 
+PointFromSphereCenters<SphereCenterModel>::
+computeDistanceGridThread(int threadNum, int numThreads) {
+
+  for (long long cellNum = threadNum; 
+       cellNum < distanceGrid->getNumCells(); 
+       cellNum += numThreads) {
+
+    Sphere<double> const * nearestSphere = NULL;
+
+    double distance = 0;
+
+    //the grid must hold lower bounds, so search exactly
+    findNearestSphere(distanceGrid->getCellCenter(cellNum), 0,
+		      &nearestSphere, &distance);
+
+    distanceGrid->setCenterDistance(cellNum, distance);
+  }
+}
+
+/// Returns the distance grid, or NULL if none has been built.
+///
+template <class SphereCenterModel>
+DistanceGrid<double> const *
+PointFromSphereCenters<SphereCenterModel>::
+getDistanceGrid() const {
+
+  return distanceGrid;
+}
+
+/// Returns a lower bound on the distance from the given query point to the
+/// surface taken from the distance grid, or 0 if the grid has not been built
+/// or has no useful bound at the query point.
+///
+template <class SphereCenterModel>
+double 
+PointFromSphereCenters<SphereCenterModel>::
+getDistanceLowerBound(Vector3<double> const & queryPoint) const {
+
+  if (distanceGrid == NULL) {
+    return 0;
+  }
+
+  return distanceGrid->getLowerBound(queryPoint);
+}
+
+/// Searches every radius bin of the spatial data structure for the sphere
+/// whose surface is closest to the given query point, allowing for the given
+/// relative error in distance.
+///
+template <class SphereCenterModel>
+void 
+PointFromSphereCenters<SphereCenterModel>::
+findNearestSphere(Vector3<double> const & queryPoint,
+		  double fracErrorBound, 
+		  Sphere<double> const * * nearestSphere,
+		  double * distance) const {
+
   double minDistance = std::numeric_limits<double>::max();
 
   for (unsigned int radiusNum = 0; 
@@ -100,13 +283,12 @@ findNearestPoint(Vector3<double> const & queryPoint,
       sqrt(centerDistSqr) - foundSphere->getRadius();
 
     if (foundDistance < minDistance) {
-      nearestSphere = foundSphere;
-      minDistance   = foundDistance;
+      *nearestSphere = foundSphere;
+      minDistance    = foundDistance;
     }
   }
 
-  (*nearestPointNormal) = queryPoint - nearestSphere->getCenter();
-  (*distance)           = minDistance;
+  (*distance) = minDistance;
 }
 
 // ================================================================
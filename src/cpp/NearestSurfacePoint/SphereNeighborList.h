@@ -0,0 +1,185 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+#ifndef SPHERE_NEIGHBOR_LIST_H
+#define SPHERE_NEIGHBOR_LIST_H
+
+#include <vector>
+#include <limits>
+
+#include "../Geometry/Sphere.h"
+#include "../Geometry/Vector3.h"
+
+// ================================================================
+
+/// Caches the spheres that may be nearest to any point inside a "bubble"
+/// around a center point.  If the list holds every sphere whose surface is
+/// within (d + 2 * r) of the bubble center, where d is the distance from the
+/// bubble center to the nearest surface and r is the bubble radius, then by
+/// the triangle inequality the nearest sphere to any point inside the bubble
+/// is in the list.
+///
+/// Each walker keeps its own list, so steps that stay inside the bubble do
+/// not need to query the shared spatial data structure.
+///
+template <class T>
+class SphereNeighborList
+{
+public:
+  SphereNeighborList();
+  ~SphereNeighborList();
+
+  void reset(Vector3<T> const & bubbleCenter, T bubbleRadius);
+
+  std::vector<Sphere<T> const *> * getSpheres();
+
+  void pack();
+
+  bool contains(Vector3<T> const & point) const;
+
+  void findNearestSphere(Vector3<T> const & queryPoint,
+			 Sphere<T> const * * nearestSphere,
+			 T * distance) const;
+
+private:
+  bool valid;
+
+  Vector3<T> bubbleCenter;
+  T bubbleRadiusSqr;
+
+  std::vector<Sphere<T> const *> spheres;
+
+  // Sphere centers and radii in list order, packed as (x, y, z, r).
+  std::vector<T> packedSpheres;
+};
+
+template <class T>
+SphereNeighborList<T>::SphereNeighborList()
+  : valid(false),
+    bubbleCenter(),
+    bubbleRadiusSqr(0),
+    spheres(),
+    packedSpheres() {
+
+}
+
+template <class T>
+SphereNeighborList<T>::~SphereNeighborList() {
+
+}
+
+/// Empties the list and moves the bubble to the given location.  The caller
+/// must then add the candidate spheres using getSpheres() and call pack().
+///
+template <class T>
+void
+SphereNeighborList<T>::reset(Vector3<T> const & bubbleCenter, T bubbleRadius) {
+
+  this->bubbleCenter    = bubbleCenter;
+  this->bubbleRadiusSqr = bubbleRadius * bubbleRadius;
+
+  spheres.clear();
+
+  valid = true;
+}
+
+/// Returns the list of candidate spheres for modification.
+///
+template <class T>
+std::vector<Sphere<T> const *> *
+SphereNeighborList<T>::getSpheres() {
+
+  return &spheres;
+}
+
+/// Copies the candidate sphere data into contiguous storage for searching.
+///
+template <class T>
+void
+SphereNeighborList<T>::pack() {
+
+  packedSpheres.resize(4 * spheres.size());
+
+  for (unsigned int i = 0; i < spheres.size(); i++) {
+    Vector3<T> center = spheres[i]->getCenter();
+
+    packedSpheres[4*i + 0] = center.getX();
+    packedSpheres[4*i + 1] = center.getY();
+    packedSpheres[4*i + 2] = center.getZ();
+    packedSpheres[4*i + 3] = spheres[i]->getRadius();
+  }
+}
+
+/// Returns whether the given point is inside the bubble.
+///
+template <class T>
+bool
+SphereNeighborList<T>::contains(Vector3<T> const & point) const {
+
+  return valid &&
+    ((point - bubbleCenter).getMagnitudeSqr() <= bubbleRadiusSqr);
+}
+
+/// Searches the candidate spheres for the one whose surface is closest to the
+/// given query point.  Computes both the closest sphere and the distance to
+/// its surface.
+///
+template <class T>
+void
+SphereNeighborList<T>::findNearestSphere(Vector3<T> const & queryPoint,
+					 Sphere<T> const * * nearestSphere,
+					 T * distance) const {
+
+  int nearestIndex = -1;
+
+  T minDistance = std::numeric_limits<T>::max();
+
+  T const * sphere = packedSpheres.data();
+
+  for (unsigned int i = 0; i < spheres.size(); i++, sphere += 4) {
+    T dx = queryPoint.getX() - sphere[0];
+    T dy = queryPoint.getY() - sphere[1];
+    T dz = queryPoint.getZ() - sphere[2];
+
+    T distSqr = dx*dx + dy*dy + dz*dz;
+
+    //avoid the square root when this sphere cannot be closer
+    T maxCenterDist = minDistance + sphere[3];
+
+    if (maxCenterDist <= 0 || distSqr >= maxCenterDist * maxCenterDist) {
+      continue;
+    }
+
+    minDistance  = sqrt(distSqr) - sphere[3];
+    nearestIndex = i;
+  }
+
+  *nearestSphere = (nearestIndex >= 0) ? spheres[nearestIndex] : NULL;
+  *distance      = minDistance;
+}
+
+// ================================================================
+
+#endif  // #ifndef SPHERE_NEIGHBOR_LIST_H
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// mode: c++
+// End:
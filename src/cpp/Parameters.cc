@@ -47,6 +47,17 @@ Parameters::Parameters()
     numThreads(),
     seed(),
     fracErrorBound(),
+    distanceGridSize(),
+    distanceGridSizeWasSet(false),
+    pruneBuriedSpheres(),
+    minimalLaunchSphere(),
+    concurrentInteriorSampling(),
+    unionInteriorSampling(),
+    expectedCharges(),
+    compensatedSums(),
+    streamPointsFiles(),
+    numDeterministicBlocks(),
+    numDeterministicBlocksWasSet(false),
     totalNumWalks(),
     totalNumWalksWasSet(false),
     totalNumSamples(),
@@ -57,11 +68,20 @@ Parameters::Parameters()
     maxErrorPolarizabilityWasSet(false),
     maxErrorVolume(),
     maxErrorVolumeWasSet(false),
+    maxRunTime(),
+    maxRunTimeWasSet(false),
+    exteriorRunTimeFraction(),
     computeFormWasSet(false),
+    maxFormFactorPoints(),
+    maxFormFactorPointsWasSet(false),
+    maxErrorFormFactors(),
+    maxErrorFormFactorsWasSet(false),
+    histogramFormFactors(),
     minTotalNumWalks(),
     minTotalNumSamples(),
     surfacePointsFileName(),
     interiorPointsFileName(),
+    indexCacheDirName(),
     printCounts(),
     printBenchmarks(),
     skinThickness(),
@@ -127,6 +147,30 @@ Parameters::parseCommandLine(int argc, char **argv) {
     totalNumSamplesWasSet = true;
   }
 
+  if (args_info.distance_grid_size_given) {
+    distanceGridSize = args_info.distance_grid_size_arg;
+    distanceGridSizeWasSet = true;
+  }
+
+  pruneBuriedSpheres = args_info.prune_buried_spheres_given;
+
+  minimalLaunchSphere = args_info.minimal_launch_sphere_given;
+
+  concurrentInteriorSampling = args_info.concurrent_interior_sampling_given;
+
+  unionInteriorSampling = args_info.union_interior_sampling_given;
+
+  expectedCharges = args_info.expected_charges_given;
+
+  compensatedSums = args_info.compensated_sums_given;
+
+  streamPointsFiles = args_info.stream_points_files_given;
+
+  if (args_info.deterministic_blocks_given) {
+    numDeterministicBlocks = args_info.deterministic_blocks_arg;
+    numDeterministicBlocksWasSet = true;
+  }
+
   if (args_info.max_rsd_capacitance_given) {
     maxErrorCapacitance = args_info.max_rsd_capacitance_arg;
     maxErrorCapacitanceWasSet = true;
@@ -142,9 +186,28 @@ Parameters::parseCommandLine(int argc, char **argv) {
     maxErrorVolumeWasSet = true;
   }
 
-  // if (args_info.compute_form_given) {
-  //   computeFormWasSet = true;
-  // }
+  if (args_info.max_run_time_given) {
+    maxRunTime = args_info.max_run_time_arg;
+    maxRunTimeWasSet = true;
+  }
+
+  exteriorRunTimeFraction = args_info.exterior_run_time_fraction_arg;
+
+  if (args_info.compute_form_given) {
+    computeFormWasSet = true;
+  }
+
+  if (args_info.max_form_factor_points_given) {
+    maxFormFactorPoints = args_info.max_form_factor_points_arg;
+    maxFormFactorPointsWasSet = true;
+  }
+
+  if (args_info.max_sd_form_factors_given) {
+    maxErrorFormFactors = args_info.max_sd_form_factors_arg;
+    maxErrorFormFactorsWasSet = true;
+  }
+
+  histogramFormFactors = args_info.histogram_form_factors_given;
 
   if (args_info.num_threads_given) {
     numThreads = args_info.num_threads_arg;
@@ -189,6 +252,13 @@ Parameters::parseCommandLine(int argc, char **argv) {
     interiorPointsFileName = "";
   }
 
+  if (args_info.index_cache_dir_given) {
+    indexCacheDirName = args_info.index_cache_dir_arg;
+  }
+  else {
+    indexCacheDirName = "";
+  }
+
   printCounts     = args_info.print_counts_given;
   printBenchmarks = args_info.print_benchmarks_given;
 
@@ -227,6 +297,66 @@ Parameters::print() const {
     std::cout << "Max error in volume: " << maxErrorVolume << " %" << std::endl;
   }
 
+  if (maxRunTimeWasSet) {
+    std::cout << "Max run time: " << maxRunTime << " s" << std::endl
+	      << "Exterior run time fraction: " << exteriorRunTimeFraction 
+	      << std::endl;
+  }
+
+  if (distanceGridSizeWasSet) {
+    std::cout << "Distance grid size: " << distanceGridSize << std::endl;
+  }
+
+  if (pruneBuriedSpheres) {
+    std::cout << "Pruning buried spheres" << std::endl;
+  }
+
+  if (minimalLaunchSphere) {
+    std::cout << "Using minimal launch sphere" << std::endl;
+  }
+
+  if (concurrentInteriorSampling) {
+    std::cout << "Taking interior samples concurrently with walks" 
+	      << std::endl;
+  }
+
+  if (unionInteriorSampling) {
+    std::cout << "Taking interior samples inside the union of spheres" 
+	      << std::endl;
+  }
+
+  if (expectedCharges) {
+    std::cout << "Using expected charges" << std::endl;
+  }
+
+  if (compensatedSums) {
+    std::cout << "Using compensated sums" << std::endl;
+  }
+
+  if (streamPointsFiles) {
+    std::cout << "Streaming points files" << std::endl;
+  }
+
+  if (computeFormWasSet && maxFormFactorPointsWasSet) {
+    std::cout << "Max number of form factor points: " 
+	      << maxFormFactorPoints << std::endl;
+  }
+
+  if (computeFormWasSet && maxErrorFormFactorsWasSet) {
+    std::cout << "Max standard deviation of form factors: " 
+	      << maxErrorFormFactors << std::endl;
+  }
+
+  if (computeFormWasSet && histogramFormFactors) {
+    std::cout << "Computing form factors from a distance histogram" 
+	      << std::endl;
+  }
+
+  if (numDeterministicBlocksWasSet) {
+    std::cout << "Number of deterministic blocks: " << numDeterministicBlocks
+	      << std::endl;
+  }
+
   if (skinThicknessWasSet) {
     std::cout << "Skin thickness: " << skinThickness << std::endl;
   }
@@ -304,6 +434,61 @@ Parameters::getFracErrorBound() const {
   return fracErrorBound;
 }
 
+int 
+Parameters::getDistanceGridSize() const {
+  return distanceGridSize;
+}
+
+bool 
+Parameters::getDistanceGridSizeWasSet() const {
+  return distanceGridSizeWasSet;
+}
+
+bool 
+Parameters::getPruneBuriedSpheres() const {
+  return pruneBuriedSpheres;
+}
+
+bool 
+Parameters::getMinimalLaunchSphere() const {
+  return minimalLaunchSphere;
+}
+
+bool 
+Parameters::getConcurrentInteriorSampling() const {
+  return concurrentInteriorSampling;
+}
+
+bool 
+Parameters::getUnionInteriorSampling() const {
+  return unionInteriorSampling;
+}
+
+bool 
+Parameters::getExpectedCharges() const {
+  return expectedCharges;
+}
+
+bool 
+Parameters::getCompensatedSums() const {
+  return compensatedSums;
+}
+
+bool 
+Parameters::getStreamPointsFiles() const {
+  return streamPointsFiles;
+}
+
+int 
+Parameters::getNumDeterministicBlocks() const {
+  return numDeterministicBlocks;
+}
+
+bool 
+Parameters::getNumDeterministicBlocksWasSet() const {
+  return numDeterministicBlocksWasSet;
+}
+
 long long 
 Parameters::getTotalNumWalks() const {
   return totalNumWalks;
@@ -349,6 +534,31 @@ Parameters::getComputeFormWasSet() const {
   return computeFormWasSet;
 }
 
+long long
+Parameters::getMaxFormFactorPoints() const {
+  return maxFormFactorPoints;
+}
+
+bool
+Parameters::getMaxFormFactorPointsWasSet() const {
+  return maxFormFactorPointsWasSet;
+}
+
+double
+Parameters::getMaxErrorFormFactors() const {
+  return maxErrorFormFactors;
+}
+
+bool
+Parameters::getMaxErrorFormFactorsWasSet() const {
+  return maxErrorFormFactorsWasSet;
+}
+
+bool
+Parameters::getHistogramFormFactors() const {
+  return histogramFormFactors;
+}
+
 double
 Parameters::getMaxErrorVolume() const {
   return maxErrorVolume;
@@ -359,6 +569,21 @@ Parameters::getMaxErrorVolumeWasSet() const {
   return maxErrorVolumeWasSet;
 }
 
+double
+Parameters::getMaxRunTime() const {
+  return maxRunTime;
+}
+
+bool
+Parameters::getMaxRunTimeWasSet() const {
+  return maxRunTimeWasSet;
+}
+
+double
+Parameters::getExteriorRunTimeFraction() const {
+  return exteriorRunTimeFraction;
+}
+
 long long 
 Parameters::getMinTotalNumWalks() const {
   return minTotalNumWalks;
@@ -379,6 +604,11 @@ Parameters::getInteriorPointsFileName() const {
   return interiorPointsFileName;
 }
 
+std::string 
+Parameters::getIndexCacheDirName() const {
+  return indexCacheDirName;
+}
+
 bool 
 Parameters::getPrintCounts() const {
   return printCounts;
@@ -549,13 +779,11 @@ Parameters::getBuoyancyFactorWasSet() const {
   return buoyancyFactorWasSet;
 }
 
-/// Broadcasts the parameters that can be set in the bod file over MPI.
+/// Packs the parameters that can be set in the bod file into the given array
+/// of numBodParameters values.
 ///
 void 
-Parameters::mpiSend() const {
-#ifdef USE_MPI
-  double parametersArray[22];
-
+Parameters::getBodParameters(double * parametersArray) const {
   parametersArray[0]  = getSkinThickness();
   parametersArray[1]  = (double)getSkinThicknessWasSet();
   parametersArray[2]  = getLaunchCenter().getX();
@@ -578,20 +806,13 @@ Parameters::mpiSend() const {
   parametersArray[19] = (double)getSolventViscosityWasSet();
   parametersArray[20] = getBuoyancyFactor();
   parametersArray[21] = (double)getBuoyancyFactorWasSet();
-
-  MPI_Bcast(parametersArray, 22, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-#endif
 }
 
-/// Receives the parameters that can be set in the bod file over MPI.
+/// Sets the parameters that were set in the bod file from the given array of
+/// numBodParameters values packed by getBodParameters.
 ///
 void 
-Parameters::mpiReceive() {
-#ifdef USE_MPI
-  double parametersArray[22];
-
-  MPI_Bcast(parametersArray, 22, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-
+Parameters::setBodParameters(double const * parametersArray) {
   if ((bool)parametersArray[1]) {
     setSkinThickness(parametersArray[0]);
   }
@@ -629,6 +850,33 @@ Parameters::mpiReceive() {
   if ((bool)parametersArray[21]) {
     setBuoyancyFactor(parametersArray[20]);
   }
+}
+
+/// Broadcasts the parameters that can be set in the bod file over MPI.
+///
+void 
+Parameters::mpiSend() const {
+#ifdef USE_MPI
+  double parametersArray[numBodParameters];
+
+  getBodParameters(parametersArray);
+
+  MPI_Bcast(parametersArray, numBodParameters, MPI_DOUBLE, 
+	    0, MPI_COMM_WORLD);
+#endif
+}
+
+/// Receives the parameters that can be set in the bod file over MPI.
+///
+void 
+Parameters::mpiReceive() {
+#ifdef USE_MPI
+  double parametersArray[numBodParameters];
+
+  MPI_Bcast(parametersArray, numBodParameters, MPI_DOUBLE, 
+	    0, MPI_COMM_WORLD);
+
+  setBodParameters(parametersArray);
 #endif
 }
 
@@ -66,6 +66,26 @@ public:
 
   double getFracErrorBound() const;
 
+  int getDistanceGridSize() const;
+  bool getDistanceGridSizeWasSet() const;
+
+  bool getPruneBuriedSpheres() const;
+
+  bool getMinimalLaunchSphere() const;
+
+  bool getConcurrentInteriorSampling() const;
+
+  bool getUnionInteriorSampling() const;
+
+  bool getExpectedCharges() const;
+
+  bool getCompensatedSums() const;
+
+  bool getStreamPointsFiles() const;
+
+  int getNumDeterministicBlocks() const;
+  bool getNumDeterministicBlocksWasSet() const;
+
   long long getTotalNumWalks() const;
   bool getTotalNumWalksWasSet() const;
 
@@ -81,8 +101,21 @@ public:
   double getMaxErrorVolume() const;
   bool getMaxErrorVolumeWasSet() const;
 
+  double getMaxRunTime() const;
+  bool getMaxRunTimeWasSet() const;
+
+  double getExteriorRunTimeFraction() const;
+
   bool getComputeFormWasSet() const;
 
+  long long getMaxFormFactorPoints() const;
+  bool getMaxFormFactorPointsWasSet() const;
+
+  double getMaxErrorFormFactors() const;
+  bool getMaxErrorFormFactorsWasSet() const;
+
+  bool getHistogramFormFactors() const;
+
   long long getMinTotalNumWalks() const;
 
   long long getMinTotalNumSamples() const;
@@ -90,6 +123,8 @@ public:
   std::string getSurfacePointsFileName() const;
   std::string getInteriorPointsFileName() const;
 
+  std::string getIndexCacheDirName() const;
+
   bool getPrintCounts() const;
   bool getPrintBenchmarks() const;
 
@@ -129,6 +164,14 @@ public:
   double getBuoyancyFactor() const;
   bool getBuoyancyFactorWasSet() const;
 
+  /// Number of values used to store the parameters that can be set in the
+  /// bod file.
+  ///
+  static const int numBodParameters = 22;
+
+  void getBodParameters(double * parametersArray) const;
+  void setBodParameters(double const * parametersArray);
+
   void mpiSend() const;
   void mpiReceive();
 
@@ -144,6 +187,26 @@ private:
 
   double fracErrorBound;
 
+  int distanceGridSize;
+  bool distanceGridSizeWasSet;
+
+  bool pruneBuriedSpheres;
+
+  bool minimalLaunchSphere;
+
+  bool concurrentInteriorSampling;
+
+  bool unionInteriorSampling;
+
+  bool expectedCharges;
+
+  bool compensatedSums;
+
+  bool streamPointsFiles;
+
+  int numDeterministicBlocks;
+  bool numDeterministicBlocksWasSet;
+
   long long totalNumWalks;
   bool totalNumWalksWasSet;
 
@@ -159,8 +222,21 @@ private:
   double maxErrorVolume;
   bool maxErrorVolumeWasSet;
 
+  double maxRunTime;
+  bool maxRunTimeWasSet;
+
+  double exteriorRunTimeFraction;
+
   bool computeFormWasSet;
 
+  long long maxFormFactorPoints;
+  bool maxFormFactorPointsWasSet;
+
+  double maxErrorFormFactors;
+  bool maxErrorFormFactorsWasSet;
+
+  bool histogramFormFactors;
+
   long long minTotalNumWalks;
 
   long long minTotalNumSamples;
@@ -168,6 +244,8 @@ private:
   std::string surfacePointsFileName;
   std::string interiorPointsFileName;
 
+  std::string indexCacheDirName;
+
   bool printCounts;
   bool printBenchmarks;
 
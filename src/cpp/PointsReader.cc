@@ -0,0 +1,120 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+#include "PointsReader.h"
+#include "PointsWriter.h"
+
+#include <cstring>
+#include <cstdint>
+
+// ================================================================
+
+/// Opens the given points file and reads its header.  If the file cannot be
+/// opened or is not a points file, isOpen() returns false.
+///
+PointsReader::
+PointsReader(std::string const & fileName)
+  : file(NULL),
+    charges(false) {
+
+  file = gzopen(fileName.c_str(), "rb");
+
+  if (file == NULL) {
+    return;
+  }
+
+  char magic[sizeof(pointsFileMagic)];
+
+  int64_t hasCharges = 0;
+
+  if (gzread(file, magic, sizeof(magic)) != (int)sizeof(magic) ||
+      memcmp(magic, pointsFileMagic, sizeof(pointsFileMagic)) != 0 ||
+      gzread(file, &hasCharges, sizeof(hasCharges)) != 
+      (int)sizeof(hasCharges)) {
+
+    gzclose(file);
+
+    file = NULL;
+
+    return;
+  }
+
+  charges = (hasCharges != 0);
+}
+
+PointsReader::
+~PointsReader() {
+
+  if (file != NULL) {
+    gzclose(file);
+  }
+}
+
+bool
+PointsReader::
+isOpen() const {
+
+  return (file != NULL);
+}
+
+/// Returns whether the file holds a charge for each point.
+///
+bool
+PointsReader::
+hasCharges() const {
+
+  return charges;
+}
+
+/// Reads the next point, and its charges if the file has them.  Returns false
+/// at the end of the file or if a complete point could not be read.
+///
+bool
+PointsReader::
+read(Vector3<double> * point,
+     Vector3<char> * charges) {
+
+  double coords[3];
+
+  if (gzread(file, coords, sizeof(coords)) != (int)sizeof(coords)) {
+    return false;
+  }
+
+  point->setXYZ(coords[0], coords[1], coords[2]);
+
+  if (this->charges) {
+    char pointCharges[3];
+
+    if (gzread(file, pointCharges, sizeof(pointCharges)) != 
+	(int)sizeof(pointCharges)) {
+
+      return false;
+    }
+
+    charges->setXYZ(pointCharges[0], pointCharges[1], pointCharges[2]);
+  }
+
+  return true;
+}
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// mode: c++
+// End:
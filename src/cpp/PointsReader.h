@@ -0,0 +1,65 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+#ifndef POINTS_READER_H_
+#define POINTS_READER_H_
+
+// ================================================================
+
+#include <string>
+
+#include <zlib.h>
+
+#include "Geometry/Vector3.h"
+
+// ================================================================
+
+/// Reads the binary points files written by PointsWriter, compressed or not.
+///
+class PointsReader {
+public:
+  PointsReader(std::string const & fileName);
+
+  ~PointsReader();
+
+  bool isOpen() const;
+
+  bool hasCharges() const;
+
+  bool read(Vector3<double> * point,
+	    Vector3<char> * charges);
+
+private:
+  PointsReader(PointsReader const &) = delete;
+  PointsReader & operator=(PointsReader const &) = delete;
+
+  gzFile file;
+
+  bool charges;
+};
+
+// ================================================================
+
+#endif  // #ifndef POINTS_READER_H_
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// mode: c++
+// End:
@@ -0,0 +1,69 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+// Converts a binary points file written with --stream-points-files to the
+// text format written without it, on standard output.
+//
+// Usage: zeno-points-to-text <points file>
+
+#include <iostream>
+#include <iomanip>
+
+#include "PointsReader.h"
+
+// ================================================================
+
+int
+main(int argc, char **argv) {
+
+  if (argc != 2) {
+    std::cerr << "Usage: " << argv[0] << " <points file>" << std::endl;
+    return 1;
+  }
+
+  PointsReader reader(argv[1]);
+
+  if (!reader.isOpen()) {
+    std::cerr << "Error reading points file " << argv[1] << std::endl;
+    return 1;
+  }
+
+  Vector3<double> point;
+  Vector3<char> charges;
+
+  while (reader.read(&point, &charges)) {
+
+    if (reader.hasCharges()) {
+      std::cout << charges.get(0)
+		<< charges.get(1)
+		<< charges.get(2);
+    }
+
+    std::cout << std::setw(16) << point.get(0)
+	      << std::setw(16) << point.get(1)
+	      << std::setw(16) << point.get(2) << "\n";
+  }
+
+  return 0;
+}
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// End:
@@ -0,0 +1,166 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+#include "PointsWriter.h"
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+
+#include <zlib.h>
+
+// ================================================================
+
+std::string const PointsWriter::compressedSuffix = ".gz";
+
+/// Creates the given points file and writes its header.  The file is
+/// compressed if its name ends in ".gz".  Exits if the file cannot be created.
+///
+PointsWriter::
+PointsWriter(std::string const & fileName,
+	     bool writeCharges)
+  : fileName(fileName),
+    writeCharges(writeCharges),
+    compress(false),
+    file(NULL),
+    mutex() {
+
+  compress = 
+    (fileName.size() > compressedSuffix.size()) &&
+    (fileName.compare(fileName.size() - compressedSuffix.size(), 
+		      compressedSuffix.size(), compressedSuffix) == 0);
+
+  file = fopen(fileName.c_str(), "wb");
+
+  if (file == NULL) {
+    std::cout << "Error opening output file " << fileName << std::endl;
+    exit(1);
+  }
+
+  int64_t hasCharges = writeCharges ? 1 : 0;
+
+  std::vector<char> header(sizeof(pointsFileMagic) + sizeof(hasCharges));
+
+  memcpy(&header[0], pointsFileMagic, sizeof(pointsFileMagic));
+  memcpy(&header[sizeof(pointsFileMagic)], &hasCharges, sizeof(hasCharges));
+
+  writeBlock(header);
+}
+
+PointsWriter::
+~PointsWriter() {
+
+  if (fclose(file) != 0) {
+    std::cout << "Error writing output file " << fileName << std::endl;
+  }
+}
+
+/// Appends the given points, and if charges are being written the
+/// corresponding charges, to the file.  May be called from several threads at
+/// once.
+///
+void
+PointsWriter::
+write(std::vector<Vector3<double> > const & points,
+      std::vector<Vector3<char> > const & charges) {
+
+  if (points.empty()) {
+    return;
+  }
+
+  const int recordSize = 3*sizeof(double) + (writeCharges ? 3 : 0);
+
+  std::vector<char> data(points.size() * recordSize);
+
+  char * record = data.data();
+
+  for (unsigned int pointNum = 0; pointNum < points.size(); pointNum++) {
+    for (int dim = 0; dim < 3; dim++) {
+      double coord = points[pointNum].get(dim);
+
+      memcpy(record, &coord, sizeof(double));
+
+      record += sizeof(double);
+    }
+
+    if (writeCharges) {
+      for (int dim = 0; dim < 3; dim++) {
+	*record++ = charges[pointNum].get(dim);
+      }
+    }
+  }
+
+  writeBlock(data);
+}
+
+/// Appends the given bytes to the file, as a separate gzip member if the file
+/// is compressed.  Only the file write itself is serialized between threads.
+///
+void
+PointsWriter::
+writeBlock(std::vector<char> const & data) {
+
+  std::vector<char> compressedData;
+
+  if (compress) {
+    z_stream stream;
+
+    memset(&stream, 0, sizeof(z_stream));
+
+    //window bits of 15 + 16 produce a gzip rather than zlib wrapper
+    if (deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, 
+		     Z_DEFAULT_STRATEGY) != Z_OK) {
+
+      std::cout << "Error compressing output file " << fileName << std::endl;
+      exit(1);
+    }
+
+    compressedData.resize(deflateBound(&stream, data.size()));
+
+    stream.next_in   = (Bytef *)data.data();
+    stream.avail_in  = data.size();
+    stream.next_out  = (Bytef *)compressedData.data();
+    stream.avail_out = compressedData.size();
+
+    if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+      std::cout << "Error compressing output file " << fileName << std::endl;
+      exit(1);
+    }
+
+    compressedData.resize(stream.total_out);
+
+    deflateEnd(&stream);
+  }
+
+  std::vector<char> const & block = compress ? compressedData : data;
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  if (fwrite(block.data(), 1, block.size(), file) != block.size()) {
+    std::cout << "Error writing output file " << fileName << std::endl;
+    exit(1);
+  }
+}
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// mode: c++
+// End:
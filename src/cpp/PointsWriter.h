@@ -0,0 +1,92 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+#ifndef POINTS_WRITER_H_
+#define POINTS_WRITER_H_
+
+// ================================================================
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdio>
+
+#include "Geometry/Vector3.h"
+
+// ================================================================
+
+/// Identifies the binary points file format.
+///
+const char pointsFileMagic[8] = {'Z', 'E', 'N', 'O', 'P', 'T', 'S', '1'};
+
+/// Writes hit points, and optionally their charges, to a binary points file
+/// while the computation runs.  Threads hand over their points in buffers,
+/// which are written to the file in the order they arrive.
+///
+/// The file holds the magic bytes and an 8-byte flag saying whether charges
+/// are present, followed by one record per point: three doubles and, if
+/// charges are present, three characters.  Values are in native byte order.
+/// If the file name ends in ".gz" the file is gzip compressed.  Each buffer is
+/// compressed as a separate gzip member by the thread that wrote it, so
+/// threads do not wait on each other's compression.  PointsReader reads both
+/// forms.
+///
+class PointsWriter {
+public:
+  PointsWriter(std::string const & fileName,
+	       bool writeCharges);
+
+  ~PointsWriter();
+
+  void write(std::vector<Vector3<double> > const & points,
+	     std::vector<Vector3<char> > const & charges);
+
+  /// Number of points each thread should buffer before calling write().
+  ///
+  static const int bufferNumPoints = 4096;
+
+  /// File name suffix that selects a compressed file.
+  ///
+  static std::string const compressedSuffix;
+
+private:
+  PointsWriter(PointsWriter const &) = delete;
+  PointsWriter & operator=(PointsWriter const &) = delete;
+
+  void writeBlock(std::vector<char> const & data);
+
+  std::string fileName;
+
+  bool writeCharges;
+  bool compress;
+
+  FILE * file;
+
+  std::mutex mutex;
+};
+
+// ================================================================
+
+#endif  // #ifndef POINTS_WRITER_H_
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// mode: c++
+// End:
@@ -0,0 +1,214 @@
+// ================================================================
+// 
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+// 
+// ================================================================
+
+#ifndef PHILOX_H_
+#define PHILOX_H_
+
+#include <cstdint>
+#include <cassert>
+
+// ================================================================
+
+/// Generates random numbers using the Philox4x32-10 counter-based generator
+/// of Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3" (SC 2011).
+///
+/// Each output block is a pure function of a 64-bit block counter and a key,
+/// so there is no state to advance other than the counter.  The key is formed
+/// from the seed and the stream number, so every stream with the same seed is
+/// a distinct, independent sequence of 2^64 blocks, with no coordination
+/// needed between threads or MPI processes.
+///
+/// Numbers are generated a block at a time into a small buffer, so the common
+/// case of getRandIn01() is an inlined buffer read.  fillRandIn01() generates
+/// many numbers at once in a loop with no dependencies between iterations,
+/// which compilers can vectorize.
+///
+class Philox
+{
+public:
+  Philox(int streamNum, int numStreams, int seed);
+  ~Philox();
+
+  double getRandIn01();
+  double getRandInRange(double min, double max);
+
+  void fillRandIn01(double * nums, int numNums);
+
+private:
+  /// Number of doubles produced by one block of the generator.
+  ///
+  static const int numsPerBlock = 2;
+
+  /// Number of blocks generated each time the buffer runs out.
+  ///
+  static const int numBufferBlocks = 8;
+
+  static const int bufferSize = numsPerBlock * numBufferBlocks;
+
+  static void generateBlock(uint64_t blockNum, 
+			    uint32_t key0, uint32_t key1,
+			    double * nums);
+
+  void refillBuffer();
+
+  uint32_t key0;
+  uint32_t key1;
+
+  uint64_t nextBlockNum;
+
+  double buffer[bufferSize];
+
+  int bufferIndex;
+};
+
+/// Constructs a random number generator with the given stream number (out of
+/// the given total number of streams) and the given seed.
+///
+inline
+Philox::Philox(int streamNum, int numStreams, int seed) 
+  : key0((uint32_t)seed),
+    key1((uint32_t)streamNum),
+    nextBlockNum(0),
+    buffer(),
+    bufferIndex(bufferSize) {
+
+  assert(streamNum >= 0 && streamNum < numStreams);
+}
+
+inline
+Philox::~Philox() {
+
+}
+
+/// Return a random number in the range [0, 1).
+///
+inline
+double 
+Philox::getRandIn01() {
+  if (bufferIndex == bufferSize) {
+    refillBuffer();
+  }
+
+  return buffer[bufferIndex++];
+}
+
+/// Return a random number in the range [min, max).
+///
+inline
+double 
+Philox::getRandInRange(double min, double max) {
+  return getRandIn01() * (max - min) + min;
+}
+
+/// Writes the given number of random numbers in the range [0, 1) to the given
+/// array.  Produces the same sequence as the same number of calls to
+/// getRandIn01().
+///
+inline
+void
+Philox::fillRandIn01(double * nums, int numNums) {
+  int numNumsDone = 0;
+
+  while (numNumsDone < numNums && bufferIndex < bufferSize) {
+    nums[numNumsDone++] = buffer[bufferIndex++];
+  }
+
+  int numBlocks = (numNums - numNumsDone) / numsPerBlock;
+
+  for (int blockNum = 0; blockNum < numBlocks; blockNum++) {
+    generateBlock(nextBlockNum + blockNum, key0, key1,
+		  nums + numNumsDone + blockNum * numsPerBlock);
+  }
+
+  nextBlockNum += numBlocks;
+  numNumsDone  += numBlocks * numsPerBlock;
+
+  while (numNumsDone < numNums) {
+    nums[numNumsDone++] = getRandIn01();
+  }
+}
+
+/// Refills the buffer with the next blocks of numbers.
+///
+inline
+void
+Philox::refillBuffer() {
+  for (int blockNum = 0; blockNum < numBufferBlocks; blockNum++) {
+    generateBlock(nextBlockNum + blockNum, key0, key1,
+		  buffer + blockNum * numsPerBlock);
+  }
+
+  nextBlockNum += numBufferBlocks;
+
+  bufferIndex = 0;
+}
+
+/// Computes block number blockNum of the stream with the given key and
+/// converts it to two doubles in the range [0, 1), each with 53 random bits.
+///
+inline
+void
+Philox::generateBlock(uint64_t blockNum, 
+		      uint32_t key0, uint32_t key1,
+		      double * nums) {
+
+  const uint32_t multiplier0 = 0xD2511F53;
+  const uint32_t multiplier1 = 0xCD9E8D57;
+
+  const uint32_t keyIncrement0 = 0x9E3779B9;
+  const uint32_t keyIncrement1 = 0xBB67AE85;
+
+  uint32_t x0 = (uint32_t)blockNum;
+  uint32_t x1 = (uint32_t)(blockNum >> 32);
+  uint32_t x2 = 0;
+  uint32_t x3 = 0;
+
+  for (int round = 0; round < 10; round++) {
+    uint64_t product0 = (uint64_t)multiplier0 * x0;
+    uint64_t product1 = (uint64_t)multiplier1 * x2;
+
+    uint32_t y0 = (uint32_t)(product1 >> 32) ^ x1 ^ key0;
+    uint32_t y1 = (uint32_t)product1;
+    uint32_t y2 = (uint32_t)(product0 >> 32) ^ x3 ^ key1;
+    uint32_t y3 = (uint32_t)product0;
+
+    x0 = y0;
+    x1 = y1;
+    x2 = y2;
+    x3 = y3;
+
+    key0 += keyIncrement0;
+    key1 += keyIncrement1;
+  }
+
+  const double twoToMinus53 = 1.0 / 9007199254740992.0;
+
+  nums[0] = ((((uint64_t)x0 << 32) | x1) >> 11) * twoToMinus53;
+  nums[1] = ((((uint64_t)x2 << 32) | x3) >> 11) * twoToMinus53;
+}
+
+// ================================================================
+
+#endif  // #ifndef PHILOX_H_
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// mode: c++
+// End:
@@ -72,6 +72,19 @@ SPRNG::getRandInRange(double min, double max) {
   return num * (max - min) + min;
 }
 
+/// Writes the given number of random numbers in the range [0, 1) to the given
+/// array.  Produces the same sequence as the same number of calls to
+/// getRandIn01().
+///
+void
+SPRNG::fillRandIn01(double * nums, int numNums) {
+  for (int numNum = 0; numNum < numNums; numNum++) {
+    nums[numNum] = stream->sprng();
+
+    assert(nums[numNum] != -1);
+  }
+}
+
 // Local Variables:
 // time-stamp-line-limit: 30
 // mode: c++
@@ -43,6 +43,8 @@ public:
   double getRandIn01();
   double getRandInRange(double min, double max);
 
+  void fillRandIn01(double * nums, int numNums);
+
 private:
   Sprng *stream;
 };
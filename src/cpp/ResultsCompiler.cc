@@ -33,15 +33,24 @@
 #include <cstdlib>
 #include <iostream>
 #include <iomanip>
-#include <thread>
+#include <algorithm>
+
+#include <limits>
 
 #include "ResultsCompiler.h"
+#include "FormFactorKernel.h"
+#include "KahanSum.h"
+#include "Timer.h"
+
+#include "RandomNumber/Philox.h"
 
 // ================================================================
 
 ResultsCompiler::
-ResultsCompiler(Parameters const & parameters) 
+ResultsCompiler(Parameters const & parameters,
+		ThreadPool * threadPool) 
   : parameters(&parameters),
+    threadPool(threadPool),
     boundingSphereRadius(),
     boundingSphereCenter(),
     t(),
@@ -66,6 +75,7 @@ ResultsCompiler(Parameters const & parameters)
     gyrationTensor(),
     gyrationEigenvalues(),
     formFactors(),
+    numFormFactorPairsSampled(0),
     intrinsicViscosityConventionalComputed(false),
     frictionCoefficientComputed(false),
     diffusionCoefficientComputed(false),
@@ -84,13 +94,17 @@ ResultsCompiler::
 /// Derives physical quantities from the Walk-on-Spheres and Interior Sampling
 /// results.  Either of the results may be NULL, in which case only some of the
 /// physical quantities will be computed.  Computation of Form Factors is 
-/// optional, due to speed.
+/// optional, due to speed.  If form factors over all pairs of interior points
+/// would not be computed within the given max time, they are estimated from
+/// as many random pairs as can be taken in that time instead.  The max time
+/// must be the same on every process, and is infinite if there is no limit.
 ///
 void 
 ResultsCompiler::compile(ResultsZeno const * resultsZeno,
 			 ResultsInterior const * resultsInterior,
 			 Sphere<double> const & boundingSphere,
-			 bool computeForm) {
+			 bool computeForm,
+			 double maxFormFactorTime) {
 
   boundingSphereRadius = boundingSphere.getRadius();
   boundingSphereCenter = boundingSphere.getCenter();
@@ -98,11 +112,13 @@ ResultsCompiler::compile(ResultsZeno const * resultsZeno,
   if ((resultsZeno != NULL) &&
       (resultsZeno->getNumHits() == 0.)) {
 
-    std::cerr << "*** Warning ***" << std::endl
-	      << "Number of walker hits is zero.  "
-	      << "Corresponding results will not be computed.  "
-	      << "Try increasing the number of walks?" << std::endl
-	      << std::endl;
+    if (parameters->getMpiRank() == 0) {
+      std::cerr << "*** Warning ***" << std::endl
+		<< "Number of walker hits is zero.  "
+		<< "Corresponding results will not be computed.  "
+		<< "Try increasing the number of walks?" << std::endl
+		<< std::endl;
+    }
 
     resultsZeno = NULL;
   }
@@ -110,11 +126,14 @@ ResultsCompiler::compile(ResultsZeno const * resultsZeno,
   if ((resultsInterior != NULL) &&
       (resultsInterior->getNumHits() == 0.)) {
 
-    std::cerr << "*** Warning ***" << std::endl
-	      << "Number of interior sampler hits is zero.  "
-	      << "Corresponding results will not be computed.  "
-	      << "Try increasing the number of interior samples?" << std::endl
-	      << std::endl;
+    if (parameters->getMpiRank() == 0) {
+      std::cerr << "*** Warning ***" << std::endl
+		<< "Number of interior sampler hits is zero.  "
+		<< "Corresponding results will not be computed.  "
+		<< "Try increasing the number of interior samples?" 
+		<< std::endl
+		<< std::endl;
+    }
 
     resultsInterior = NULL;
   }
@@ -125,16 +144,15 @@ ResultsCompiler::compile(ResultsZeno const * resultsZeno,
 
     Uncertain<double> numZenoHits = resultsZeno->getNumHits();
 
-    Vector3<Uncertain<double> > KPlus  = resultsZeno->getKPlus();
-    Vector3<Uncertain<double> > KMinus = resultsZeno->getKMinus();
+    Vector3<Uncertain<double> > K = resultsZeno->getK();
 
-    Matrix3x3<Uncertain<double> > VPlus  = resultsZeno->getVPlus();
-    Matrix3x3<Uncertain<double> > VMinus = resultsZeno->getVMinus();
+    Matrix3x3<Uncertain<double> > V = resultsZeno->getV();
+    Matrix3x3<Uncertain<double> > W = resultsZeno->getW();
 
     t = numZenoHits/numWalks;
-    u = (KPlus - KMinus)/numWalks;
-    v = (VPlus + VMinus)/numWalks;
-    w = (VPlus - VMinus)/numWalks;
+    u = K/numWalks;
+    v = V/numWalks;
+    w = W/numWalks;
 
     capacitance = computeCapacitance(t, boundingSphereRadius);
 
@@ -203,14 +221,14 @@ ResultsCompiler::compile(ResultsZeno const * resultsZeno,
 
   if (resultsInterior != NULL) {
 
-    double boundingSphereVolume = boundingSphere.getVolume();
+    double sampledVolume = resultsInterior->getSampledVolume();
 
     double numInteriorSamples = resultsInterior->getNumSamples();
 
     numInteriorHits = resultsInterior->getNumHits();
 
     volume = computeVolume(numInteriorHits, numInteriorSamples,
-			   boundingSphereVolume);
+			   sampledVolume);
 
     capacitanceOfASphere = computeCapacitanceOfASphere(volume);
 
@@ -245,8 +263,47 @@ ResultsCompiler::compile(ResultsZeno const * resultsZeno,
 
     formFactorQs = computeFormFactorQs(boundingSphereRadius);
 
-    formFactors = computeFormFactors(*(resultsInterior->getPoints()),
-					       formFactorQs);
+    std::vector<Vector3<double> > const & interiorPoints = 
+      *(resultsInterior->getPointsFromAllProcesses());
+
+    bool samplePairs = parameters->getMaxErrorFormFactorsWasSet();
+
+    if (!samplePairs && 
+	maxFormFactorTime < std::numeric_limits<double>::infinity()) {
+
+      double numPairs = 
+	((double)interiorPoints.size() * interiorPoints.size() - 
+	 interiorPoints.size()) / 2;
+
+      double pairRate = measureFormFactorPairRate(boundingSphere);
+
+      if (numPairs > 0.9 * maxFormFactorTime * pairRate) {
+	samplePairs = true;
+
+	if (parameters->getMpiRank() == 0) {
+	  std::cout << "Form factors estimated from random pairs "
+		    << "to finish within the max run time" << std::endl;
+	}
+      }
+    }
+
+    if (samplePairs) {
+      formFactors = computeFormFactorsSampled(interiorPoints,
+					      formFactorQs,
+					      maxFormFactorTime,
+					      &numFormFactorPairsSampled);
+    }
+    else {
+      std::array<double, numFormFactors> allPairsFormFactors =
+	computeFormFactors(interiorPoints, formFactorQs);
+
+      for (unsigned int factorNum = 0; 
+	   factorNum < numFormFactors; 
+	   ++factorNum) {
+
+	formFactors.at(factorNum) = allPairsFormFactors.at(factorNum);
+      }
+    }
 
     formResultsCompiled = true;
   }
@@ -393,10 +450,10 @@ Uncertain<double>
 ResultsCompiler::
 computeVolume(Uncertain<double> const & numInteriorHits, 
 	      double numInteriorSamples,
-	      double boundingSphereVolume) const {
+	      double sampledVolume) const {
 
   Uncertain<double> volume = 
-    boundingSphereVolume * numInteriorHits / numInteriorSamples;
+    sampledVolume * numInteriorHits / numInteriorSamples;
 
   const double l = parameters->getLengthScaleNumber();
 
@@ -617,6 +674,13 @@ computeFormFactorQs(double boundingSphereRadius) const {
   return qs;
 }
 
+/// Computes the form factor for each q as the mean of sin(qr)/(qr) over the
+/// distances r between all pairs of interior points, either for every pair
+/// or from a histogram of the distances.  Every pair is taken by
+/// FormFactorKernel, with its tiles of pairs divided between MPI processes
+/// and then between threads.  Every process must call this, and every
+/// process returns the same form factors.
+///
 std::array<double, ResultsCompiler::numFormFactors>
 ResultsCompiler::
 computeFormFactors(std::vector<Vector3<double> > const & interiorPoints,
@@ -624,48 +688,45 @@ computeFormFactors(std::vector<Vector3<double> > const & interiorPoints,
 			ResultsCompiler::numFormFactors> const & 
 			formFactorQs) const {
 
+  if (parameters->getHistogramFormFactors()) {
+    return computeFormFactorsHistogram(interiorPoints, formFactorQs);
+  }
+
   BigUInt numPairs = 
     (interiorPoints.size() * interiorPoints.size() - 
      interiorPoints.size()) / 2;
 
-  BigUInt numPairsInProcess = numPairs;
-
-  int numThreads = parameters->getNumThreads(); 
-
-  std::vector<std::array<double, numFormFactors> > threadsFormFactors;
+  FormFactorKernel kernel(interiorPoints,
+			  parameters->getLengthScaleNumber(),
+			  std::vector<double>(formFactorQs.begin(), 
+					      formFactorQs.end()));
 
-  threadsFormFactors.reserve(numThreads);
+  BigUInt processStartTileIndex = 0, processEndTileIndex = 0;
 
-  std::vector<std::thread> threads;
+  getThreadRange(parameters->getMpiRank(),
+		 parameters->getMpiSize(),
+		 kernel.getNumTiles(),
+		 &processStartTileIndex,
+		 &processEndTileIndex);
 
-  threads.reserve(numThreads);
+  int numThreads = threadPool->getNumThreads(); 
 
-  BigUInt threadStartPairIndex = 0;
+  std::vector<std::vector<double> > 
+    threadsFormFactors(numThreads, std::vector<double>(numFormFactors, 0));
 
-  for (int threadNum = 0; threadNum < numThreads; ++threadNum) {
-    BigUInt numPairsInThread = numPairsInProcess / numThreads;
-
-    if ((unsigned int)threadNum < numPairsInProcess % numThreads) {
-      numPairsInThread ++;
-    }
+  threadPool->run([&](int threadNum) {
+      BigUInt threadStartTileIndex = 0, threadEndTileIndex = 0;
 
-    BigUInt threadEndPairIndex = threadStartPairIndex + numPairsInThread;
+      getThreadRange(threadNum,
+		     numThreads,
+		     processEndTileIndex - processStartTileIndex,
+		     &threadStartTileIndex,
+		     &threadEndTileIndex);
 
-    threads.emplace_back(&ResultsCompiler::computeFormFactorsThread,
-			 this,
-			 threadNum,
-			 interiorPoints,
-			 formFactorQs,
-			 threadStartPairIndex,
-			 threadEndPairIndex,
-			 &(threadsFormFactors[threadNum]));
-
-    threadStartPairIndex += numPairsInThread;
-  }
-
-  for (int threadNum = 0; threadNum < numThreads; ++threadNum) {
-    threads.at(threadNum).join();
-  }
+      kernel.addTiles(processStartTileIndex + threadStartTileIndex,
+		      processStartTileIndex + threadEndTileIndex,
+		      &(threadsFormFactors[threadNum]));
+    });
 
   std::array<double, numFormFactors> formFactorsReduced;
 
@@ -684,6 +745,11 @@ computeFormFactors(std::vector<Vector3<double> > const & interiorPoints,
     }
   }
 
+#ifdef USE_MPI
+  MPI_Allreduce(MPI_IN_PLACE, formFactorsReduced.data(), numFormFactors,
+		MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+#endif
+
   for (unsigned int factorNum = 0; 
        factorNum < numFormFactors; 
        ++factorNum) {
@@ -694,34 +760,360 @@ computeFormFactors(std::vector<Vector3<double> > const & interiorPoints,
   return formFactorsReduced;
 }
 
+/// Returns the number of pairs of interior points per second over which form
+/// factors are computed, measured by computing them over all pairs of a fixed
+/// set of points spread through the given bounding sphere, in the same way as
+/// for the interior points.  Every process must call this, and every process
+/// returns the rate measured by MPI process 0.
+///
+double
+ResultsCompiler::
+measureFormFactorPairRate(Sphere<double> const & boundingSphere) {
+
+  boundingSphereRadius = boundingSphere.getRadius();
+  boundingSphereCenter = boundingSphere.getCenter();
+
+  std::array<double, numFormFactors> qs = 
+    computeFormFactorQs(boundingSphereRadius);
+
+  //an additive recurrence with irrational steps spreads the points evenly
+  //through the cube inscribed in the bounding sphere
+
+  const Vector3<double> steps(0.7548776662466927, 
+			      0.5698402909980532, 
+			      0.4301597090019468);
+
+  const double halfWidth = boundingSphereRadius / sqrt(3.);
+
+  std::vector<Vector3<double> > points(numFormFactorRatePoints);
+
+  for (int pointNum = 0; pointNum < numFormFactorRatePoints; ++pointNum) {
+    Vector3<double> fractions;
+
+    for (int dim = 0; dim < 3; ++dim) {
+      fractions.set(dim, fmod(0.5 + pointNum * steps.get(dim), 1.));
+    }
+
+    points[pointNum] = 
+      boundingSphereCenter + (fractions * 2. - 1.) * halfWidth;
+  }
+
+#ifdef USE_MPI
+  MPI_Barrier(MPI_COMM_WORLD);
+#endif
+
+  Timer rateTimer;
+
+  rateTimer.start();
+
+  computeFormFactors(points, qs);
+
+  rateTimer.stop();
+
+  double numPairs = 
+    ((double)numFormFactorRatePoints * numFormFactorRatePoints - 
+     numFormFactorRatePoints) / 2;
+
+  double pairRate = 
+    numPairs / std::max(rateTimer.getTime(), 
+			std::numeric_limits<double>::min());
+
+#ifdef USE_MPI
+  MPI_Bcast(&pairRate, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+#endif
+
+  return pairRate;
+}
+
+/// Estimates the form factors as the mean of sin(qr)/(qr) over random pairs
+/// of interior points, with the standard deviation of each mean as its
+/// uncertainty.  This is the uncertainty from choosing pairs at random, 
+/// relative to the mean over all pairs of the same points.
+///
+/// Pairs are taken in rounds of chunks, each chunk with its own random number
+/// stream, and the chunk results are combined in order, so the results do not
+/// depend on the number of threads or MPI processes.  Each round is computed
+/// in batches of at most numFormFactorChunksPerBatch chunks, which are
+/// divided between processes and then between threads, and every process
+/// must call this.  After each round, the number of pairs
+/// needed to bring the standard deviation of every form factor below the
+/// requested value is estimated from the variances so far.  If that is at
+/// least the number of distinct pairs, all pairs are used instead, and the
+/// returned number of pairs sampled is 0.
+///
+/// Rounds are also cut to the number of pairs that can be taken within the
+/// given max time, at the rate measured so far, and without a max standard
+/// deviation pairs are taken until the time runs out.  The time decisions are
+/// made by MPI process 0 so that all processes agree.
+///
+std::array<Uncertain<double>, ResultsCompiler::numFormFactors>
+ResultsCompiler::
+computeFormFactorsSampled(std::vector<Vector3<double> > const & 
+			  interiorPoints,
+			  std::array<double, 
+			  ResultsCompiler::numFormFactors> const & 
+			  formFactorQs,
+			  double maxTime,
+			  BigUInt * numPairsSampled) const {
+
+  Timer sampleTimer;
+
+  sampleTimer.start();
+
+  BigUInt numPairs = 
+    (interiorPoints.size() * interiorPoints.size() - 
+     interiorPoints.size()) / 2;
+
+  //without a max standard deviation, the max time is what limits the pairs
+  double maxVariance = parameters->getMaxErrorFormFactorsWasSet() ?
+    pow(parameters->getMaxErrorFormFactors(), 2) : 0;
+
+  assert(maxVariance > 0 || 
+	 maxTime < std::numeric_limits<double>::infinity());
+
+  int numThreads = threadPool->getNumThreads(); 
+
+  std::array<KahanSum<double>, numFormFactors> sums;
+  std::array<KahanSum<double>, numFormFactors> sqrSums;
+
+  //chunks are computed in batches of bounded size, and the results of each
+  //batch are added to the sums in chunk order before the next batch
+
+  std::vector<std::array<double, numFormFactors> > 
+    chunksSums(numFormFactorChunksPerBatch);
+
+  std::vector<std::array<double, numFormFactors> > 
+    chunksSqrSums(numFormFactorChunksPerBatch);
+
+  BigUInt numChunksDone = 0;
+
+  BigUInt numChunksInRound = numFormFactorFirstRoundChunks;
+
+  while (numChunksInRound > 0) {
+
+    if ((numChunksDone + numChunksInRound) * numFormFactorPairsPerChunk >=
+	numPairs) {
+
+      *numPairsSampled = 0;
+
+      std::array<double, numFormFactors> allPairsFormFactors =
+	computeFormFactors(interiorPoints, formFactorQs);
+
+      std::array<Uncertain<double>, numFormFactors> sampledFormFactors;
+
+      for (unsigned int factorNum = 0; 
+	   factorNum < numFormFactors; 
+	   ++factorNum) {
+
+	sampledFormFactors.at(factorNum) = allPairsFormFactors.at(factorNum);
+      }
+
+      return sampledFormFactors;
+    }
+
+    for (BigUInt batchStartChunkIndex = 0;
+	 batchStartChunkIndex < numChunksInRound;
+	 batchStartChunkIndex += numFormFactorChunksPerBatch) {
+
+      int numChunksInBatch = 
+	std::min<BigUInt>(numChunksInRound - batchStartChunkIndex,
+			  numFormFactorChunksPerBatch);
+
+      //chunks taken by other processes are left zero, so summing over
+      //processes gathers the chunk results without changing them
+
+      for (int chunkIndex = 0; chunkIndex < numChunksInBatch; ++chunkIndex) {
+	chunksSums[chunkIndex].fill(0);
+	chunksSqrSums[chunkIndex].fill(0);
+      }
+
+      BigUInt processStartChunkIndex = 0, processEndChunkIndex = 0;
+
+      getThreadRange(parameters->getMpiRank(),
+		     parameters->getMpiSize(),
+		     numChunksInBatch,
+		     &processStartChunkIndex,
+		     &processEndChunkIndex);
+
+      threadPool->run([&](int threadNum) {
+	  BigUInt threadStartChunkIndex = 0, threadEndChunkIndex = 0;
+
+	  getThreadRange(threadNum,
+			 numThreads,
+			 processEndChunkIndex - processStartChunkIndex,
+			 &threadStartChunkIndex,
+			 &threadEndChunkIndex);
+
+	  for (BigUInt chunkIndex = 
+		 processStartChunkIndex + threadStartChunkIndex;
+	       chunkIndex < processStartChunkIndex + threadEndChunkIndex;
+	       ++chunkIndex) {
+
+	    computeFormFactorsChunk(interiorPoints,
+				    formFactorQs,
+				    numChunksDone + batchStartChunkIndex + 
+				    chunkIndex,
+				    &(chunksSums[chunkIndex]),
+				    &(chunksSqrSums[chunkIndex]));
+	  }
+	});
+
+#ifdef USE_MPI
+      //at most numFormFactorChunksPerBatch * numFormFactors values, which 
+      //fits in the int count
+      int numValuesInBatch = numChunksInBatch * (int)numFormFactors;
+
+      MPI_Allreduce(MPI_IN_PLACE, chunksSums.data(), 
+		    numValuesInBatch,
+		    MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+      MPI_Allreduce(MPI_IN_PLACE, chunksSqrSums.data(), 
+		    numValuesInBatch,
+		    MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+#endif
+
+      for (int chunkIndex = 0; chunkIndex < numChunksInBatch; ++chunkIndex) {
+
+	for (unsigned int factorNum = 0; 
+	     factorNum < numFormFactors; 
+	     ++factorNum) {
+
+	  sums.at(factorNum).add(chunksSums[chunkIndex].at(factorNum));
+	  sqrSums.at(factorNum).add(chunksSqrSums[chunkIndex].at(factorNum));
+	}
+      }
+    }
+
+    numChunksDone += numChunksInRound;
+
+    double numPairsDone = numChunksDone * numFormFactorPairsPerChunk;
+
+    double maxPairVariance = 0;
+
+    for (unsigned int factorNum = 0; 
+	 factorNum < numFormFactors; 
+	 ++factorNum) {
+
+      double pairVariance = 
+	getSumVariance(sums.at(factorNum).getSum(),
+		       sqrSums.at(factorNum).getSum(),
+		       numPairsDone) / numPairsDone;
+
+      maxPairVariance = std::max(maxPairVariance, pairVariance);
+    }
+
+    double estimatedNumChunksRemaining = 
+      std::numeric_limits<double>::infinity();
+
+    if (maxVariance > 0) {
+      double estimatedNumPairsRemaining = 
+	ceil(maxPairVariance / maxVariance) - numPairsDone;
+
+      estimatedNumChunksRemaining = (estimatedNumPairsRemaining > 0) ?
+	ceil(estimatedNumPairsRemaining / numFormFactorPairsPerChunk) : 0;
+    }
+
+    if (maxTime < std::numeric_limits<double>::infinity()) {
+      double maxNumChunksInRound = 0;
+
+      if (parameters->getMpiRank() == 0) {
+	double timeSoFar = sampleTimer.getTime();
+
+	double timeLeft = std::max(maxTime - timeSoFar, 0.);
+
+	maxNumChunksInRound = 
+	  floor(0.9 * timeLeft * numChunksDone / timeSoFar);
+      }
+
+#ifdef USE_MPI
+      MPI_Bcast(&maxNumChunksInRound, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+#endif
+
+      if (estimatedNumChunksRemaining > maxNumChunksInRound) {
+	estimatedNumChunksRemaining = maxNumChunksInRound;
+
+	if (maxNumChunksInRound == 0 && maxVariance > 0 &&
+	    parameters->getMpiRank() == 0) {
+
+	  std::cout << "Form factor pairs stopped after " 
+		    << (long long)numPairsDone
+		    << " to finish within the max run time" << std::endl;
+	}
+      }
+    }
+
+    numChunksInRound = estimatedNumChunksRemaining;
+  }
+
+  double numPairsDone = numChunksDone * numFormFactorPairsPerChunk;
+
+  *numPairsSampled = numPairsDone;
+
+  std::array<Uncertain<double>, numFormFactors> sampledFormFactors;
+
+  for (unsigned int factorNum = 0; 
+       factorNum < numFormFactors; 
+       ++factorNum) {
+
+    double sumVariance = 
+      getSumVariance(sums.at(factorNum).getSum(),
+		     sqrSums.at(factorNum).getSum(),
+		     numPairsDone);
+
+    sampledFormFactors.at(factorNum) = 
+      Uncertain<double>(sums.at(factorNum).getSum() / numPairsDone,
+			sumVariance / pow(numPairsDone, 2));
+  }
+
+  return sampledFormFactors;
+}
+
+/// Computes the sums and sums of squares of sin(qr)/(qr) over one chunk of
+/// random pairs of distinct interior points.  Each chunk has its own random
+/// number stream, numbered down from the largest stream number so the streams
+/// are not those used for walks and samples.
+///
 void
 ResultsCompiler::
-computeFormFactorsThread(int threadNum,
-			      std::vector<Vector3<double> > const & 
-			      interiorPoints,
-			      std::array<double, 
-			      ResultsCompiler::numFormFactors> const & 
-			      formFactorQs,
-			      BigUInt startPairIndex,
-			      BigUInt endPairIndex,
-			      std::array<double, numFormFactors> * 
-			      threadFormFactors) const {
+computeFormFactorsChunk(std::vector<Vector3<double> > const & 
+			interiorPoints,
+			std::array<double, 
+			ResultsCompiler::numFormFactors> const & 
+			formFactorQs,
+			BigUInt chunkNum,
+			std::array<double, numFormFactors> * chunkSums,
+			std::array<double, numFormFactors> * chunkSqrSums) 
+  const {
 
   const double l = parameters->getLengthScaleNumber();
 
-  threadFormFactors->fill(0);
+  const int numStreams = std::numeric_limits<int>::max();
 
-  for (BigUInt pairIndex = startPairIndex;
-       pairIndex < endPairIndex;
-       ++pairIndex) {
+  Philox randomNumberGenerator(numStreams - 1 - chunkNum, 
+			       numStreams, 
+			       parameters->getSeed());
+
+  BigUInt numPoints = interiorPoints.size();
+
+  chunkSums->fill(0);
+  chunkSqrSums->fill(0);
 
-    BigUInt i = 0, j = 0;
+  for (int pairNum = 0; pairNum < numFormFactorPairsPerChunk; ++pairNum) {
 
-    indexToIJ(pairIndex, &i, &j);
+    //choose j from the points other than i, so every pair of distinct points
+    //is equally likely
+    BigUInt i = randomNumberGenerator.getRandIn01() * numPoints;
+    BigUInt j = randomNumberGenerator.getRandIn01() * (numPoints - 1);
+
+    i = std::min(i, numPoints - 1);
+    j = std::min(j, numPoints - 2);
+
+    if (j >= i) {
+      ++j;
+    }
 
     double distance = 
-      (interiorPoints.at(i) - 
-       interiorPoints.at(j)).getMagnitude();
+      (interiorPoints[i] - interiorPoints[j]).getMagnitude();
 
     distance *= l;
 
@@ -731,19 +1123,237 @@ computeFormFactorsThread(int threadNum,
 
       double q = formFactorQs.at(factorNum);
 
-      double divisor = q*distance;
+      double sinc = computeSinc(q*distance);
 
-      //use Taylor expansion of sin(x)/x for small x
-      if (divisor < 0.001) {
-	threadFormFactors->at(factorNum) +=
-	  1. - pow(divisor, 2)/6.;
-      }
-      else {
-	threadFormFactors->at(factorNum) += 
-	  sin(divisor)/divisor;
-      }
+      chunkSums->at(factorNum)    += sinc;
+      chunkSqrSums->at(factorNum) += sinc * sinc;
+    }
+  }
+}
+
+/// Computes the form factors from a histogram of the distances between all
+/// pairs of interior points, which takes one pass over the pairs with no
+/// transcendental functions.  Each bin holds the number of pairs and the sum
+/// of their distances from the start of the bin, and the Debye formula is
+/// evaluated once per bin at the mean distance of its pairs.
+///
+/// Evaluating at the mean makes the first-order error in each bin vanish, so
+/// the error in each form factor is at most q^2 h^2 / 24 for bin width h,
+/// since |d^2/dx^2 sin(x)/x| <= 1/3.  The bin width is chosen so this bound
+/// is at most 0.01 / N for N points at the largest q, which is below the
+/// sampling error of form factors computed from N points.
+///
+/// The pairs are divided between MPI processes and then between threads, and
+/// the histograms are summed over all of them, so every process must call
+/// this.
+///
+std::array<double, ResultsCompiler::numFormFactors>
+ResultsCompiler::
+computeFormFactorsHistogram(std::vector<Vector3<double> > const & 
+			    interiorPoints,
+			    std::array<double, 
+			    ResultsCompiler::numFormFactors> const & 
+			    formFactorQs) const {
+
+  const double l = parameters->getLengthScaleNumber();
+
+  BigUInt numPairs = 
+    (interiorPoints.size() * interiorPoints.size() - 
+     interiorPoints.size()) / 2;
+
+  //distances are binned in the units of the points, without length scale
+
+  double maxQ = formFactorQs.at(numFormFactors - 1) * l;
+
+  double maxError = 0.01 / std::max<double>(interiorPoints.size(), 1);
+
+  double binWidth = sqrt(24 * maxError) / maxQ;
+
+  //all points are inside the bounding sphere
+
+  std::size_t numBins = ceil(2 * boundingSphereRadius / binWidth) + 1;
+
+  BigUInt processStartPairIndex = 0, processEndPairIndex = 0;
+
+  getThreadRange(parameters->getMpiRank(),
+		 parameters->getMpiSize(),
+		 numPairs,
+		 &processStartPairIndex,
+		 &processEndPairIndex);
+
+  int numThreads = threadPool->getNumThreads(); 
+
+  std::vector<std::vector<BigUInt> > threadsBinCounts(numThreads);
+  std::vector<std::vector<double> > threadsBinOffsetSums(numThreads);
+
+  threadPool->run([&](int threadNum) {
+      BigUInt threadStartPairIndex = 0, threadEndPairIndex = 0;
+
+      getThreadRange(threadNum,
+			 numThreads,
+			 processEndPairIndex - processStartPairIndex,
+			 &threadStartPairIndex,
+			 &threadEndPairIndex);
+
+      threadsBinCounts[threadNum].assign(numBins, 0);
+      threadsBinOffsetSums[threadNum].assign(numBins, 0);
+
+      computeDistanceHistogramThread(interiorPoints,
+				     binWidth,
+				     processStartPairIndex + 
+				     threadStartPairIndex,
+				     processStartPairIndex + 
+				     threadEndPairIndex,
+				     &(threadsBinCounts[threadNum]),
+				     &(threadsBinOffsetSums[threadNum]));
+    });
+
+  for (int threadNum = 1; 
+       threadNum < numThreads; 
+       ++threadNum) {
+
+    for (std::size_t binNum = 0; binNum < numBins; ++binNum) {
+      threadsBinCounts[0][binNum] += threadsBinCounts[threadNum][binNum];
+
+      threadsBinOffsetSums[0][binNum] += 
+	threadsBinOffsetSums[threadNum][binNum];
+    }
+  }
+
+#ifdef USE_MPI
+  static_assert(sizeof(BigUInt) == sizeof(uint64_t), 
+		"bin counts are reduced as MPI_UINT64_T");
+
+  MPI_Allreduce(MPI_IN_PLACE, threadsBinCounts[0].data(), numBins,
+		MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+
+  MPI_Allreduce(MPI_IN_PLACE, threadsBinOffsetSums[0].data(), numBins,
+		MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+#endif
+
+  std::vector<BigUInt> const & binCounts = threadsBinCounts[0];
+  std::vector<double> const & binOffsetSums = threadsBinOffsetSums[0];
+
+  std::array<double, numFormFactors> formFactorsReduced;
+
+  formFactorsReduced.fill(0);
+
+  for (std::size_t binNum = 0; binNum < numBins; ++binNum) {
+
+    if (binCounts[binNum] == 0) {
+      continue;
+    }
+
+    double meanDistance = 
+      binNum * binWidth + binOffsetSums[binNum] / binCounts[binNum];
+
+    meanDistance *= l;
+
+    for (unsigned int factorNum = 0; 
+	 factorNum < numFormFactors; 
+	 ++factorNum) {
+
+      double q = formFactorQs.at(factorNum);
+
+      formFactorsReduced.at(factorNum) += 
+	binCounts[binNum] * computeSinc(q*meanDistance);
     }
   }
+
+  for (unsigned int factorNum = 0; 
+       factorNum < numFormFactors; 
+       ++factorNum) {
+
+    formFactorsReduced.at(factorNum) /= numPairs;
+  }
+
+  return formFactorsReduced;
+}
+
+/// Adds the distances between the given range of pairs of interior points to
+/// a histogram.  Offsets from the start of each bin are summed, rather than
+/// distances, to keep the sums accurate for bins with many pairs.
+///
+void
+ResultsCompiler::
+computeDistanceHistogramThread(std::vector<Vector3<double> > const & 
+			       interiorPoints,
+			       double binWidth,
+			       BigUInt startPairIndex,
+			       BigUInt endPairIndex,
+			       std::vector<BigUInt> * binCounts,
+			       std::vector<double> * binOffsetSums) const {
+
+  if (startPairIndex >= endPairIndex) {
+    return;
+  }
+
+  std::size_t lastBinNum = binCounts->size() - 1;
+
+  BigUInt i = 0, j = 0;
+
+  indexToIJ(startPairIndex, &i, &j);
+
+  //step through the pairs in index order rather than inverting every index
+
+  for (BigUInt pairIndex = startPairIndex;
+       pairIndex < endPairIndex;
+       ++pairIndex) {
+
+    double distance = (interiorPoints[i] - interiorPoints[j]).getMagnitude();
+
+    std::size_t binNum = std::min<std::size_t>(distance / binWidth, 
+					       lastBinNum);
+
+    (*binCounts)[binNum]++;
+    (*binOffsetSums)[binNum] += distance - binNum * binWidth;
+
+    ++i;
+
+    if (i == j) {
+      i = 0;
+      ++j;
+    }
+  }
+}
+
+/// Divides a number of items as evenly as possible between a number of
+/// threads, and returns the range of item indices for the given thread.  Also
+/// used to divide items between MPI processes.
+///
+void
+ResultsCompiler::
+getThreadRange(int threadNum,
+	       int numThreads,
+	       BigUInt numItems,
+	       BigUInt * startIndex,
+	       BigUInt * endIndex) const {
+
+  *startIndex = 
+    numItems / numThreads * threadNum + 
+    std::min<BigUInt>(threadNum, numItems % numThreads);
+
+  BigUInt numItemsInThread = numItems / numThreads;
+
+  if ((unsigned int)threadNum < numItems % numThreads) {
+    numItemsInThread ++;
+  }
+
+  *endIndex = *startIndex + numItemsInThread;
+}
+
+/// Returns sin(x)/x, using its Taylor expansion for small x.
+///
+double
+ResultsCompiler::
+computeSinc(double x) const {
+
+  if (x < 0.001) {
+    return 1. - pow(x, 2)/6.;
+  }
+  else {
+    return sin(x)/x;
+  }
 }
 
 /// Inverts the formula: 
@@ -900,6 +1510,13 @@ print(bool printCounts) const {
 
   if (formResultsCompiled) {
 
+    //form factors from all pairs have no uncertainty to print
+    if (numFormFactorPairsSampled > 0) {
+      std::cout << "Form factor pairs sampled: " 
+		<< numFormFactorPairsSampled << std::endl
+		<< std::endl;
+    }
+
     std::cout << "Form factor: " << std::endl;
 
     for (unsigned int factorNum = 0; 
@@ -909,8 +1526,14 @@ print(bool printCounts) const {
       std::cout << std::scientific
 		<< formFactorQs.at(factorNum) << " ("
 		<< Units::getName(parameters->getLengthScaleUnit())
-		<< "^-1): "
-		<< formFactors.at(factorNum) << std::endl;
+		<< "^-1): ";
+
+      if (numFormFactorPairsSampled > 0) {
+	std::cout << formFactors.at(factorNum) << std::endl;
+      }
+      else {
+	std::cout << formFactors.at(factorNum).getMean() << std::endl;
+      }
     }
 
     std::cout << std::endl;
@@ -38,6 +38,7 @@
 #include "ResultsInterior.h"
 #include "Uncertain.h"
 #include "Parameters.h"
+#include "ThreadPool.h"
 
 #include "Geometry/Vector3.h"
 #include "Geometry/Matrix3x3.h"
@@ -50,14 +51,18 @@
 ///
 class ResultsCompiler {
 public:
-  ResultsCompiler(Parameters const & parameters);
+  ResultsCompiler(Parameters const & parameters,
+		  ThreadPool * threadPool);
 
   ~ResultsCompiler();
 
   void compile(ResultsZeno const * resultsZeno,
 	       ResultsInterior const * resultsInterior,
 	       Sphere<double> const & boundingSphere,
-	       bool computeForm);
+	       bool computeForm,
+	       double maxFormFactorTime);
+
+  double measureFormFactorPairRate(Sphere<double> const & boundingSphere);
 
   void print(bool printCounts) const;
 
@@ -72,6 +77,27 @@ private:
 
   static const unsigned int numFormFactors = 81;
 
+  /// Number of random pairs in each separately seeded chunk when form factors
+  /// are estimated from random pairs of points.
+  ///
+  static const int numFormFactorPairsPerChunk = 4096;
+
+  /// Number of chunks of random pairs in the first round, which is used to
+  /// estimate how many pairs are needed.
+  ///
+  static const int numFormFactorFirstRoundChunks = 16;
+
+  /// Largest number of chunks of random pairs computed and combined at once,
+  /// which bounds the memory for chunk results however many pairs a round
+  /// needs.
+  ///
+  static const int numFormFactorChunksPerBatch = 1024;
+
+  /// Number of points over whose pairs the rate of computing form factors is
+  /// measured.
+  ///
+  static const int numFormFactorRatePoints = 256;
+
   Uncertain<double> 
   computeCapacitance(Uncertain<double> const & t, 
 		     double boundingSphereRadius) const;
@@ -98,7 +124,7 @@ private:
   Uncertain<double>
   computeVolume(Uncertain<double> const & numInteriorHits, 
 		double numInteriorSamples,
-		double boundingSphereVolume) const;
+		double sampledVolume) const;
 
   Uncertain<double>
   computeIntrinsicConductivity(Uncertain<double> const & meanPolarizability,
@@ -157,22 +183,56 @@ private:
 		     numFormFactors> const & 
 		     formFactorQs) const;
 
+  std::array<Uncertain<double>, numFormFactors>
+  computeFormFactorsSampled(std::vector<Vector3<double> > const & 
+			    interiorPoints,
+			    std::array<double, 
+			    numFormFactors> const & 
+			    formFactorQs,
+			    double maxTime,
+			    BigUInt * numPairsSampled) const;
+
   void
-  computeFormFactorsThread(int threadNum,
-			   std::vector<Vector3<double> > const & 
-			   interiorPoints,
-			   std::array<double, 
-			   numFormFactors> const & 
-			   formFactorQs,
-			   BigUInt startPairIndex,
-			   BigUInt endPairIndex,
-			   std::array<double, numFormFactors> * 
-			   threadFormFactors) const;
+  computeFormFactorsChunk(std::vector<Vector3<double> > const & 
+			  interiorPoints,
+			  std::array<double, 
+			  numFormFactors> const & 
+			  formFactorQs,
+			  BigUInt chunkNum,
+			  std::array<double, numFormFactors> * chunkSums,
+			  std::array<double, numFormFactors> * chunkSqrSums) 
+    const;
+
+  std::array<double, numFormFactors>
+  computeFormFactorsHistogram(std::vector<Vector3<double> > const & 
+			      interiorPoints,
+			      std::array<double, 
+			      numFormFactors> const & 
+			      formFactorQs) const;
+
+  void
+  computeDistanceHistogramThread(std::vector<Vector3<double> > const & 
+				 interiorPoints,
+				 double binWidth,
+				 BigUInt startPairIndex,
+				 BigUInt endPairIndex,
+				 std::vector<BigUInt> * binCounts,
+				 std::vector<double> * binOffsetSums) const;
+
+  void getThreadRange(int threadNum,
+		      int numThreads,
+		      BigUInt numItems,
+		      BigUInt * startIndex,
+		      BigUInt * endIndex) const;
+
+  double computeSinc(double x) const;
 
   void indexToIJ(BigUInt index, BigUInt * i, BigUInt * j) const;
 
   Parameters const * parameters;
 
+  ThreadPool * threadPool;
+
   double boundingSphereRadius;
   Vector3<double> boundingSphereCenter;
 
@@ -201,7 +261,8 @@ private:
   Matrix3x3<Uncertain<double> > gyrationTensor;
   Vector3<Uncertain<double> > gyrationEigenvalues;
   std::array<double, numFormFactors> formFactorQs;
-  std::array<double, numFormFactors> formFactors;
+  std::array<Uncertain<double>, numFormFactors> formFactors;
+  BigUInt numFormFactorPairsSampled;
 
   bool intrinsicViscosityConventionalComputed;
   bool frictionCoefficientComputed;
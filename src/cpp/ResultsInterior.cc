@@ -31,26 +31,56 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <climits>
+#include <iostream>
+#include <algorithm>
 
 #include "ResultsInterior.h"
 
 // ================================================================
 
 /// Constructs the class to collect results from the given number of threads,
-/// and optionally save the hit point locations.
+/// and optionally save the hit point locations.  The sampled volume is the
+/// volume of the region that sample points are drawn from, such that the
+/// volume of the object is the sampled volume times the mean hit weight.
+///
+/// If fixedReductionOrder is set, each thread number is a slot that only one
+/// MPI process records to, and reduce() combines the slots in order of their
+/// number no matter which process recorded them, so the reduced results do not
+/// depend on the number of MPI processes.
+///
+/// If reservoirSize is positive, a uniform random subset of at most that many
+/// hit locations is kept, for computations such as form factors that need
+/// hit locations but not all of them.  Each location gets a random key, each
+/// thread keeps the locations with the smallest keys, and the locations with
+/// the smallest keys overall are gathered, independently of whether all hit
+/// locations are also saved.
+///
+/// If streamPointsFileName is not empty, hit points are written to that file
+/// from fixed-size per-thread buffers as samples are recorded, independently
+/// of whether they are also saved in memory.
+///
+/// If compensatedSums is set, each thread keeps compensated sums and sums of
+/// squares, and variances are computed only by reduce(), rather than updating
+/// running variances after every sample.  A miss then only increments the
+/// sample count.
 ///
 ResultsInterior::
 ResultsInterior(int numThreads,
-		bool saveHitPoints)
+		double sampledVolume,
+		bool saveHitPoints,
+		long long reservoirSize,
+		bool fixedReductionOrder,
+		bool compensatedSums,
+		std::string const & streamPointsFileName)
   : numThreads(numThreads),
+    sampledVolume(sampledVolume),
     saveHitPoints(saveHitPoints),
-    numSamples(NULL),
-    hitMissMean(NULL),
-    hitMissM2(NULL),
-    hitPointsSqrMean(NULL),
-    hitPointsSqrM2(NULL),
-    hitPointsMean(NULL),
-    hitPointsM2(NULL),
+    reservoirSize(reservoirSize),
+    fixedReductionOrder(fixedReductionOrder),
+    compensatedSums(compensatedSums),
+    pointsWriter(NULL),
+    threadResults(NULL),
     numSamplesReduced(0),
     numHitsReduced(0),
     numHitsVarianceReduced(0),
@@ -62,90 +92,198 @@ ResultsInterior(int numThreads,
 				   0, 0, 0),
     hitPointsSumReduced(0, 0, 0),
     hitPointsSumVarianceReduced(0, 0, 0),
-    points(NULL),
     gatheredPoints(),
-    reduced(true),
-    hitPointsGathered(true) {
+    allProcessesPoints() {
 
-  numSamples = new double[numThreads];
+  threadResults = new ThreadResults *[numThreads];
 
-  hitMissMean = new double[numThreads];
-  hitMissM2   = new double[numThreads];
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    threadResults[threadNum] = NULL;
+  }
 
-  hitPointsSqrMean = new Matrix3x3<double>[numThreads];
-  hitPointsSqrM2   = new Matrix3x3<double>[numThreads];
+  if (!streamPointsFileName.empty()) {
+    pointsWriter = new PointsWriter(streamPointsFileName, false);
+  }
+}
 
-  hitPointsMean = new Vector3<double>[numThreads];
-  hitPointsM2   = new Vector3<double>[numThreads];
+ResultsInterior::
+~ResultsInterior() {
+  if (pointsWriter != NULL) {
+    flushHitPoints();
+
+    delete pointsWriter;
+  }
 
   for (int threadNum = 0; threadNum < numThreads; threadNum++) {
-    numSamples[threadNum] = 0;
+    deleteCacheAligned(threadResults[threadNum]);
+  }
 
-    hitMissMean[threadNum] = 0;
-    hitMissM2[threadNum]   = 0;
+  delete [] threadResults;
+}
 
-    for (int component = 0; component < 3*3; component++) {
-      hitPointsSqrMean[threadNum].set(component, 0);
-      hitPointsSqrM2[threadNum].set(component, 0);
-    }
+ResultsInterior::ThreadResults::
+ThreadResults()
+  : numSamples(0),
+    hitMissMean(0),
+    hitMissM2(0),
+    hitPointsSqrMean(),
+    hitPointsSqrM2(),
+    hitPointsMean(),
+    hitPointsM2(),
+    hitMissSum(),
+    hitMissSumOfSquares(),
+    hitPointsSqrSum(),
+    hitPointsSqrSumOfSquares(),
+    hitPointsSum(),
+    hitPointsSumOfSquares(),
+    points(),
+    streamPoints(),
+    reservoirPoints(),
+    reduced(true),
+    hitPointsGathered(true) {
+
+}
+
+/// Returns the results recorded to the given thread number, allocating them
+/// on first use by the thread recording to it.
+///
+ResultsInterior::ThreadResults *
+ResultsInterior::
+getThreadResults(int threadNum) {
+  assert(threadNum >= 0 && threadNum < numThreads);
 
-    hitPointsMean[threadNum].setXYZ(0, 0, 0);
-    hitPointsM2[threadNum].setXYZ(0, 0, 0);
+  if (threadResults[threadNum] == NULL) {
+    threadResults[threadNum] = newCacheAligned<ThreadResults>();
   }
 
-  points = new std::vector<Vector3<double> >[numThreads];
+  return threadResults[threadNum];
 }
 
+/// Returns whether the reduced results include every sample recorded by all
+/// threads.  Must not be called while threads are recording.
+///
+bool
 ResultsInterior::
-~ResultsInterior() {
-  delete [] numSamples;
+getReduced() const {
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    if (threadResults[threadNum] != NULL &&
+	!threadResults[threadNum]->reduced) {
 
-  delete [] hitMissMean;
-  delete [] hitMissM2;
+      return false;
+    }
+  }
+
+  return true;
+}
 
-  delete [] hitPointsSqrMean;
-  delete [] hitPointsSqrM2;
+/// Returns whether the gathered hit locations are up to date for all threads.
+/// Must not be called while threads are recording.
+///
+bool
+ResultsInterior::
+getHitPointsGathered() const {
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    if (threadResults[threadNum] != NULL &&
+	!threadResults[threadNum]->hitPointsGathered) {
 
-  delete [] hitPointsMean;
-  delete [] hitPointsM2;
+      return false;
+    }
+  }
+
+  return true;
 }
 
-/// Record a hit from the given thread number at the given location.
+/// Record a hit with the given weight from the given thread number at the
+/// given location.  The hit counts, and the sums of hit locations used for
+/// the gyration tensor, are weighted.  If hit points are being saved, the
+/// location is saved only if the given flag is set, and likewise for the
+/// reservoir, using the given key.
 ///
 void 
 ResultsInterior::
-recordHit(int threadNum,
-	  Vector3<double> const & point) {
+recordKeyedHit(int threadNum,
+	       Vector3<double> const & point,
+	       double weight,
+	       bool savePoint,
+	       double reservoirKey) {
 
-  assert(threadNum >= 0 && threadNum < numThreads);
+  ThreadResults * results = getThreadResults(threadNum);
 
-  reduced = false;
+  results->reduced = false;
 
-  numSamples[threadNum] ++;
+  results->numSamples ++;
 
-  double hitMissData = 1;
+  double hitMissData = weight;
 
   Matrix3x3<double> hitPointsSqrData;
 
   for (int row = 0; row < 3; ++row) {
     for (int col = 0; col < 3; ++col) {
-      double element = point.get(row) * point.get(col);
+      double element = point.get(row) * point.get(col) * weight;
 
       hitPointsSqrData.set(row, col, element);
     }
   }
 
-  Vector3<double> hitPointsData(point);
+  Vector3<double> hitPointsData(point * weight);
 
-  updateVariance(threadNum,
-		 hitMissData,
-		 hitPointsSqrData,
-		 hitPointsData);
+  if (compensatedSums) {
+    results->hitMissSum.add(hitMissData);
+    results->hitMissSumOfSquares.add(hitMissData * hitMissData);
 
-  if (saveHitPoints) {
-    hitPointsGathered = false;
+    results->hitPointsSqrSum.add(hitPointsSqrData);
+    results->hitPointsSqrSumOfSquares.add(hitPointsSqrData * hitPointsSqrData);
 
-    points[threadNum].push_back(point);
+    results->hitPointsSum.add(hitPointsData);
+    results->hitPointsSumOfSquares.add(hitPointsData * hitPointsData);
+  }
+  else {
+    updateVariance(results,
+		   hitMissData,
+		   hitPointsSqrData,
+		   hitPointsData);
+  }
+
+  if (saveHitPoints && savePoint) {
+    results->hitPointsGathered = false;
+
+    results->points.push_back(point);
+  }
+
+  if (reservoirSize > 0 && savePoint) {
+    std::vector<KeyedPoint> & reservoirPoints = results->reservoirPoints;
+
+    //once the reservoir is full, only a key smaller than the largest one
+    //changes it, which becomes rare as more samples are taken
+    if (reservoirPoints.size() < (size_t)reservoirSize) {
+      results->hitPointsGathered = false;
+
+      reservoirPoints.push_back(KeyedPoint(reservoirKey, point));
+
+      std::push_heap(reservoirPoints.begin(), reservoirPoints.end(),
+		     compareKeys);
+    }
+    else if (reservoirKey < reservoirPoints.front().first) {
+      results->hitPointsGathered = false;
+
+      std::pop_heap(reservoirPoints.begin(), reservoirPoints.end(),
+		    compareKeys);
+
+      reservoirPoints.back() = KeyedPoint(reservoirKey, point);
+
+      std::push_heap(reservoirPoints.begin(), reservoirPoints.end(),
+		     compareKeys);
+    }
+  }
+
+  if (pointsWriter != NULL && savePoint) {
+    results->streamPoints.push_back(point);
+
+    if (results->streamPoints.size() >= 
+	(size_t)PointsWriter::bufferNumPoints) {
+
+      flushThreadPoints(results);
+    }
   }
 }
 
@@ -154,11 +292,16 @@ recordHit(int threadNum,
 void 
 ResultsInterior::
 recordMiss(int threadNum) {
-  assert(threadNum >= 0 && threadNum < numThreads);
+  ThreadResults * results = getThreadResults(threadNum);
 
-  reduced = false;
+  results->reduced = false;
 
-  numSamples[threadNum] ++;
+  results->numSamples ++;
+
+  //a miss adds nothing to the sums
+  if (compensatedSums) {
+    return;
+  }
 
   double hitMissData = 0;
 
@@ -168,7 +311,7 @@ recordMiss(int threadNum) {
 
   Vector3<double> hitPointsData(0, 0, 0);
 
-  updateVariance(threadNum, 
+  updateVariance(results, 
 		 hitMissData,
 		 hitPointsSqrData,
 		 hitPointsData);
@@ -180,185 +323,408 @@ recordMiss(int threadNum) {
 void 
 ResultsInterior::
 reduce() {
-  if (reduced) {
+  if (getReduced()) {
     return;
   }
 
-  numSamplesReduced = 0;
-
-  numHitsReduced         = 0;
-  numHitsVarianceReduced = 0;
+  std::vector<double> threadSums(numThreads * numReducedValues);
 
-  for (int component = 0; component < 3*3; component++) {
-    hitPointsSqrSumReduced.set(component, 0);
-    hitPointsSqrSumVarianceReduced.set(component, 0);
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    getThreadSums(threadNum, &threadSums[threadNum * numReducedValues]);
   }
 
-  hitPointsSumReduced.setXYZ(0, 0, 0);
-  hitPointsSumVarianceReduced.setXYZ(0, 0, 0);
+#ifdef USE_MPI
+  if (fixedReductionOrder) {
+    std::vector<double> recvbuf(threadSums.size(), 0);
 
-  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    //each slot is zero on all but one MPI process, so this sum is exact
+    MPI_Allreduce(threadSums.data(), recvbuf.data(), threadSums.size(), 
+		  MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
 
-    numSamplesReduced += numSamples[threadNum];
+    threadSums.swap(recvbuf);
+  }
+#endif
 
-    reduceItem(hitMissMean[threadNum],
-	       hitMissM2[threadNum],
-	       numSamples[threadNum],
-	       &numHitsReduced,
-	       &numHitsVarianceReduced);
+  double sendbuf[numReducedValues];
 
-    reduceItem(hitPointsSqrMean[threadNum],
-	       hitPointsSqrM2[threadNum],
-	       numSamples[threadNum],
-	       &hitPointsSqrSumReduced,
-	       &hitPointsSqrSumVarianceReduced);
+  for (int i = 0; i < numReducedValues; i++) {
+    sendbuf[i] = 0;
+  }
 
-    reduceItem(hitPointsMean[threadNum],
-	       hitPointsM2[threadNum],
-	       numSamples[threadNum],
-	       &hitPointsSumReduced,
-	       &hitPointsSumVarianceReduced);
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    for (int i = 0; i < numReducedValues; i++) {
+      sendbuf[i] += threadSums[threadNum * numReducedValues + i];
+    }
+  }
+
+  double recvbuf[numReducedValues];
+
+  for (int i = 0; i < numReducedValues; i++) {
+    recvbuf[i] = sendbuf[i];
   }
 
 #ifdef USE_MPI
-  const int mpiBufferSize = 27; 
+  if (!fixedReductionOrder) {
+    // MPI_Reduce(sendbuf, recvbuf, numReducedValues, MPI_DOUBLE,
+    // 	       MPI_SUM, 0, MPI_COMM_WORLD);
 
-  double sendbuf[mpiBufferSize];
+    MPI_Allreduce(sendbuf, recvbuf, numReducedValues, MPI_DOUBLE,
+		  MPI_SUM, MPI_COMM_WORLD);
+  }
+#endif
 
   int offset = 0;
 
-  sendbuf[offset++] = numSamplesReduced;
+  numSamplesReduced = recvbuf[offset++];
 
-  sendbuf[offset++] = numHitsReduced;
-  sendbuf[offset++] = numHitsVarianceReduced;
+  numHitsReduced         = recvbuf[offset++];
+  numHitsVarianceReduced = recvbuf[offset++];
 
   for (int i = 0; i < 9; i++) {
-    sendbuf[offset++] = hitPointsSqrSumReduced.get(i);
-    sendbuf[offset++] = hitPointsSqrSumVarianceReduced.get(i);
+    hitPointsSqrSumReduced.set(i, recvbuf[offset++]);
+    hitPointsSqrSumVarianceReduced.set(i, recvbuf[offset++]);
   }
 
   for (int i = 0; i < 3; i++) {
-    sendbuf[offset++] = hitPointsSumReduced.get(i);
-    sendbuf[offset++] = hitPointsSumVarianceReduced.get(i);
+    hitPointsSumReduced.set(i, recvbuf[offset++]);
+    hitPointsSumVarianceReduced.set(i, recvbuf[offset++]);
   }
 
-  double recvbuf[mpiBufferSize];
+  assert(offset == numReducedValues);
 
-  for (int i = 0; i < mpiBufferSize; i++) {
-    recvbuf[i] = 0;
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    if (threadResults[threadNum] != NULL) {
+      threadResults[threadNum]->reduced = true;
+    }
   }
+}
+
+/// Computes the sums and corresponding variances of the hit counts and
+/// locations from the given thread number, and stores them in the given array
+/// in the order used by reduce().
+///
+void 
+ResultsInterior::
+getThreadSums(int threadNum, double * sums) const {
 
-  // MPI_Reduce(sendbuf, recvbuf, mpiBufferSize, MPI_DOUBLE,
-  // 	     MPI_SUM, 0, MPI_COMM_WORLD);
+  ThreadResults const * results = threadResults[threadNum];
 
-  MPI_Allreduce(sendbuf, recvbuf, mpiBufferSize, MPI_DOUBLE,
-		MPI_SUM, MPI_COMM_WORLD);
+  //thread numbers that were never recorded to have no results allocated
+  if (results == NULL) {
+    for (int i = 0; i < numReducedValues; i++) {
+      sums[i] = 0;
+    }
 
-  offset = 0;
+    return;
+  }
 
-  numSamplesReduced = recvbuf[offset++];
+  double numHits         = 0;
+  double numHitsVariance = 0;
 
-  numHitsReduced         = recvbuf[offset++];
-  numHitsVarianceReduced = recvbuf[offset++];
+  Matrix3x3<double> hitPointsSqrSum(0, 0, 0,
+				    0, 0, 0,
+				    0, 0, 0);
+
+  Matrix3x3<double> hitPointsSqrSumVariance(0, 0, 0,
+					    0, 0, 0,
+					    0, 0, 0);
+
+  Vector3<double> hitPointsSum(0, 0, 0);
+  Vector3<double> hitPointsSumVariance(0, 0, 0);
+
+  if (compensatedSums) {
+    const double numSamples = results->numSamples;
+
+    numHits         = results->hitMissSum.getSum();
+    numHitsVariance = getSumVariance(results->hitMissSum.getSum(),
+				     results->hitMissSumOfSquares.getSum(),
+				     numSamples);
+
+    for (int i = 0; i < 9; i++) {
+      double sum = results->hitPointsSqrSum.getSum().get(i);
+
+      hitPointsSqrSum.set(i, sum);
+      hitPointsSqrSumVariance.set(i, 
+	getSumVariance(sum,
+		       results->hitPointsSqrSumOfSquares.getSum().get(i),
+		       numSamples));
+    }
+
+    for (int i = 0; i < 3; i++) {
+      double sum = results->hitPointsSum.getSum().get(i);
+
+      hitPointsSum.set(i, sum);
+      hitPointsSumVariance.set(i, 
+	getSumVariance(sum,
+		       results->hitPointsSumOfSquares.getSum().get(i),
+		       numSamples));
+    }
+  }
+  else {
+    reduceItem(results->hitMissMean,
+	       results->hitMissM2,
+	       results->numSamples,
+	       &numHits,
+	       &numHitsVariance);
+
+    reduceItem(results->hitPointsSqrMean,
+	       results->hitPointsSqrM2,
+	       results->numSamples,
+	       &hitPointsSqrSum,
+	       &hitPointsSqrSumVariance);
+
+    reduceItem(results->hitPointsMean,
+	       results->hitPointsM2,
+	       results->numSamples,
+	       &hitPointsSum,
+	       &hitPointsSumVariance);
+  }
+
+  int offset = 0;
+
+  sums[offset++] = results->numSamples;
+
+  sums[offset++] = numHits;
+  sums[offset++] = numHitsVariance;
 
   for (int i = 0; i < 9; i++) {
-    hitPointsSqrSumReduced.set(i, recvbuf[offset++]);
-    hitPointsSqrSumVarianceReduced.set(i, recvbuf[offset++]);
+    sums[offset++] = hitPointsSqrSum.get(i);
+    sums[offset++] = hitPointsSqrSumVariance.get(i);
   }
 
   for (int i = 0; i < 3; i++) {
-    hitPointsSumReduced.set(i, recvbuf[offset++]);
-    hitPointsSumVarianceReduced.set(i, recvbuf[offset++]);
+    sums[offset++] = hitPointsSum.get(i);
+    sums[offset++] = hitPointsSumVariance.get(i);
   }
-#endif
 
-  reduced = true;
+  assert(offset == numReducedValues);
 }
 
-/// Gather the hit locations from all threads and MPI nodes.
+/// Gather the hit locations from all threads of this process.  Each MPI
+/// process keeps only its own hit locations, which are written to the points
+/// file at per-process offsets.  Thread buffers are released as they are
+/// gathered, so hit locations are not held twice.
 ///
 void 
 ResultsInterior::
 gatherHitPoints() {
-  if (hitPointsGathered) {
+  if (getHitPointsGathered()) {
     return;
   }
 
   for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    ThreadResults * results = threadResults[threadNum];
+
+    if (results == NULL) {
+      continue;
+    }
+
     gatheredPoints.insert(gatheredPoints.end(), 
-			 points[threadNum].begin(), 
-			 points[threadNum].end());
+			 results->points.begin(), 
+			 results->points.end());
+
+    std::vector<Vector3<double> >().swap(results->points);
+
+    results->hitPointsGathered = true;
+  }
+}
+
+/// Gather the hit locations from all threads and MPI processes onto every
+/// process, for computations that need every hit location, or the hit
+/// locations kept in reservoirs if there are reservoirs.  Counts are sent in
+/// points rather than coordinates, and points are sent directly from the
+/// gathered vectors without intermediate copies.
+///
+void 
+ResultsInterior::
+gatherHitPointsFromAllProcesses() {
+  gatherHitPoints();
+
+  if (reservoirSize > 0) {
+    gatherReservoirPoints();
+
+    return;
   }
 
 #ifdef USE_MPI
-  int mpiSize = 0;
+  static_assert(sizeof(Vector3<double>) == 3*sizeof(double),
+		"Vector3<double> must be three packed doubles");
+
   int mpiRank = 0;
 
-  MPI_Comm_size(MPI_COMM_WORLD, &mpiSize);
   MPI_Comm_rank(MPI_COMM_WORLD, &mpiRank);
 
-  int * arrayLengths = new int[mpiSize];
+  MPI_Datatype pointType;
 
-  int arrayLength = gatheredPoints.size() * 3;
+  MPI_Type_contiguous(3, MPI_DOUBLE, &pointType);
+  MPI_Type_commit(&pointType);
 
-  MPI_Allgather(&arrayLength, 1, MPI_INT,
-		arrayLengths, 1, MPI_INT,
-		MPI_COMM_WORLD);
+  std::vector<int> numPoints;
+  std::vector<int> offsets;
 
-  int combinedArrayLength = 0;
+  int totalNumPoints = getGatherCounts(gatheredPoints.size(), 
+				       &numPoints, &offsets);
 
-  for (int i = 0; i < mpiSize; i++) {
-    combinedArrayLength += arrayLengths[i];
-  }
+  allProcessesPoints.resize(totalNumPoints);
+
+  MPI_Allgatherv(gatheredPoints.data(), 
+		 numPoints[mpiRank], pointType,
+		 allProcessesPoints.data(), 
+		 numPoints.data(), offsets.data(), pointType,
+		 MPI_COMM_WORLD);
+
+  MPI_Type_free(&pointType);
+#endif
+}
 
-  double * combinedPointArray  = new double[combinedArrayLength];
+/// Orders keyed hit locations by key.
+///
+bool
+ResultsInterior::
+compareKeys(KeyedPoint const & a, KeyedPoint const & b) {
 
-  int * combinedArrayOffsets = new int[mpiSize];
+  return a.first < b.first;
+}
 
-  combinedArrayOffsets[0] = 0;
+/// Keeps only the reservoir size of the given keyed hit locations with the
+/// smallest keys, sorted by key.
+///
+void
+ResultsInterior::
+keepSmallestKeys(std::vector<KeyedPoint> * keyedPoints) const {
 
-  for (int i = 1; i < mpiSize; i++) {
-    combinedArrayOffsets[i] = combinedArrayOffsets[i - 1] + arrayLengths[i - 1];
+  if (keyedPoints->size() > (size_t)reservoirSize) {
+    std::nth_element(keyedPoints->begin(), 
+		     keyedPoints->begin() + reservoirSize,
+		     keyedPoints->end(),
+		     compareKeys);
+
+    keyedPoints->resize(reservoirSize);
   }
 
-  double * pointArray  = new double[arrayLengths[mpiRank]];
+  std::sort(keyedPoints->begin(), keyedPoints->end(), compareKeys);
+}
 
-  for (int index = 0; index < arrayLengths[mpiRank]; index++) {
-    pointArray[index] = gatheredPoints[index / 3].get(index % 3);
+/// Merges the reservoirs of all threads and MPI processes onto every process.
+/// Every hit location has an independent uniform key, so the locations with
+/// the smallest keys overall are a uniform random subset of all the hit
+/// locations.  Since the keys come from the sample random number streams,
+/// the subset does not depend on how reservoirs are divided between threads
+/// or processes when deterministic blocks are used.
+///
+void 
+ResultsInterior::
+gatherReservoirPoints() {
+  std::vector<KeyedPoint> keyedPoints;
+
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    ThreadResults const * results = threadResults[threadNum];
+
+    if (results == NULL) {
+      continue;
+    }
+
+    keyedPoints.insert(keyedPoints.end(), 
+		       results->reservoirPoints.begin(), 
+		       results->reservoirPoints.end());
   }
 
-  MPI_Allgatherv(pointArray, 
-		 arrayLengths[mpiRank], MPI_DOUBLE,
-		 combinedPointArray, 
-		 arrayLengths, combinedArrayOffsets, MPI_DOUBLE,
+  keepSmallestKeys(&keyedPoints);
+
+#ifdef USE_MPI
+  static_assert(sizeof(KeyedPoint) == 4*sizeof(double),
+		"KeyedPoint must be four packed doubles");
+
+  int mpiRank = 0;
+
+  MPI_Comm_rank(MPI_COMM_WORLD, &mpiRank);
+
+  MPI_Datatype keyedPointType;
+
+  MPI_Type_contiguous(4, MPI_DOUBLE, &keyedPointType);
+  MPI_Type_commit(&keyedPointType);
+
+  std::vector<int> numPoints;
+  std::vector<int> offsets;
+
+  int totalNumPoints = getGatherCounts(keyedPoints.size(), 
+				       &numPoints, &offsets);
+
+  std::vector<KeyedPoint> allKeyedPoints(totalNumPoints);
+
+  MPI_Allgatherv(keyedPoints.data(), 
+		 numPoints[mpiRank], keyedPointType,
+		 allKeyedPoints.data(), 
+		 numPoints.data(), offsets.data(), keyedPointType,
 		 MPI_COMM_WORLD);
 
-  gatheredPoints.clear();
+  MPI_Type_free(&keyedPointType);
+
+  keyedPoints.swap(allKeyedPoints);
+
+  keepSmallestKeys(&keyedPoints);
+#endif
+
+  allProcessesPoints.clear();
+  allProcessesPoints.reserve(keyedPoints.size());
 
-  gatheredPoints.reserve(combinedArrayLength / 3);
-  
-  for (int index = 0; index < combinedArrayLength; index += 3) {
-    gatheredPoints.emplace_back(combinedPointArray[index + 0],
-				combinedPointArray[index + 1],
-				combinedPointArray[index + 2]);
+  for (KeyedPoint const & keyedPoint : keyedPoints) {
+    allProcessesPoints.push_back(keyedPoint.second);
   }
+}
 
-  delete [] arrayLengths;
+/// Gathers the number of points each MPI process will send, and computes the
+/// offsets at which they will be received and the total number received.
+/// MPI counts and offsets are ints, so exits with an error if the total does
+/// not fit in one.
+///
+int
+ResultsInterior::
+getGatherCounts(long long localNumPoints,
+		std::vector<int> * numPoints,
+		std::vector<int> * offsets) const {
 
-  delete [] combinedPointArray;
+  std::vector<long long> allNumPoints(1, localNumPoints);
 
-  delete [] combinedArrayOffsets;
+#ifdef USE_MPI
+  int mpiSize = 0;
+
+  MPI_Comm_size(MPI_COMM_WORLD, &mpiSize);
 
-  delete [] pointArray;
+  allNumPoints.resize(mpiSize);
+
+  MPI_Allgather(&localNumPoints, 1, MPI_LONG_LONG,
+		allNumPoints.data(), 1, MPI_LONG_LONG,
+		MPI_COMM_WORLD);
 #endif
 
-  hitPointsGathered = true;
+  long long totalNumPoints = 0;
+
+  for (long long numProcessPoints : allNumPoints) {
+    totalNumPoints += numProcessPoints;
+  }
+
+  if (totalNumPoints > INT_MAX) {
+    std::cout << "Error: Cannot gather " << totalNumPoints 
+	      << " interior points from all MPI processes, the limit is "
+	      << INT_MAX << std::endl;
+    exit(1);
+  }
+
+  numPoints->assign(allNumPoints.begin(), allNumPoints.end());
+  offsets->assign(allNumPoints.size(), 0);
+
+  for (size_t i = 1; i < allNumPoints.size(); i++) {
+    (*offsets)[i] = (*offsets)[i - 1] + (*numPoints)[i - 1];
+  }
+
+  return totalNumPoints;
 }
 
 Uncertain<double> 
 ResultsInterior::
 getNumHits() const {
-  assert(reduced);
+  assert(getReduced());
 
   return Uncertain<double>(numHitsReduced, numHitsVarianceReduced);
 }
@@ -366,7 +732,7 @@ getNumHits() const {
 Matrix3x3<Uncertain<double> > 
 ResultsInterior::
 getHitPointsSqrSum() const {
-  assert(reduced);
+  assert(getReduced());
 
   return Uncertain<double>::zip(hitPointsSqrSumReduced, 
 				hitPointsSqrSumVarianceReduced);
@@ -375,7 +741,7 @@ getHitPointsSqrSum() const {
 Vector3<Uncertain<double> > 
 ResultsInterior::
 getHitPointsSum() const {
-  assert(reduced);
+  assert(getReduced());
 
   return Uncertain<double>::zip(hitPointsSumReduced, 
 				hitPointsSumVarianceReduced);
@@ -384,11 +750,18 @@ getHitPointsSum() const {
 double
 ResultsInterior::
 getNumSamples() const {
-  assert(reduced);
+  assert(getReduced());
 
   return numSamplesReduced;
 }
 
+double
+ResultsInterior::
+getSampledVolume() const {
+
+  return sampledVolume;
+}
+
 bool
 ResultsInterior::
 getSaveHitPoints() const {
@@ -400,32 +773,84 @@ std::vector<Vector3<double> > const *
 ResultsInterior::
 getPoints() const {
   assert(saveHitPoints);
-  assert(hitPointsGathered);
+  assert(getHitPointsGathered());
 
   return &gatheredPoints;
 }
 
+/// Returns the hit locations from all MPI processes, or those kept in
+/// reservoirs if there are reservoirs, after gatherHitPointsFromAllProcesses()
+/// has been called.
+///
+std::vector<Vector3<double> > const * 
+ResultsInterior::
+getPointsFromAllProcesses() const {
+  assert(saveHitPoints || reservoirSize > 0);
+  assert(getHitPointsGathered());
+
+  if (reservoirSize > 0) {
+    return &allProcessesPoints;
+  }
+
+#ifdef USE_MPI
+  return &allProcessesPoints;
+#else
+  return &gatheredPoints;
+#endif
+}
+
+/// Write the hit points still buffered by all threads to the points file, if
+/// one is being streamed.
+///
+void 
+ResultsInterior::
+flushHitPoints() {
+  if (pointsWriter == NULL) {
+    return;
+  }
+
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    if (threadResults[threadNum] != NULL) {
+      flushThreadPoints(threadResults[threadNum]);
+    }
+  }
+}
+
+/// Write the hit points buffered in the given thread results to the points
+/// file and empty the buffer.
+///
+void 
+ResultsInterior::
+flushThreadPoints(ThreadResults * results) {
+
+  static const std::vector<Vector3<char> > noCharges;
+
+  pointsWriter->write(results->streamPoints, noCharges);
+
+  results->streamPoints.clear();
+}
+
 void 
 ResultsInterior::
-updateVariance(int threadNum,
+updateVariance(ThreadResults * results,
 	       double hitMissData,
 	       Matrix3x3<double> const & hitPointsSqrData,
 	       Vector3<double> const & hitPointsData) {
 
   updateItemVariance(hitMissData,
-		     numSamples[threadNum],
-		     &(hitMissMean[threadNum]),
-		     &(hitMissM2[threadNum]));
+		     results->numSamples,
+		     &(results->hitMissMean),
+		     &(results->hitMissM2));
 
   updateItemVariance(hitPointsSqrData,
-		     numSamples[threadNum],
-		     &(hitPointsSqrMean[threadNum]),
-		     &(hitPointsSqrM2[threadNum]));
+		     results->numSamples,
+		     &(results->hitPointsSqrMean),
+		     &(results->hitPointsSqrM2));
 
   updateItemVariance(hitPointsData,
-		     numSamples[threadNum],
-		     &(hitPointsMean[threadNum]),
-		     &(hitPointsM2[threadNum]));
+		     results->numSamples,
+		     &(results->hitPointsMean),
+		     &(results->hitPointsM2));
 }
 
 // ================================================================
@@ -30,11 +30,16 @@
 
 // ================================================================
 
+#include <string>
 #include <vector>
+#include <utility>
 
 #include "Geometry/Vector3.h"
 
 #include "Uncertain.h"
+#include "CacheAligned.h"
+#include "KahanSum.h"
+#include "PointsWriter.h"
 
 // ================================================================
 
@@ -43,18 +48,30 @@
 class ResultsInterior {
 public:
   ResultsInterior(int numThreads,
-		  bool saveHitPoints);
+		  double sampledVolume,
+		  bool saveHitPoints,
+		  long long reservoirSize,
+		  bool fixedReductionOrder,
+		  bool compensatedSums,
+		  std::string const & streamPointsFileName);
 
   ~ResultsInterior();
 
+  template <class RandomNumberGenerator>
   void recordHit(int threadNum,
-		 Vector3<double> const & point);
+		 Vector3<double> const & point,
+		 double weight,
+		 bool savePoint,
+		 RandomNumberGenerator * randomNumberGenerator);
 
   void recordMiss(int threadNum);
 
   void reduce();
 
   void gatherHitPoints();
+  void gatherHitPointsFromAllProcesses();
+
+  void flushHitPoints();
 
   Uncertain<double> getNumHits() const;
 
@@ -64,12 +81,92 @@ public:
 
   double getNumSamples() const;
 
+  double getSampledVolume() const;
+
   bool getSaveHitPoints() const;
 
   std::vector<Vector3<double> > const * getPoints() const;
+  std::vector<Vector3<double> > const * getPointsFromAllProcesses() const;
 
 private:
-  void updateVariance(int threadNum,
+  /// Number of values combined across threads and MPI nodes by reduce().
+  ///
+  static const int numReducedValues = 27;
+
+  /// A hit location with the random key that decides whether it is kept in
+  /// a reservoir.
+  ///
+  using KeyedPoint = std::pair<double, Vector3<double> >;
+
+  /// Results recorded to a single thread number, allocated on first use and
+  /// aligned and padded to whole cache lines, as in ResultsZeno.
+  ///
+  struct alignas(cacheLineSize) ThreadResults {
+    ThreadResults();
+
+    long long numSamples;
+
+    //running means and sums of squared deviations, without compensated sums
+
+    double hitMissMean;
+    double hitMissM2;
+
+    Matrix3x3<double> hitPointsSqrMean;
+    Matrix3x3<double> hitPointsSqrM2;
+
+    Vector3<double> hitPointsMean;
+    Vector3<double> hitPointsM2;
+
+    //sums and sums of squares, with compensated sums
+
+    KahanSum<double> hitMissSum;
+    KahanSum<double> hitMissSumOfSquares;
+
+    KahanSum<Matrix3x3<double> > hitPointsSqrSum;
+    KahanSum<Matrix3x3<double> > hitPointsSqrSumOfSquares;
+
+    KahanSum<Vector3<double> > hitPointsSum;
+    KahanSum<Vector3<double> > hitPointsSumOfSquares;
+
+    std::vector<Vector3<double> > points;
+
+    std::vector<Vector3<double> > streamPoints;
+
+    //heap of the hit locations with the smallest keys, largest key first
+    std::vector<KeyedPoint> reservoirPoints;
+
+    //set by reduce() and gatherHitPoints(), and cleared by this thread only,
+    //as in ResultsZeno
+    bool reduced;
+    bool hitPointsGathered;
+  };
+
+  ThreadResults * getThreadResults(int threadNum);
+
+  bool getReduced() const;
+  bool getHitPointsGathered() const;
+
+  void recordKeyedHit(int threadNum,
+		      Vector3<double> const & point,
+		      double weight,
+		      bool savePoint,
+		      double reservoirKey);
+
+  static bool compareKeys(KeyedPoint const & a, KeyedPoint const & b);
+
+  void keepSmallestKeys(std::vector<KeyedPoint> * keyedPoints) const;
+
+  void gatherReservoirPoints();
+
+  int getGatherCounts(long long localNumPoints,
+		      std::vector<int> * numPoints,
+		      std::vector<int> * offsets) const;
+
+  void flushThreadPoints(ThreadResults * results);
+
+  void getThreadSums(int threadNum, double * sums) const;
+
+  void updateVariance(ThreadResults * results,
 		      double hitMissData,
 		      Matrix3x3<double> const & hitPointsSqrData,
 		      Vector3<double> const & hitPointsData);
@@ -85,22 +182,23 @@ private:
 		  T const & M2,
 		  double num,
 		  T * sumReduced,
-		  T * sumVarianceReduced);
+		  T * sumVarianceReduced) const;
 
   int const numThreads;
 
+  double sampledVolume;
+
   bool saveHitPoints;
 
-  double * numSamples;
+  long long reservoirSize;
 
-  double * hitMissMean;
-  double * hitMissM2;
+  bool fixedReductionOrder;
 
-  Matrix3x3<double> * hitPointsSqrMean;
-  Matrix3x3<double> * hitPointsSqrM2;
+  bool compensatedSums;
 
-  Vector3<double> * hitPointsMean;
-  Vector3<double> * hitPointsM2;
+  PointsWriter * pointsWriter;
+
+  ThreadResults * * threadResults;
 
   double numSamplesReduced;
 
@@ -113,14 +211,33 @@ private:
   Vector3<double> hitPointsSumReduced;
   Vector3<double> hitPointsSumVarianceReduced;
 
-  std::vector<Vector3<double> > * points;
-
   std::vector<Vector3<double> > gatheredPoints;
-
-  bool reduced;
-  bool hitPointsGathered;
+  std::vector<Vector3<double> > allProcessesPoints;
 };
 
+/// Record a hit with the given weight from the given thread number at the
+/// given location.  If hit locations are kept in reservoirs, a random key
+/// for the location is drawn from the given random number generator, which is
+/// otherwise not used.
+///
+template <class RandomNumberGenerator>
+void 
+ResultsInterior::
+recordHit(int threadNum,
+	  Vector3<double> const & point,
+	  double weight,
+	  bool savePoint,
+	  RandomNumberGenerator * randomNumberGenerator) {
+
+  double reservoirKey = 0;
+
+  if (reservoirSize > 0 && savePoint) {
+    reservoirKey = randomNumberGenerator->getRandIn01();
+  }
+
+  recordKeyedHit(threadNum, point, weight, savePoint, reservoirKey);
+}
+
 template <class T>
 void
 ResultsInterior::
@@ -141,12 +258,18 @@ reduceItem(T const & mean,
 	   T const & M2,
 	   double num,
 	   T * sumReduced,
-	   T * sumVarianceReduced) {
+	   T * sumVarianceReduced) const {
 
     T sum = mean * num;
 
     (*sumReduced) += sum;
 
+    //threads that took fewer than two samples (possible with dynamic
+    //scheduling) contribute no variance estimate
+    if (num < 2) {
+      return;
+    }
+
     T variance = M2 / (num - 1);
     T meanVariance = variance / num;
     T sumVariance = meanVariance * pow(num, 2);
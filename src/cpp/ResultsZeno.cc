@@ -35,135 +35,164 @@
 /// from the given number of threads,
 /// and optionally save the hit point locations.
 ///
+/// If fixedReductionOrder is set, each thread number is a slot that only one
+/// MPI process records to, and reduce() combines the slots in order of their
+/// number no matter which process recorded them, so the reduced results do not
+/// depend on the number of MPI processes.
+///
+/// If expectedCharges is set, each hit records the expected value of its
+/// charges rather than randomly assigned charges.
+///
+/// If streamPointsFileName is not empty, hit points and charges are written to
+/// that file from fixed-size per-thread buffers as walks are recorded.
+///
+/// If compensatedSums is set, each thread keeps counts and compensated sums
+/// and sums of squares, and variances are computed only by reduce(), rather
+/// than updating running variances after every walk.  A miss then only
+/// increments the walk count.
+///
 ResultsZeno::
 ResultsZeno(Sphere<double> const & boundingSphere,
 	    int numThreads,
-	    bool saveHitPoints) 
+	    bool saveHitPoints,
+	    bool fixedReductionOrder,
+	    bool expectedCharges,
+	    bool compensatedSums,
+	    std::string const & streamPointsFileName) 
   : boundingSphereRadius(boundingSphere.getRadius()),
     boundingSphereCenter(boundingSphere.getCenter()),
     numThreads(numThreads),
     saveHitPoints(saveHitPoints),
-    numWalks(NULL),
-    hitMissMean(NULL),
-    hitMissM2(NULL),
-    KPlus(NULL),
-    KMinus(NULL),
-    KPlusMean(NULL),
-    KMinusMean(NULL),
-    KPlusM2(NULL),
-    KMinusM2(NULL),
-    VPlus(NULL),
-    VMinus(NULL),
-    VPlusMean(NULL),
-    VMinusMean(NULL),
-    VPlusM2(NULL),
-    VMinusM2(NULL),
+    fixedReductionOrder(fixedReductionOrder),
+    expectedCharges(expectedCharges),
+    compensatedSums(compensatedSums),
+    pointsWriter(NULL),
+    threadResults(NULL),
     numWalksReduced(0),
+    numStepsReduced(0),
+    numGridStepsReduced(0),
     numHitsReduced(0),
     numHitsVarianceReduced(0),
-    KPlusReduced(0, 0, 0),
-    KMinusReduced(0, 0, 0),
-    VPlusReduced(0, 0, 0, 
-		 0, 0, 0, 
-		 0, 0, 0),
-    VMinusReduced(0, 0, 0, 
-		  0, 0, 0, 
-		  0, 0, 0),
-    points(NULL),
-    normals(NULL),
-    charges(NULL),
+    KReduced(0, 0, 0),
+    VReduced(0, 0, 0, 
+	     0, 0, 0, 
+	     0, 0, 0),
+    WReduced(0, 0, 0, 
+	     0, 0, 0, 
+	     0, 0, 0),
     gatheredPoints(),
     gatheredNormals(),
-    gatheredCharges(),
-    reduced(true),
-    hitPointsGathered(true) {
-
-  numWalks = new double[numThreads];
-
-  hitMissMean = new double[numThreads];
-
-  hitMissM2 = new double[numThreads];
-
-  KPlus  = new Vector3<double>[numThreads];
-  KMinus = new Vector3<double>[numThreads];
+    gatheredCharges() {
 
-  KPlusMean  = new Vector3<double>[numThreads];
-  KMinusMean = new Vector3<double>[numThreads];  
+  threadResults = new ThreadResults *[numThreads];
 
-  KPlusM2  = new Vector3<double>[numThreads];
-  KMinusM2 = new Vector3<double>[numThreads];
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    threadResults[threadNum] = NULL;
+  }
 
-  VPlus  = new Matrix3x3<double>[numThreads];
-  VMinus = new Matrix3x3<double>[numThreads];
+  if (!streamPointsFileName.empty()) {
+    pointsWriter = new PointsWriter(streamPointsFileName, true);
+  }
+}
 
-  VPlusMean  = new Matrix3x3<double>[numThreads];
-  VMinusMean = new Matrix3x3<double>[numThreads];
+ResultsZeno::
+~ResultsZeno() {
+  if (pointsWriter != NULL) {
+    flushHitPoints();
 
-  VPlusM2  = new Matrix3x3<double>[numThreads];
-  VMinusM2 = new Matrix3x3<double>[numThreads];
+    delete pointsWriter;
+  }
 
   for (int threadNum = 0; threadNum < numThreads; threadNum++) {
-    numWalks[threadNum] = 0;
+    deleteCacheAligned(threadResults[threadNum]);
+  }
 
-    hitMissMean[threadNum] = 0;
+  delete [] threadResults;
+}
 
-    hitMissM2[threadNum] = 0;
+ResultsZeno::ThreadResults::
+ThreadResults()
+  : numWalks(0),
+    numSteps(0),
+    numGridSteps(0),
+    K(),
+    V(),
+    W(),
+    hitMissMean(0),
+    hitMissM2(0),
+    KMean(),
+    KM2(),
+    VMean(),
+    VM2(),
+    WMean(),
+    WM2(),
+    numHits(0),
+    KSum(),
+    VSum(),
+    WSum(),
+    KSqr(),
+    VSqr(),
+    WSqr(),
+    points(),
+    normals(),
+    charges(),
+    streamPoints(),
+    streamCharges(),
+    reduced(true),
+    hitPointsGathered(true) {
 
-    KPlus[threadNum].setXYZ(0, 0, 0);
-    KMinus[threadNum].setXYZ(0, 0, 0);
+}
 
-    KPlusMean[threadNum].setXYZ(0, 0, 0);
-    KMinusMean[threadNum].setXYZ(0, 0, 0);
+/// Returns the results recorded to the given thread number, allocating them
+/// on first use.  Only the thread currently recording to a thread number may
+/// call this, so the allocation is first touched by that thread.
+///
+ResultsZeno::ThreadResults *
+ResultsZeno::
+getThreadResults(int threadNum) {
+  assert(threadNum >= 0 && threadNum < numThreads);
 
-    KPlusM2[threadNum].setXYZ(0, 0, 0);
-    KMinusM2[threadNum].setXYZ(0, 0, 0);
+  if (threadResults[threadNum] == NULL) {
+    threadResults[threadNum] = newCacheAligned<ThreadResults>();
+  }
 
-    for (int component = 0; component < 3*3; component++) {
-      VPlus[threadNum].set(component, 0);
-      VMinus[threadNum].set(component, 0);
+  return threadResults[threadNum];
+}
 
-      VPlusMean[threadNum].set(component, 0);
-      VMinusMean[threadNum].set(component, 0);
+/// Returns whether the reduced results include everything recorded by all
+/// threads.  Each thread clears its own flag when it records, so this must
+/// not be called while threads are recording.
+///
+bool
+ResultsZeno::
+getReduced() const {
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    if (threadResults[threadNum] != NULL &&
+	!threadResults[threadNum]->reduced) {
 
-      VPlusM2[threadNum].set(component, 0);
-      VMinusM2[threadNum].set(component, 0);
+      return false;
     }
   }
 
-  points  = new std::vector<Vector3<double> >[numThreads];
-  normals = new std::vector<Vector3<double> >[numThreads];
-  charges = new std::vector<Vector3<char> >[numThreads];
+  return true;
 }
 
+/// Returns whether the gathered hit locations include every hit location
+/// recorded by all threads.  As for getReduced(), this must not be called
+/// while threads are recording.
+///
+bool
 ResultsZeno::
-~ResultsZeno() {
-  delete [] numWalks;
-
-  delete [] hitMissMean;
-
-  delete [] hitMissM2;
-
-  delete [] KPlus;
-  delete [] KMinus;
-
-  delete [] KPlusMean;
-  delete [] KMinusMean;
-
-  delete [] KPlusM2;
-  delete [] KMinusM2;
-
-  delete [] VPlus;
-  delete [] VMinus;
-
-  delete [] VPlusMean;
-  delete [] VMinusMean;
+getHitPointsGathered() const {
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    if (threadResults[threadNum] != NULL &&
+	!threadResults[threadNum]->hitPointsGathered) {
 
-  delete [] VPlusM2;
-  delete [] VMinusM2;
+      return false;
+    }
+  }
 
-  delete [] points;
-  delete [] normals;
-  delete [] charges;
+  return true;
 }
 
 /// Record a miss from the given thread number.
@@ -171,26 +200,43 @@ ResultsZeno::
 void 
 ResultsZeno::
 recordMiss(int threadNum) {
-  assert(threadNum >= 0 && threadNum < numThreads);
+  ThreadResults * results = getThreadResults(threadNum);
 
-  reduced = false;
+  results->reduced = false;
 
-  double hitMissData = 0;
+  results->numWalks++;
 
-  Vector3<double> KPlusData(0, 0, 0);
-  Vector3<double> KMinusData(0, 0, 0);
+  //a miss adds nothing to the sums
+  if (compensatedSums) {
+    return;
+  }
 
-  Matrix3x3<double> VPlusData(0, 0, 0, 0, 0, 0, 0, 0, 0);
-  Matrix3x3<double> VMinusData(0, 0, 0, 0, 0, 0, 0, 0, 0);
+  double hitMissData = 0;
 
-  numWalks[threadNum]++;
+  Vector3<double> KData(0, 0, 0);
 
-  updateVariance(threadNum,
+  Matrix3x3<double> VData(0, 0, 0, 0, 0, 0, 0, 0, 0);
+  Matrix3x3<double> WData(0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+  updateVariance(results,
 		 hitMissData,
-		 KPlusData, 
-		 KMinusData,
-		 VPlusData, 
-		 VMinusData);
+		 KData, 
+		 VData, 
+		 WData);
+}
+
+/// Record the number of steps taken by a walk from the given thread number,
+/// and how many of them were sized using the distance grid.
+///
+void 
+ResultsZeno::
+recordSteps(int threadNum, int numSteps, int numGridSteps) {
+  ThreadResults * results = getThreadResults(threadNum);
+
+  results->reduced = false;
+
+  results->numSteps     += numSteps;
+  results->numGridSteps += numGridSteps;
 }
 
 /// Perform a parallel reduction on the hit counts and other statistics and 
@@ -199,288 +245,276 @@ recordMiss(int threadNum) {
 void 
 ResultsZeno::
 reduce() {
-  if (reduced) {
+  if (getReduced()) {
     return;
   }
 
-  numWalksReduced = 0;
+  std::vector<double> threadSums(numThreads * numReducedValues);
 
-  numHitsReduced = 0;
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    getThreadSums(threadNum, &threadSums[threadNum * numReducedValues]);
+  }
 
-  numHitsVarianceReduced = 0;
+#ifdef USE_MPI
+  if (fixedReductionOrder) {
+    std::vector<double> recvbuf(threadSums.size(), 0);
 
-  KPlusReduced.setXYZ(0, 0, 0);
-  KMinusReduced.setXYZ(0, 0, 0);
+    //each slot is zero on all but one MPI process, so this sum is exact
+    MPI_Allreduce(threadSums.data(), recvbuf.data(), threadSums.size(), 
+		  MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
 
-  KPlusVarianceReduced.setXYZ(0, 0, 0);
-  KMinusVarianceReduced.setXYZ(0, 0, 0);
+    threadSums.swap(recvbuf);
+  }
+#endif
 
-  for (int component = 0; component < 3*3; component++) {
-    VPlusReduced.set(component, 0);
-    VMinusReduced.set(component, 0);
+  double sendbuf[numReducedValues];
 
-    VPlusVarianceReduced.set(component, 0);
-    VMinusVarianceReduced.set(component, 0);
+  for (int i = 0; i < numReducedValues; i++) {
+    sendbuf[i] = 0;
   }
 
   for (int threadNum = 0; threadNum < numThreads; threadNum++) {
-    const double nn1 = (double)numWalks[threadNum] / (numWalks[threadNum] - 1);
-
-    numWalksReduced += numWalks[threadNum];
-
-    numHitsReduced += hitMissMean[threadNum] * numWalks[threadNum];
-
-    numHitsVarianceReduced += hitMissM2[threadNum] * nn1;
-
-    KPlusReduced  += KPlus[threadNum];
-    KMinusReduced += KMinus[threadNum];
-
-    KPlusVarianceReduced  += KPlusM2[threadNum] * nn1;
-    KMinusVarianceReduced += KMinusM2[threadNum] * nn1;
+    for (int i = 0; i < numReducedValues; i++) {
+      sendbuf[i] += threadSums[threadNum * numReducedValues + i];
+    }
+  }
 
-    VPlusReduced  += VPlus[threadNum];
-    VMinusReduced += VMinus[threadNum];
+  double recvbuf[numReducedValues];
 
-    VPlusVarianceReduced  += VPlusM2[threadNum] * nn1;
-    VMinusVarianceReduced += VMinusM2[threadNum] * nn1;
+  for (int i = 0; i < numReducedValues; i++) {
+    recvbuf[i] = sendbuf[i];
   }
 
 #ifdef USE_MPI
-  const int mpiBufferSize = 51;
+  if (!fixedReductionOrder) {
+    // MPI_Reduce(sendbuf, recvbuf, numReducedValues, MPI_DOUBLE,
+    // 	       MPI_SUM, 0, MPI_COMM_WORLD);
 
-  double sendbuf[mpiBufferSize];
+    MPI_Allreduce(sendbuf, recvbuf, numReducedValues, MPI_DOUBLE,
+		  MPI_SUM, MPI_COMM_WORLD);
+  }
+#endif
 
   int offset = 0;
 
-  sendbuf[offset++] = numWalksReduced;
+  numWalksReduced = recvbuf[offset++];
 
-  sendbuf[offset++] = numHitsReduced;
-  sendbuf[offset++] = numHitsVarianceReduced;
+  numStepsReduced     = recvbuf[offset++];
+  numGridStepsReduced = recvbuf[offset++];
 
-  for (int i = 0; i < 3; i++) {
-    sendbuf[offset++] = KPlusReduced.get(i);
-    sendbuf[offset++] = KPlusVarianceReduced.get(i);
-  }
+  numHitsReduced         = recvbuf[offset++];
+  numHitsVarianceReduced = recvbuf[offset++];
 
   for (int i = 0; i < 3; i++) {
-    sendbuf[offset++] = KMinusReduced.get(i);
-    sendbuf[offset++] = KMinusVarianceReduced.get(i);
+    KReduced.set(i, recvbuf[offset++]);
+    KVarianceReduced.set(i, recvbuf[offset++]);
   }
 
   for (int i = 0; i < 9; i++) {
-    sendbuf[offset++] = VPlusReduced.get(i);
-    sendbuf[offset++] = VPlusVarianceReduced.get(i);
+    VReduced.set(i, recvbuf[offset++]);
+    VVarianceReduced.set(i, recvbuf[offset++]);
   }
 
   for (int i = 0; i < 9; i++) {
-    sendbuf[offset++] = VMinusReduced.get(i);
-    sendbuf[offset++] = VMinusVarianceReduced.get(i);
+    WReduced.set(i, recvbuf[offset++]);
+    WVarianceReduced.set(i, recvbuf[offset++]);
   }
 
-  double recvbuf[mpiBufferSize];
+  assert(offset == numReducedValues);
 
-  for (int i = 0; i < mpiBufferSize; i++) {
-    recvbuf[i] = 0;
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    if (threadResults[threadNum] != NULL) {
+      threadResults[threadNum]->reduced = true;
+    }
   }
+}
 
-  // MPI_Reduce(sendbuf, recvbuf, mpiBufferSize, MPI_DOUBLE,
-  // 	     MPI_SUM, 0, MPI_COMM_WORLD);
+/// Computes the sums and corresponding variances of the hit counts and other
+/// statistics from the given thread number, and stores them in the given array
+/// in the order used by reduce().
+///
+void 
+ResultsZeno::
+getThreadSums(int threadNum, double * sums) const {
 
-  MPI_Allreduce(sendbuf, recvbuf, mpiBufferSize, MPI_DOUBLE,
-		MPI_SUM, MPI_COMM_WORLD);
+  ThreadResults const * results = threadResults[threadNum];
 
-  offset = 0;
+  //thread numbers that were never recorded to have no results allocated
+  if (results == NULL) {
+    for (int i = 0; i < numReducedValues; i++) {
+      sums[i] = 0;
+    }
 
-  numWalksReduced = recvbuf[offset++];
+    return;
+  }
 
-  numHitsReduced         = recvbuf[offset++];
-  numHitsVarianceReduced = recvbuf[offset++];
+  //threads that performed fewer than two walks (possible with dynamic
+  //scheduling) contribute no variance estimate
+  const double nn1 = (results->numWalks > 1) ? 
+    (double)results->numWalks / (results->numWalks - 1) : 0;
 
-  for (int i = 0; i < 3; i++) {
-    KPlusReduced.set(i, recvbuf[offset++]);
-    KPlusVarianceReduced.set(i, recvbuf[offset++]);
-  }
+  int offset = 0;
 
-  for (int i = 0; i < 3; i++) {
-    KMinusReduced.set(i, recvbuf[offset++]);
-    KMinusVarianceReduced.set(i, recvbuf[offset++]);
-  }
+  sums[offset++] = results->numWalks;
 
-  for (int i = 0; i < 9; i++) {
-    VPlusReduced.set(i, recvbuf[offset++]);
-    VPlusVarianceReduced.set(i, recvbuf[offset++]);
+  sums[offset++] = results->numSteps;
+  sums[offset++] = results->numGridSteps;
+
+  if (compensatedSums) {
+    const double numWalks = results->numWalks;
+
+    //hit/miss data is 0 or 1, so the hit count is also its sum of squares
+    sums[offset++] = results->numHits;
+    sums[offset++] = getSumVariance(results->numHits, 
+				    results->numHits, 
+				    numWalks);
+
+    for (int i = 0; i < 3; i++) {
+      sums[offset++] = results->KSum.getSum().get(i);
+      sums[offset++] = getSumVariance(results->KSum.getSum().get(i),
+				      results->KSqr.getSum().get(i),
+				      numWalks);
+    }
+
+    for (int i = 0; i < 9; i++) {
+      sums[offset++] = results->VSum.getSum().get(i);
+      sums[offset++] = getSumVariance(results->VSum.getSum().get(i),
+				      results->VSqr.getSum().get(i),
+				      numWalks);
+    }
+
+    for (int i = 0; i < 9; i++) {
+      sums[offset++] = results->WSum.getSum().get(i);
+      sums[offset++] = getSumVariance(results->WSum.getSum().get(i),
+				      results->WSqr.getSum().get(i),
+				      numWalks);
+    }
   }
+  else {
+    sums[offset++] = results->hitMissMean * results->numWalks;
+    sums[offset++] = results->hitMissM2 * nn1;
 
-  for (int i = 0; i < 9; i++) {
-    VMinusReduced.set(i, recvbuf[offset++]);
-    VMinusVarianceReduced.set(i, recvbuf[offset++]);
+    for (int i = 0; i < 3; i++) {
+      sums[offset++] = results->K.get(i);
+      sums[offset++] = results->KM2.get(i) * nn1;
+    }
+
+    for (int i = 0; i < 9; i++) {
+      sums[offset++] = results->V.get(i);
+      sums[offset++] = results->VM2.get(i) * nn1;
+    }
+
+    for (int i = 0; i < 9; i++) {
+      sums[offset++] = results->W.get(i);
+      sums[offset++] = results->WM2.get(i) * nn1;
+    }
   }
-#endif
 
-  reduced = true;
+  assert(offset == numReducedValues);
 }
 
-/// Gather the hit locations from all threads and MPI nodes.
+/// Gather the hit locations from all threads of this process.  Each MPI
+/// process keeps only its own hit locations, which are written to the points
+/// file at per-process offsets.  Thread buffers are released as they are
+/// gathered, so hit locations are not held twice.
 ///
 void 
 ResultsZeno::
 gatherHitPoints() {
-  if (hitPointsGathered) {
+  if (getHitPointsGathered()) {
     return;
   }
 
   for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    ThreadResults * results = threadResults[threadNum];
+
+    if (results == NULL) {
+      continue;
+    }
+
     gatheredPoints.insert(gatheredPoints.end(), 
-			 points[threadNum].begin(), 
-			 points[threadNum].end());
+			 results->points.begin(), 
+			 results->points.end());
 
     gatheredNormals.insert(gatheredNormals.end(),
-			  normals[threadNum].begin(),
-			  normals[threadNum].end());
+			  results->normals.begin(),
+			  results->normals.end());
 
     gatheredCharges.insert(gatheredCharges.end(),
-			  charges[threadNum].begin(),
-			  charges[threadNum].end());
-  }
-
-#ifdef USE_MPI
-  int mpiSize = 0;
-  int mpiRank = 0;
-
-  MPI_Comm_size(MPI_COMM_WORLD, &mpiSize);
-  MPI_Comm_rank(MPI_COMM_WORLD, &mpiRank);
-
-  int * arrayLengths = new int[mpiSize];
-
-  int arrayLength = gatheredPoints.size() * 3;
-
-  MPI_Allgather(&arrayLength, 1, MPI_INT,
-		arrayLengths, 1, MPI_INT,
-		MPI_COMM_WORLD);
+			  results->charges.begin(),
+			  results->charges.end());
 
-  int combinedArrayLength = 0;
+    std::vector<Vector3<double> >().swap(results->points);
+    std::vector<Vector3<double> >().swap(results->normals);
+    std::vector<Vector3<char> >().swap(results->charges);
 
-  for (int i = 0; i < mpiSize; i++) {
-    combinedArrayLength += arrayLengths[i];
+    results->hitPointsGathered = true;
   }
+}
 
-  double * combinedPointArray  = new double[combinedArrayLength];
-  double * combinedNormalArray = new double[combinedArrayLength];
-  char *   combinedChargeArray = new char[combinedArrayLength];
-
-  int * combinedArrayOffsets = new int[mpiSize];
-
-  combinedArrayOffsets[0] = 0;
-
-  for (int i = 1; i < mpiSize; i++) {
-    combinedArrayOffsets[i] = combinedArrayOffsets[i - 1] + arrayLengths[i - 1];
-  }
-
-  double * pointArray  = new double[arrayLengths[mpiRank]];
-  double * normalArray = new double[arrayLengths[mpiRank]];
-  char *   chargeArray = new char[arrayLengths[mpiRank]];
-
-  for (int index = 0; index < arrayLengths[mpiRank]; index++) {
-    pointArray[index]  = gatheredPoints[index / 3].get(index % 3);
-    normalArray[index] = gatheredNormals[index / 3].get(index % 3);
-    chargeArray[index] = gatheredCharges[index / 3].get(index % 3);
+/// Write the hit points still buffered by all threads to the points file, if
+/// one is being streamed.
+///
+void 
+ResultsZeno::
+flushHitPoints() {
+  if (pointsWriter == NULL) {
+    return;
   }
 
-  MPI_Allgatherv(pointArray, 
-		 arrayLengths[mpiRank], MPI_DOUBLE,
-		 combinedPointArray, 
-		 arrayLengths, combinedArrayOffsets, MPI_DOUBLE,
-		 MPI_COMM_WORLD);
-
-  MPI_Allgatherv(normalArray, 
-		 arrayLengths[mpiRank], MPI_DOUBLE,
-		 combinedNormalArray, 
-		 arrayLengths, combinedArrayOffsets, MPI_DOUBLE,
-		 MPI_COMM_WORLD);
-
-  MPI_Allgatherv(chargeArray,
-		 arrayLengths[mpiRank], MPI_BYTE,
-		 combinedChargeArray,
-		 arrayLengths, combinedArrayOffsets, MPI_BYTE,
-		 MPI_COMM_WORLD);
-
-  gatheredPoints.clear();
-  gatheredNormals.clear();
-  gatheredCharges.clear();
-
-  gatheredPoints.reserve(combinedArrayLength / 3);
-  gatheredNormals.reserve(combinedArrayLength / 3);
-  gatheredCharges.reserve(combinedArrayLength / 3);
-
-  for (int index = 0; index < combinedArrayLength; index += 3) {
-    gatheredPoints.emplace_back(combinedPointArray[index + 0],
-				combinedPointArray[index + 1],
-				combinedPointArray[index + 2]);
-
-    gatheredNormals.emplace_back(combinedNormalArray[index + 0],
-				 combinedNormalArray[index + 1],
-				 combinedNormalArray[index + 2]);
-
-    gatheredCharges.emplace_back(combinedChargeArray[index + 0],
-				 combinedChargeArray[index + 1],
-				 combinedChargeArray[index + 2]);
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    if (threadResults[threadNum] != NULL) {
+      flushThreadPoints(threadResults[threadNum]);
+    }
   }
+}
 
-  delete [] arrayLengths;
-
-  delete [] combinedPointArray;
-  delete [] combinedNormalArray;
-  delete [] combinedChargeArray;
-
-  delete [] combinedArrayOffsets;
+/// Write the hit points buffered in the given thread results to the points
+/// file and empty the buffer.
+///
+void 
+ResultsZeno::
+flushThreadPoints(ThreadResults * results) {
 
-  delete [] pointArray;
-  delete [] normalArray;
-  delete [] chargeArray;
-#endif
+  pointsWriter->write(results->streamPoints, results->streamCharges);
 
-  hitPointsGathered = true;
+  results->streamPoints.clear();
+  results->streamCharges.clear();
 }
 
 void 
 ResultsZeno::
-updateVariance(int threadNum,
+updateVariance(ThreadResults * results,
 	       double hitMissData,
-	       Vector3<double> const & KPlusData, 
-	       Vector3<double> const & KMinusData,
-	       Matrix3x3<double> const & VPlusData, 
-	       Matrix3x3<double> const & VMinusData) {
+	       Vector3<double> const & KData, 
+	       Matrix3x3<double> const & VData, 
+	       Matrix3x3<double> const & WData) {
 
   updateItemVariance(hitMissData,
-		     numWalks[threadNum],
-		     &(hitMissMean[threadNum]),
-		     &(hitMissM2[threadNum]));
-
-  updateItemVariance(KPlusData,
-		     numWalks[threadNum],
-		     &(KPlusMean[threadNum]),
-		     &(KPlusM2[threadNum]));
-
-  updateItemVariance(KMinusData,
-		     numWalks[threadNum],
-		     &(KMinusMean[threadNum]),
-		     &(KMinusM2[threadNum]));
-
-  updateItemVariance(VPlusData,
-		     numWalks[threadNum],
-		     &(VPlusMean[threadNum]),
-		     &(VPlusM2[threadNum]));
-
-  updateItemVariance(VMinusData,
-		     numWalks[threadNum],
-		     &(VMinusMean[threadNum]),
-		     &(VMinusM2[threadNum]));
+		     results->numWalks,
+		     &(results->hitMissMean),
+		     &(results->hitMissM2));
+
+  updateItemVariance(KData,
+		     results->numWalks,
+		     &(results->KMean),
+		     &(results->KM2));
+
+  updateItemVariance(VData,
+		     results->numWalks,
+		     &(results->VMean),
+		     &(results->VM2));
+
+  updateItemVariance(WData,
+		     results->numWalks,
+		     &(results->WMean),
+		     &(results->WM2));
 }
 
 double 
 ResultsZeno::
 getNumWalks() const {
-  assert(reduced);
+  assert(getReduced());
 
   return numWalksReduced;
 }
@@ -488,41 +522,49 @@ getNumWalks() const {
 Uncertain<double> 
 ResultsZeno::
 getNumHits() const {
-  assert(reduced);
+  assert(getReduced());
 
   return Uncertain<double>(numHitsReduced, numHitsVarianceReduced);
 }
 
-Vector3<Uncertain<double> > 
+double 
+ResultsZeno::
+getNumSteps() const {
+  assert(getReduced());
+
+  return numStepsReduced;
+}
+
+double 
 ResultsZeno::
-getKPlus() const {
-  assert(reduced);
+getNumGridSteps() const {
+  assert(getReduced());
 
-  return Uncertain<double>::zip(KPlusReduced, KPlusVarianceReduced);
+  return numGridStepsReduced;
 }
 
 Vector3<Uncertain<double> > 
 ResultsZeno::
-getKMinus() const {
-  assert(reduced);
+getK() const {
+  assert(getReduced());
 
-  return Uncertain<double>::zip(KMinusReduced, KMinusVarianceReduced);
+  return Uncertain<double>::zip(KReduced, KVarianceReduced);
 }
 
 Matrix3x3<Uncertain<double> > 
 ResultsZeno::
-getVPlus() const {
-  assert(reduced);
+getV() const {
+  assert(getReduced());
 
-  return Uncertain<double>::zip(VPlusReduced, VPlusVarianceReduced);
+  return Uncertain<double>::zip(VReduced, VVarianceReduced);
 }
 
 Matrix3x3<Uncertain<double> > 
 ResultsZeno::
-getVMinus() const {
-  assert(reduced);
+getW() const {
+  assert(getReduced());
 
-  return Uncertain<double>::zip(VMinusReduced, VMinusVarianceReduced);
+  return Uncertain<double>::zip(WReduced, WVarianceReduced);
 }
 
 bool
@@ -536,7 +578,7 @@ std::vector<Vector3<double> > const *
 ResultsZeno::
 getPoints() const {
   assert(saveHitPoints);
-  assert(hitPointsGathered);
+  assert(getHitPointsGathered());
 
   return &gatheredPoints;
 }
@@ -545,7 +587,7 @@ std::vector<Vector3<double> > const *
 ResultsZeno:: 
 getNormals() const {
   assert(saveHitPoints);
-  assert(hitPointsGathered);
+  assert(getHitPointsGathered());
 
   return &gatheredNormals;
 }
@@ -554,7 +596,7 @@ std::vector<Vector3<char> > const *
 ResultsZeno:: 
 getCharges() const {
   assert(saveHitPoints);
-  assert(hitPointsGathered);
+  assert(getHitPointsGathered());
 
   return &gatheredCharges;
 }
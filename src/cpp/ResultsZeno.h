@@ -31,6 +31,8 @@
 // ================================================================
 
 #include <iostream>
+#include <string>
+#include <vector>
 #include <algorithm>
 #include <cmath>
 #include <cassert>
@@ -40,16 +42,31 @@
 #include "Geometry/Sphere.h"
 
 #include "Uncertain.h"
+#include "CacheAligned.h"
+#include "KahanSum.h"
+#include "PointsWriter.h"
 
 // ================================================================
 
 /// Collects results from the Walk-on-Spheres computation.
 ///
+/// Each walk that hits the object is given a charge of +1 or -1 along each
+/// axis, with a probability of +1 that depends on its start point.  K is the
+/// sum over hits of the charges, V has in each row the sum over hits of the
+/// end points, and W has in row i the sum over hits of the end points times
+/// charge i.  If expected charges are used, each hit contributes its expected
+/// charge instead of a random one, which gives the same means with less
+/// variance.
+///
 class ResultsZeno {
 public:
   ResultsZeno(Sphere<double> const & boundingSphere,
 	      int numThreads,
-	      bool saveHitPoints);
+	      bool saveHitPoints,
+	      bool fixedReductionOrder,
+	      bool expectedCharges,
+	      bool compensatedSums,
+	      std::string const & streamPointsFileName);
 
   ~ResultsZeno();
 
@@ -62,19 +79,25 @@ public:
 
   void recordMiss(int threadNum);
 
+  void recordSteps(int threadNum, int numSteps, int numGridSteps);
+
   void reduce();
 
   void gatherHitPoints();
 
+  void flushHitPoints();
+
   double getNumWalks() const;
 
   Uncertain<double> getNumHits() const;
 
-  Vector3<Uncertain<double> > getKPlus() const;
-  Vector3<Uncertain<double> > getKMinus() const;
+  double getNumSteps() const;
+  double getNumGridSteps() const;
 
-  Matrix3x3<Uncertain<double> > getVPlus() const;
-  Matrix3x3<Uncertain<double> > getVMinus() const;
+  Vector3<Uncertain<double> > getK() const;
+
+  Matrix3x3<Uncertain<double> > getV() const;
+  Matrix3x3<Uncertain<double> > getW() const;
 
   bool getSaveHitPoints() const;
 
@@ -83,12 +106,83 @@ public:
   std::vector<Vector3<char> > const * getCharges() const;
 
 private:
-  void updateVariance(int threadNum,
+  /// Number of values combined across threads and MPI nodes by reduce().
+  ///
+  static const int numReducedValues = 47;
+
+  /// Results recorded to a single thread number.  Each thread number's
+  /// results are allocated separately, aligned and padded to whole cache
+  /// lines, by the first thread that records to it.  Threads therefore never
+  /// write to the same cache line, and each block is placed on the NUMA node
+  /// of the thread that uses it.
+  ///
+  struct alignas(cacheLineSize) ThreadResults {
+    ThreadResults();
+
+    long long numWalks;
+
+    double numSteps;
+    double numGridSteps;
+
+    //sums, running means, and sums of squared deviations, without
+    //compensated sums
+
+    Vector3<double> K;
+    Matrix3x3<double> V;
+    Matrix3x3<double> W;
+
+    double hitMissMean;
+    double hitMissM2;
+
+    Vector3<double> KMean;
+    Vector3<double> KM2;
+
+    Matrix3x3<double> VMean;
+    Matrix3x3<double> VM2;
+
+    Matrix3x3<double> WMean;
+    Matrix3x3<double> WM2;
+
+    //counts, sums, and sums of squares, with compensated sums
+
+    long long numHits;
+
+    KahanSum<Vector3<double> > KSum;
+    KahanSum<Matrix3x3<double> > VSum;
+    KahanSum<Matrix3x3<double> > WSum;
+
+    KahanSum<Vector3<double> > KSqr;
+    KahanSum<Matrix3x3<double> > VSqr;
+    KahanSum<Matrix3x3<double> > WSqr;
+
+    std::vector<Vector3<double> > points;
+    std::vector<Vector3<double> > normals;
+    std::vector<Vector3<char> > charges;
+
+    std::vector<Vector3<double> > streamPoints;
+    std::vector<Vector3<char> > streamCharges;
+
+    //whether the results recorded here are included in the reduced results
+    //and the gathered hit locations, kept with each thread's results so that
+    //recording never writes to memory shared between threads
+    bool reduced;
+    bool hitPointsGathered;
+  };
+
+  ThreadResults * getThreadResults(int threadNum);
+
+  bool getReduced() const;
+  bool getHitPointsGathered() const;
+
+  void flushThreadPoints(ThreadResults * results);
+
+  void getThreadSums(int threadNum, double * sums) const;
+
+  void updateVariance(ThreadResults * results,
 		      double hitMissData,
-		      Vector3<double> const & KPlusData, 
-		      Vector3<double> const & KMinusData,
-		      Matrix3x3<double> const & VPlusData, 
-		      Matrix3x3<double> const & VMinusData);
+		      Vector3<double> const & KData, 
+		      Matrix3x3<double> const & VData, 
+		      Matrix3x3<double> const & WData);
 
   template <class T>
   void updateItemVariance(T const & data,
@@ -103,61 +197,42 @@ private:
 
   bool saveHitPoints;
 
-  double * numWalks;
-
-  double * hitMissMean;
-  double * hitMissM2;
-
-  Vector3<double> * KPlus;
-  Vector3<double> * KMinus;
+  bool fixedReductionOrder;
 
-  Vector3<double> * KPlusMean;
-  Vector3<double> * KMinusMean;
+  bool expectedCharges;
 
-  Vector3<double> * KPlusM2;
-  Vector3<double> * KMinusM2;
+  bool compensatedSums;
 
-  Matrix3x3<double> * VPlus;
-  Matrix3x3<double> * VMinus;
+  PointsWriter * pointsWriter;
 
-  Matrix3x3<double> * VPlusMean;
-  Matrix3x3<double> * VMinusMean;
-
-  Matrix3x3<double> * VPlusM2;
-  Matrix3x3<double> * VMinusM2;
+  ThreadResults * * threadResults;
 
   double numWalksReduced;
 
+  double numStepsReduced;
+  double numGridStepsReduced;
+
   double numHitsReduced;
   double numHitsVarianceReduced;
 
-  Vector3<double> KPlusReduced;
-  Vector3<double> KMinusReduced;
-
-  Vector3<double> KPlusVarianceReduced;
-  Vector3<double> KMinusVarianceReduced;
+  Vector3<double> KReduced;
+  Vector3<double> KVarianceReduced;
 
-  Matrix3x3<double> VPlusReduced;
-  Matrix3x3<double> VMinusReduced;
+  Matrix3x3<double> VReduced;
+  Matrix3x3<double> VVarianceReduced;
 
-  Matrix3x3<double> VPlusVarianceReduced;
-  Matrix3x3<double> VMinusVarianceReduced;
-
-  std::vector<Vector3<double> > * points;
-  std::vector<Vector3<double> > * normals;
-  std::vector<Vector3<char> > * charges;
+  Matrix3x3<double> WReduced;
+  Matrix3x3<double> WVarianceReduced;
 
   std::vector<Vector3<double> > gatheredPoints;
   std::vector<Vector3<double> > gatheredNormals;
   std::vector<Vector3<char> > gatheredCharges;
-
-  bool reduced;
-  bool hitPointsGathered;
 };
 
 /// Record a hit from the given thread number of a walk from the given start
 /// point to the given end point with the given end point surface normal.
-/// Walker charges are assigned using the given random number generator.
+/// Walker charges are assigned using the given random number generator.  With
+/// expected charges, random charges are only drawn for saved hit points.
 ///
 template <class RandomNumberGenerator>
 void 
@@ -168,66 +243,97 @@ recordHit(int threadNum,
 	  Vector3<double> const & endPointNormal,
 	  RandomNumberGenerator * randomNumberGenerator) {
 
-  assert(threadNum >= 0 && threadNum < numThreads);
+  ThreadResults * results = getThreadResults(threadNum);
 
-  reduced = false;
+  results->reduced = false;
 
   Vector3<double> normalizedStartPoint = startPoint - boundingSphereCenter;
   Vector3<double> normalizedEndPoint   = endPoint - boundingSphereCenter;
 
   Vector3<char> walkCharges;
 
-  double hitMissData = 1;
-
-  Vector3<double> KPlusData(0, 0, 0);
-  Vector3<double> KMinusData(0, 0, 0);
+  Vector3<double> KData(0, 0, 0);
 
-  Matrix3x3<double> VPlusData(0, 0, 0, 0, 0, 0, 0, 0, 0);
-  Matrix3x3<double> VMinusData(0, 0, 0, 0, 0, 0, 0, 0, 0);
+  Matrix3x3<double> VData(0, 0, 0, 0, 0, 0, 0, 0, 0);
+  Matrix3x3<double> WData(0, 0, 0, 0, 0, 0, 0, 0, 0);
 
-  numWalks[threadNum]++;
+  results->numWalks++;
 
   for (int dim = 0; dim < 3; dim++) {
     double probability = 
       0.5 + normalizedStartPoint.get(dim)/(2*boundingSphereRadius);
 
-    if (probability > randomNumberGenerator->getRandIn01()) {
-      //c[dim] == +1
+    double randomCharge = 0;
 
-      walkCharges.set(dim, '+');
+    if (!expectedCharges || saveHitPoints || pointsWriter != NULL) {
+      if (probability > randomNumberGenerator->getRandIn01()) {
+	randomCharge = 1;
 
-      KPlusData.add(dim, 1);
-      VPlusData.addRow(dim, normalizedEndPoint);
+	walkCharges.set(dim, '+');
+      }
+      else {
+	randomCharge = -1;
+
+	walkCharges.set(dim, '-');
+      }
     }
-    else {
-      //c[dim] == -1
 
-      walkCharges.set(dim, '-');
+    //the expected charge is (+1)*probability + (-1)*(1 - probability)
+    double charge = expectedCharges ? 
+      (2*probability - 1) : 
+      randomCharge;
 
-      KMinusData.add(dim, 1);
-      VMinusData.addRow(dim, normalizedEndPoint);
-    }
+    KData.set(dim, charge);
+
+    VData.addRow(dim, normalizedEndPoint);
+    WData.addRow(dim, normalizedEndPoint * charge);
   }
 
-  KPlus[threadNum]  += KPlusData;
-  KMinus[threadNum] += KMinusData;
+  if (compensatedSums) {
+    results->numHits++;
 
-  VPlus[threadNum]  += VPlusData;
-  VMinus[threadNum] += VMinusData;
+    results->KSum.add(KData);
 
-  updateVariance(threadNum,
-		 hitMissData,
-		 KPlusData, 
-		 KMinusData,
-		 VPlusData, 
-		 VMinusData);
+    results->VSum.add(VData);
+    results->WSum.add(WData);
+
+    results->KSqr.add(KData * KData);
+
+    results->VSqr.add(VData * VData);
+    results->WSqr.add(WData * WData);
+  }
+  else {
+    double hitMissData = 1;
+
+    results->K += KData;
+
+    results->V += VData;
+    results->W += WData;
+
+    updateVariance(results,
+		   hitMissData,
+		   KData, 
+		   VData, 
+		   WData);
+  }
 
   if (saveHitPoints) {
-    hitPointsGathered = false;
+    results->hitPointsGathered = false;
+
+    results->points.push_back(endPoint);
+    results->normals.push_back(endPointNormal);
+    results->charges.push_back(walkCharges);
+  }
 
-    points[threadNum].push_back(endPoint);
-    normals[threadNum].push_back(endPointNormal);
-    charges[threadNum].push_back(walkCharges);
+  if (pointsWriter != NULL) {
+    results->streamPoints.push_back(endPoint);
+    results->streamCharges.push_back(walkCharges);
+
+    if (results->streamPoints.size() >= 
+	(size_t)PointsWriter::bufferNumPoints) {
+
+      flushThreadPoints(results);
+    }
   }
 }
 
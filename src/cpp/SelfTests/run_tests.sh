@@ -52,8 +52,72 @@ function compare {
     fi
 }
 
+# Prints one line per number in the given file, holding the number and its
+# standard deviation if it is followed by "+/- <standard deviation>", or the
+# number and "-" otherwise.
+function extract_numbers {
+    exclude_re="Time"
+
+    grep -v $exclude_re $1 | awk '
+        function is_number(s) {
+            return s ~ /^[-+]?[0-9]+([.][0-9]+)?([eE][-+]?[0-9]+)?$/
+        }
+        {
+            for (i = 1; i <= NF; i++) {
+                if (!is_number($i)) {
+                    continue
+                }
+                if ($(i+1) == "+/-" && is_number($(i+2))) {
+                    print $i, $(i+2)
+                    i += 2
+                }
+                else {
+                    print $i, "-"
+                }
+            }
+        }'
+}
+
+# Like compare, but for runs whose random numbers differ from those of the
+# ground truth.  Numbers with standard deviations pass if they differ by at
+# most max_num_sigmas combined standard deviations of the two files.
+function compare_within_error {
+    max_num_sigmas=5
+
+    match_tolerance=0.01
+
+    paste -d " " <(extract_numbers $1) <(extract_numbers $2) | awk '
+        NF != 4 {
+            exit(10)
+        }
+        ($2 == "-") != ($4 == "-") {
+            exit(10)
+        }
+        $2 != "-" && ($2 != 0 || $4 != 0) {
+            if (($1 - $3)^2 > '$max_num_sigmas'^2 * ($2^2 + $4^2)) exit(10)
+            next
+        }
+        $1 ~ /^[-+]?[0-9]+$/ && $3 ~ /^[-+]?[0-9]+$/ {
+            if ($1 != $3) exit(10)
+            next
+        }
+        {
+            if (($1 != 0) && ((($1 - $3)/$1)^2 > '$match_tolerance'^2)) exit(10)
+        }'
+
+    if [ $? == 0 ]; then
+	echo "PASS"
+    else
+	echo "*** FAIL ***"
+    fi
+}
+
 common_params="--num-walks 10000 --num-interior-samples 10000 --seed 0 --print-counts"
 
+form_params="--num-interior-samples 5000 --seed 0 --compute-form"
+
+form_time_params="--num-interior-samples 1000000000 --seed 0 --compute-form"
+
 function run_test {
     test_file=$1_$2_test.txt
     ground_file=$1_$2_ground.txt
@@ -62,7 +126,50 @@ function run_test {
 
     ../zeno -i $1.bod --num-threads $3 $common_params > $test_file
 
-    compare $test_file $ground_file
+    # walks consume random numbers differently than when the ground files
+    # were made, and threads take random number streams in whatever order
+    # they are scheduled, so results match the ground files only within error
+    compare_within_error $test_file $ground_file
+}
+
+function run_form_test {
+    exact_file=$1_form_exact_test.txt
+    histogram_file=$1_form_histogram_test.txt
+
+    echo "Testing" $histogram_file $exact_file "..."
+
+    ../zeno -i $1.bod --num-threads $2 $form_params > $exact_file
+
+    ../zeno -i $1.bod --num-threads $2 $form_params --histogram-form-factors > $histogram_file
+
+    compare $histogram_file $exact_file
+}
+
+# Runs far more interior samples than fit in a short max run time, with form
+# factors, and checks that the run finishes within that time.
+function run_form_time_test {
+    test_file=$1_form_time_test.txt
+
+    echo "Testing" $test_file "within" $3 "seconds ..."
+
+    timeout 60 ../zeno -i $1.bod --num-threads $2 $form_time_params --max-run-time $3 > $test_file
+
+    awk '
+        /^Form factor:/ {
+            form = 1
+        }
+        /^Total Time/ {
+            total_time = $4
+        }
+        END {
+            if (!form || total_time == "" || total_time > '$3') exit(10)
+        }' $test_file
+
+    if [ $? == 0 ]; then
+	echo "PASS"
+    else
+	echo "*** FAIL ***"
+    fi
 }
 
 function run_mpi_test {
@@ -73,7 +180,7 @@ function run_mpi_test {
 
     mpirun -np $4 ../zeno-mpi -i $1.bod --num-threads $3 $common_params > $test_file
 
-    compare $test_file $ground_file
+    compare_within_error $test_file $ground_file
 }
 
 run_test unit_cm serial 1
@@ -90,6 +197,15 @@ run_test torus_1_4 threads 8
 run_test polymer threads 8
 run_test 1LYD threads 8
 
+run_form_test unit_cm 1
+run_form_test two_spheres_1_1 1
+run_form_test two_spheres_1_4 1
+run_form_test torus_1_4 1
+run_form_test polymer 1
+run_form_test 1LYD 1
+
+run_form_time_test 1LYD 1 4
+
 if [ -f ../zeno-mpi ]; then
     run_mpi_test unit_cm mpi 2 4
     run_mpi_test two_spheres_1_1 mpi 2 4
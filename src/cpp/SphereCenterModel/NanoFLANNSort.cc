@@ -27,10 +27,17 @@
 
 #include <limits>
 #include <cassert>
+#include <cmath>
 #include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <functional>
+#include <thread>
 
 #include "NanoFLANNSort.h"
 
+#include "../Timer.h"
+
 // ================================================================
 
 /// Constructs an empty spatial data structure.
@@ -42,6 +49,13 @@ NanoFLANNSort::NanoFLANNSort()
 }
 
 NanoFLANNSort::~NanoFLANNSort() {
+  clear();
+}
+
+/// Removes all spheres from the spatial data structure.
+///
+void 
+NanoFLANNSort::clear() {
   for (unsigned int i = 0; i < nanoFLANNInstances.size(); i ++) {
     delete nanoFLANNInstances.at(i).dataset;
 
@@ -49,53 +63,58 @@ NanoFLANNSort::~NanoFLANNSort() {
 
     delete [] nanoFLANNInstances.at(i).originalSphereIndexes;
   }
+
+  nanoFLANNInstances.clear();
 }
 
 /// Inserts the given spheres into the spatial data structure, allowing for
-/// the given relative error in distance.
+/// the given relative error in distance.  The kd-trees for the different
+/// radii are built concurrently using the given number of threads.
 ///
 void 
 NanoFLANNSort::preprocess(std::vector<Sphere<double> > const & spheres,
-			  double fracErrorBound) {
+			  double fracErrorBound,
+			  int numThreads) {
 
   originalSpheres = &spheres;
 
-  //count number of spheres of each radius
+  //assign each sphere to a radius bin, numbering bins in order of first
+  //appearance
+  std::unordered_map<double, int> radiusNums;
+
+  std::vector<int> sphereRadiusNums(spheres.size());
+
   for (unsigned int sphereNum = 0; 
        sphereNum < spheres.size(); 
        sphereNum ++) {
 
     double sphereRadiusSqr = spheres.at(sphereNum).getRadiusSqr();
 
-    bool radiusFound = false;
+    auto inserted = 
+      radiusNums.emplace(sphereRadiusSqr, nanoFLANNInstances.size());
 
-    for (unsigned int radiusNum = 0; 
-	 radiusNum < nanoFLANNInstances.size(); 
-	 radiusNum ++) {
-
-      if (nanoFLANNInstances.at(radiusNum).sphereRadiusSqr == sphereRadiusSqr) {
-	radiusFound = true;
-
-	nanoFLANNInstances.at(radiusNum).nPts ++;
-
-	break;
-      }
-    }
-
-    if (!radiusFound) {
+    if (inserted.second) {
       NanoFLANNInstance nanoFLANNInstance;
 
       nanoFLANNInstance.sphereRadiusSqr = sphereRadiusSqr;
     
-      nanoFLANNInstance.nPts = 1;
+      nanoFLANNInstance.nPts = 0;
 
       nanoFLANNInstance.dataset = NULL;
       nanoFLANNInstance.kdTree  = NULL;
 
       nanoFLANNInstance.originalSphereIndexes = NULL;
 
+      nanoFLANNInstance.buildTime = 0;
+
       nanoFLANNInstances.push_back(nanoFLANNInstance);
     }
+
+    int radiusNum = inserted.first->second;
+
+    sphereRadiusNums.at(sphereNum) = radiusNum;
+
+    nanoFLANNInstances.at(radiusNum).nPts ++;
   }
 
   //allocate memory for points
@@ -115,50 +134,208 @@ NanoFLANNSort::preprocess(std::vector<Sphere<double> > const & spheres,
        sphereNum < spheres.size(); 
        sphereNum ++) {
 
-    double sphereRadiusSqr = spheres.at(sphereNum).getRadiusSqr();
+    NanoFLANNInstance & nanoFLANNInstance = 
+      nanoFLANNInstances.at(sphereRadiusNums.at(sphereNum));
 
-    bool radiusFound = false;
+    nanoFLANNInstance.originalSphereIndexes[nanoFLANNInstance.nPts] = 
+      sphereNum;
 
-    for (unsigned int radiusNum = 0; 
-	 radiusNum < nanoFLANNInstances.size(); 
-	 radiusNum ++) {
+    nanoFLANNInstance.nPts ++;
+  }
 
-      if (nanoFLANNInstances.at(radiusNum).sphereRadiusSqr == sphereRadiusSqr) {
-	radiusFound = true;
+  //build kdTrees, largest first so a large tree does not start last
+  std::vector<int> buildOrder(nanoFLANNInstances.size());
 
-	int nPts = nanoFLANNInstances.at(radiusNum).nPts;
+  for (unsigned int radiusNum = 0; 
+       radiusNum < nanoFLANNInstances.size(); 
+       radiusNum ++) {
 
-	nanoFLANNInstances.at(radiusNum).originalSphereIndexes[nPts] = 
-	  sphereNum;
+    buildOrder.at(radiusNum) = radiusNum;
+  }
 
-	nanoFLANNInstances.at(radiusNum).nPts ++;
+  std::stable_sort(buildOrder.begin(), buildOrder.end(),
+		   [this](int a, int b) {
+		     return (nanoFLANNInstances.at(a).nPts > 
+			     nanoFLANNInstances.at(b).nPts);
+		   });
 
-	break;
-      }
-    }
+  numThreads = std::max(1, std::min(numThreads, 
+				     (int)nanoFLANNInstances.size()));
+
+  std::atomic<int> nextBuildNum(0);
 
-    assert(radiusFound);
+  std::thread * * threads = new std::thread *[numThreads];
+
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    threads[threadNum] = 
+      new std::thread(&NanoFLANNSort::buildKDTreesThread,
+		      this, 
+		      std::cref(buildOrder), 
+		      &nextBuildNum);
   }
 
-  //build kdTrees
-  for (unsigned int radiusNum = 0; 
-       radiusNum < nanoFLANNInstances.size(); 
-       radiusNum ++) {
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    threads[threadNum]->join();
 
-    int nPts = nanoFLANNInstances.at(radiusNum).nPts;
+    delete threads[threadNum];
+  }
+
+  delete [] threads;
+}
+
+/// Builds kd-trees for the radius bins in the given order until none are
+/// left.  The given counter holds the position in the order of the next bin to
+/// build and is shared between threads.
+///
+void 
+NanoFLANNSort::buildKDTreesThread(std::vector<int> const & buildOrder,
+				  std::atomic<int> * nextBuildNum) {
+
+  for (int buildNum = (*nextBuildNum)++;
+       buildNum < (int)buildOrder.size();
+       buildNum = (*nextBuildNum)++) {
+
+    NanoFLANNInstance & nanoFLANNInstance = 
+      nanoFLANNInstances.at(buildOrder.at(buildNum));
+
+    Timer buildTimer;
+    buildTimer.start();
+
+    DatasetAdaptorType * dataset = 
+      new DatasetAdaptorType(nanoFLANNInstance.nPts, 
+			     nanoFLANNInstance.originalSphereIndexes, 
+			     originalSpheres);
+
+    nanoFLANNInstance.dataset = dataset;
+
+    nanoFLANNInstance.kdTree = new KDTreeType(3, *dataset);
+
+    nanoFLANNInstance.kdTree->buildIndex();
+
+    buildTimer.stop();
+
+    nanoFLANNInstance.buildTime = buildTimer.getTime();
+  }
+}
+
+/// Writes the radius bins and kd-trees to the given file.  Returns whether the
+/// write succeeded.
+///
+bool 
+NanoFLANNSort::save(FILE * file) const {
+
+  int numInstances = nanoFLANNInstances.size();
+
+  fwrite(&numInstances, sizeof(int), 1, file);
+
+  for (int radiusNum = 0; radiusNum < numInstances; radiusNum ++) {
+    NanoFLANNInstance const & nanoFLANNInstance = 
+      nanoFLANNInstances.at(radiusNum);
+
+    fwrite(&nanoFLANNInstance.sphereRadiusSqr, sizeof(double), 1, file);
+    fwrite(&nanoFLANNInstance.nPts, sizeof(int), 1, file);
+
+    fwrite(nanoFLANNInstance.originalSphereIndexes, sizeof(int), 
+	   nanoFLANNInstance.nPts, file);
+
+    nanoFLANNInstance.kdTree->saveIndex(file);
+  }
+
+  return !ferror(file);
+}
+
+/// Reads radius bins and kd-trees written by save() from the given file, for
+/// the given spheres.  The spheres must be the same, in the same order, as
+/// those the data structure was built from.  Returns whether the read
+/// succeeded.  On failure the data structure is left empty.
+///
+bool 
+NanoFLANNSort::load(FILE * file,
+		    std::vector<Sphere<double> > const & spheres) {
+
+  clear();
+
+  originalSpheres = &spheres;
+
+  bool loaded = readInstances(file);
+
+  if (!loaded) {
+    clear();
+  }
+
+  return loaded;
+}
+
+/// Reads the radius bins and kd-trees for load().
+///
+bool 
+NanoFLANNSort::readInstances(FILE * file) {
+
+  std::vector<Sphere<double> > const & spheres = *originalSpheres;
+
+  int numInstances = 0;
+
+  if (fread(&numInstances, sizeof(int), 1, file) != 1) {
+    return false;
+  }
+
+  for (int radiusNum = 0; radiusNum < numInstances; radiusNum ++) {
+    NanoFLANNInstance nanoFLANNInstance;
+
+    nanoFLANNInstance.dataset = NULL;
+    nanoFLANNInstance.kdTree  = NULL;
+
+    nanoFLANNInstance.originalSphereIndexes = NULL;
+
+    nanoFLANNInstance.buildTime = 0;
+
+    if (fread(&nanoFLANNInstance.sphereRadiusSqr, 
+	      sizeof(double), 1, file) != 1 ||
+	fread(&nanoFLANNInstance.nPts, sizeof(int), 1, file) != 1 ||
+	nanoFLANNInstance.nPts < 0 ||
+	nanoFLANNInstance.nPts > (int)spheres.size()) {
+
+      return false;
+    }
+
+    nanoFLANNInstance.originalSphereIndexes = 
+      new int[nanoFLANNInstance.nPts];
+
+    //add to the list immediately so clear() frees it on failure
+    nanoFLANNInstances.push_back(nanoFLANNInstance);
+
+    if (fread(nanoFLANNInstance.originalSphereIndexes, sizeof(int), 
+	      nanoFLANNInstance.nPts, file) != 
+	(size_t)nanoFLANNInstance.nPts) {
+
+      return false;
+    }
+
+    for (int i = 0; i < nanoFLANNInstance.nPts; i++) {
+      int sphereNum = nanoFLANNInstance.originalSphereIndexes[i];
 
-    int * originalSphereIndexes = 
-      nanoFLANNInstances.at(radiusNum).originalSphereIndexes;
+      if (sphereNum < 0 || sphereNum >= (int)spheres.size()) {
+	return false;
+      }
+    }
 
     DatasetAdaptorType * dataset = 
-      new DatasetAdaptorType(nPts, originalSphereIndexes, originalSpheres);
+      new DatasetAdaptorType(nanoFLANNInstance.nPts, 
+			     nanoFLANNInstance.originalSphereIndexes, 
+			     originalSpheres);
 
-    nanoFLANNInstances.at(radiusNum).dataset = dataset;
+    nanoFLANNInstances.back().dataset = dataset;
 
-    nanoFLANNInstances.at(radiusNum).kdTree = new KDTreeType(3, *dataset);
+    nanoFLANNInstances.back().kdTree = new KDTreeType(3, *dataset);
 
-    nanoFLANNInstances.at(radiusNum).kdTree->buildIndex();
+    nanoFLANNInstances.back().kdTree->loadIndex(file);
+
+    if (ferror(file) || feof(file)) {
+      return false;
+    }
   }
+
+  return true;
 }
 
 void 
@@ -167,14 +344,20 @@ NanoFLANNSort::printDataStructureStats()
 
   std::cout << "Number of NanoFLANN instances: " << nanoFLANNInstances.size()
 	    << std::endl
-	    << "Used memory (MB)" << std::endl;
+	    << "Radius, spheres, used memory (MB), build time (s)" << std::endl;
 
   for (unsigned int radiusNum = 0; 
        radiusNum < nanoFLANNInstances.size(); 
        radiusNum ++) {
 
+    NanoFLANNInstance const & nanoFLANNInstance = 
+      nanoFLANNInstances.at(radiusNum);
+
     std::cout << radiusNum << ": " 
-	      << nanoFLANNInstances.at(radiusNum).kdTree->usedMemory() / 1000000.
+	      << sqrt(nanoFLANNInstance.sphereRadiusSqr) << ", "
+	      << nanoFLANNInstance.nPts << ", "
+	      << nanoFLANNInstance.kdTree->usedMemory() / 1000000. << ", "
+	      << nanoFLANNInstance.buildTime
 	      << std::endl;
   }
 
@@ -236,6 +419,47 @@ findNearestSphere(int radiusNum,
   *nearestSphere = &(originalSpheres->at(sphereIndex));
 }
 
+/// Appends to the given list every sphere in the given radius bin whose
+/// surface is within the given distance of the query point.
+///
+void 
+NanoFLANNSort::
+findNearbySpheres(int radiusNum,
+		  Vector3<double> const & queryPoint,
+		  double maxDistance,
+		  std::vector<Sphere<double> const *> * nearbySpheres) 
+  const {
+
+  NanoFLANNInstance const & instance = nanoFLANNInstances.at(radiusNum);
+
+  double maxCenterDist = maxDistance + sqrt(instance.sphereRadiusSqr);
+
+  if (maxCenterDist <= 0) {
+    return;
+  }
+
+  double query[3];
+
+  for (int i = 0; i < 3; i++) {
+    query[i] = queryPoint.get(i);
+  }
+
+  nanoflann::SearchParams params;
+  params.sorted = false;
+
+  std::vector<std::pair<int, double> > matches;
+
+  instance.kdTree->radiusSearch(query, maxCenterDist * maxCenterDist, 
+				matches, params);
+
+  for (unsigned int matchNum = 0; matchNum < matches.size(); matchNum++) {
+    int sphereIndex = 
+      instance.originalSphereIndexes[matches[matchNum].first];
+
+    nearbySpheres->push_back(&(originalSpheres->at(sphereIndex)));
+  }
+}
+
 // ================================================================
 
 // Local Variables:
@@ -29,6 +29,8 @@
 #define NANOFLANNSORT_H
 
 #include <vector>
+#include <atomic>
+#include <cstdio>
 
 #include <nanoflann.hpp>
 
@@ -50,7 +52,13 @@ class NanoFLANNSort {
   ~NanoFLANNSort();
 
   void preprocess(std::vector<Sphere<double> > const & spheres,
-		  double fracErrorBound);
+		  double fracErrorBound,
+		  int numThreads);
+
+  bool save(FILE * file) const;
+
+  bool load(FILE * file,
+	    std::vector<Sphere<double> > const & spheres);
 
   unsigned int getNumRadii() const;
 
@@ -60,6 +68,12 @@ class NanoFLANNSort {
 			 Sphere<double> const * * nearestSphere, 
 			 double * centerDistSqr) const;
 
+  void findNearbySpheres(int radiusNum,
+			 Vector3<double> const & queryPoint,
+			 double maxDistance,
+			 std::vector<Sphere<double> const *> * nearbySpheres)
+    const;
+
   void printDataStructureStats() const;
   void printSearchStats() const;
 
@@ -81,8 +95,17 @@ class NanoFLANNSort {
     KDTreeType * kdTree;
 
     int * originalSphereIndexes;
+
+    double buildTime;
   };
 
+  void clear();
+
+  bool readInstances(FILE * file);
+
+  void buildKDTreesThread(std::vector<int> const & buildOrder,
+			  std::atomic<int> * nextBuildNum);
+
   const std::vector<Sphere<double> > * originalSpheres;
 
   std::vector<NanoFLANNInstance> nanoFLANNInstances;
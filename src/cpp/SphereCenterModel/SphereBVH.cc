@@ -0,0 +1,556 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+#include <limits>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+
+#include "SphereBVH.h"
+
+// ================================================================
+
+/// Constructs an empty spatial data structure.
+///
+SphereBVH::SphereBVH()
+  : originalSpheres(NULL),
+    nodes(),
+    packedSpheres(),
+    originalSphereIndexes(),
+    treeDepth(0) {
+
+}
+
+SphereBVH::~SphereBVH() {
+
+}
+
+/// Inserts the given spheres into the spatial data structure.  The error bound
+/// is only used at query time.  The hierarchy is built serially, so the number
+/// of threads is ignored.
+///
+void
+SphereBVH::preprocess(std::vector<Sphere<double> > const & spheres,
+		      double fracErrorBound,
+		      int numThreads) {
+
+  originalSpheres = &spheres;
+
+  nodes.clear();
+  treeDepth = 0;
+
+  if (spheres.empty()) {
+    return;
+  }
+
+  originalSphereIndexes.resize(spheres.size());
+
+  for (unsigned int sphereNum = 0;
+       sphereNum < spheres.size();
+       sphereNum ++) {
+
+    originalSphereIndexes.at(sphereNum) = sphereNum;
+  }
+
+  //a median split creates at most 2 * numSpheres / maxLeafSize nodes
+  nodes.reserve(2 * (spheres.size() / maxLeafSize + 1));
+
+  buildNode(0, spheres.size(), 1);
+
+  //copy sphere data into leaf order
+  packedSpheres.resize(4 * spheres.size());
+
+  for (unsigned int i = 0; i < spheres.size(); i ++) {
+    Sphere<double> const & sphere = spheres.at(originalSphereIndexes.at(i));
+
+    for (int dim = 0; dim < 3; dim++) {
+      packedSpheres.at(4*i + dim) = sphere.getCenter().get(dim);
+    }
+
+    packedSpheres.at(4*i + 3) = sphere.getRadius();
+  }
+}
+
+/// Writes the hierarchy to the given file.  Returns whether the write
+/// succeeded.
+///
+bool
+SphereBVH::save(FILE * file) const {
+
+  int numNodes   = nodes.size();
+  int numSpheres = originalSphereIndexes.size();
+
+  fwrite(&numNodes, sizeof(int), 1, file);
+  fwrite(&numSpheres, sizeof(int), 1, file);
+  fwrite(&treeDepth, sizeof(int), 1, file);
+
+  fwrite(nodes.data(), sizeof(Node), numNodes, file);
+  fwrite(packedSpheres.data(), sizeof(double), 4 * numSpheres, file);
+  fwrite(originalSphereIndexes.data(), sizeof(int), numSpheres, file);
+
+  return !ferror(file);
+}
+
+/// Reads a hierarchy written by save() from the given file, for the given
+/// spheres.  The spheres must be the same, in the same order, as those the
+/// hierarchy was built from.  Returns whether the read succeeded.  On failure
+/// the data structure is left empty.
+///
+bool
+SphereBVH::load(FILE * file,
+		std::vector<Sphere<double> > const & spheres) {
+
+  originalSpheres = &spheres;
+
+  bool loaded = readArrays(file);
+
+  if (!loaded) {
+    nodes.clear();
+    packedSpheres.clear();
+    originalSphereIndexes.clear();
+
+    treeDepth = 0;
+  }
+
+  return loaded;
+}
+
+/// Reads the arrays for load().
+///
+bool
+SphereBVH::readArrays(FILE * file) {
+
+  int numNodes   = 0;
+  int numSpheres = 0;
+
+  if (fread(&numNodes, sizeof(int), 1, file) != 1 ||
+      fread(&numSpheres, sizeof(int), 1, file) != 1 ||
+      fread(&treeDepth, sizeof(int), 1, file) != 1) {
+
+    return false;
+  }
+
+  if (numSpheres != (int)originalSpheres->size() ||
+      numNodes < 0 || treeDepth > maxDepth) {
+
+    return false;
+  }
+
+  // check that the rest of the file holds exactly the arrays before
+  // allocating them
+
+  long arraysPosition = ftell(file);
+
+  if (arraysPosition < 0 || fseek(file, 0, SEEK_END) != 0) {
+    return false;
+  }
+
+  long arraysSize = ftell(file) - arraysPosition;
+
+  if (fseek(file, arraysPosition, SEEK_SET) != 0 ||
+      arraysSize != 
+      (long)(numNodes * sizeof(Node) + 
+	     numSpheres * (4 * sizeof(double) + sizeof(int)))) {
+
+    return false;
+  }
+
+  nodes.resize(numNodes);
+  packedSpheres.resize(4 * numSpheres);
+  originalSphereIndexes.resize(numSpheres);
+
+  if (fread(nodes.data(), sizeof(Node), numNodes, file) != 
+      (size_t)numNodes ||
+      fread(packedSpheres.data(), sizeof(double), 4 * numSpheres, file) != 
+      (size_t)(4 * numSpheres) ||
+      fread(originalSphereIndexes.data(), sizeof(int), numSpheres, file) != 
+      (size_t)numSpheres) {
+
+    return false;
+  }
+
+  for (int i = 0; i < numSpheres; i++) {
+    if (originalSphereIndexes[i] < 0 || 
+	originalSphereIndexes[i] >= numSpheres) {
+
+      return false;
+    }
+  }
+
+  //the searches index nodes and packedSpheres without bounds checks, so
+  //every node must be checked before they are used.  An empty model has a
+  //single leaf with no spheres, which cannot be told apart from an interior
+  //node, so it is simply rebuilt.
+  if (numNodes < 1) {
+    return false;
+  }
+
+  std::vector<int> nodeDepths(numNodes, 0);
+  std::vector<int> numParents(numNodes, 0);
+
+  nodeDepths[0] = 1;
+
+  //children always follow their parent, so one pass in order visits every
+  //parent before its children
+  for (int nodeNum = 0; nodeNum < numNodes; nodeNum++) {
+    Node const & node = nodes[nodeNum];
+
+    if (nodeDepths[nodeNum] > maxDepth ||
+	node.numSpheres < 0 || node.numSpheres > maxLeafSize) {
+
+      return false;
+    }
+
+    if (node.numSpheres > 0) {
+      if (node.offset < 0 || node.offset > numSpheres - node.numSpheres) {
+	return false;
+      }
+    }
+    else {
+      int firstChild  = nodeNum + 1;
+      int secondChild = node.offset;
+
+      if (firstChild >= numNodes ||
+	  secondChild <= firstChild || secondChild >= numNodes) {
+
+	return false;
+      }
+
+      nodeDepths[firstChild]  = nodeDepths[nodeNum] + 1;
+      nodeDepths[secondChild] = nodeDepths[nodeNum] + 1;
+
+      numParents[firstChild]  ++;
+      numParents[secondChild] ++;
+    }
+  }
+
+  //every node other than the root must be the child of exactly one node
+  for (int nodeNum = 1; nodeNum < numNodes; nodeNum++) {
+    if (numParents[nodeNum] != 1) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/// Recursively builds the subtree containing the spheres with indexes in
+/// [begin, end) of originalSphereIndexes.  Spheres are split at the median
+/// center coordinate along the longest axis of the node's center bounds.
+///
+void
+SphereBVH::buildNode(int begin, int end, int depth) {
+
+  assert(depth <= maxDepth);
+
+  treeDepth = std::max(treeDepth, depth);
+
+  int nodeNum = nodes.size();
+
+  nodes.push_back(Node());
+
+  Node node;
+
+  for (int dim = 0; dim < 3; dim++) {
+    node.minCenterCoords[dim] =  std::numeric_limits<double>::max();
+    node.maxCenterCoords[dim] = -std::numeric_limits<double>::max();
+  }
+
+  node.maxRadius = 0;
+
+  for (int i = begin; i < end; i++) {
+    Sphere<double> const & sphere =
+      originalSpheres->at(originalSphereIndexes.at(i));
+
+    for (int dim = 0; dim < 3; dim++) {
+      double coord = sphere.getCenter().get(dim);
+
+      node.minCenterCoords[dim] = std::min(node.minCenterCoords[dim], coord);
+      node.maxCenterCoords[dim] = std::max(node.maxCenterCoords[dim], coord);
+    }
+
+    node.maxRadius = std::max(node.maxRadius, sphere.getRadius());
+  }
+
+  if (end - begin <= maxLeafSize) {
+    node.offset     = begin;
+    node.numSpheres = end - begin;
+
+    nodes.at(nodeNum) = node;
+
+    return;
+  }
+
+  int splitDim = 0;
+
+  for (int dim = 1; dim < 3; dim++) {
+    if (node.maxCenterCoords[dim] - node.minCenterCoords[dim] >
+	node.maxCenterCoords[splitDim] - node.minCenterCoords[splitDim]) {
+
+      splitDim = dim;
+    }
+  }
+
+  int middle = begin + (end - begin) / 2;
+
+  std::vector<Sphere<double> > const & spheres = *originalSpheres;
+
+  std::nth_element(originalSphereIndexes.begin() + begin,
+		   originalSphereIndexes.begin() + middle,
+		   originalSphereIndexes.begin() + end,
+		   [&spheres, splitDim](int a, int b) {
+		     return (spheres[a].getCenter().get(splitDim) <
+			     spheres[b].getCenter().get(splitDim));
+		   });
+
+  buildNode(begin, middle, depth + 1);
+
+  node.offset     = nodes.size();
+  node.numSpheres = 0;
+
+  buildNode(middle, end, depth + 1);
+
+  nodes.at(nodeNum) = node;
+}
+
+/// Returns a lower bound on (center distance - radius) from the given query
+/// point to any sphere in the subtree rooted at the given node.
+///
+inline double
+SphereBVH::computeLowerBound(Node const & node,
+			     Vector3<double> const & queryPoint) const {
+
+  double boxDistSqr = 0;
+
+  for (int dim = 0; dim < 3; dim++) {
+    double coord = queryPoint.get(dim);
+
+    double delta = std::max(std::max(node.minCenterCoords[dim] - coord,
+				     coord - node.maxCenterCoords[dim]),
+			    0.);
+
+    boxDistSqr += delta * delta;
+  }
+
+  return sqrt(boxDistSqr) - node.maxRadius;
+}
+
+void
+SphereBVH::printDataStructureStats()
+  const {
+
+  double usedMemory =
+    nodes.size() * sizeof(Node) +
+    packedSpheres.size() * sizeof(double) +
+    originalSphereIndexes.size() * sizeof(int);
+
+  std::cout << "Number of BVH nodes: " << nodes.size() << std::endl
+	    << "BVH depth: " << treeDepth << std::endl
+	    << "Used memory (MB): " << usedMemory / 1000000. << std::endl
+	    << std::endl;
+}
+
+void
+SphereBVH::printSearchStats()
+  const {
+
+}
+
+/// Returns the number of separately searched radius bins.  All spheres are
+/// stored in a single hierarchy regardless of radius, so this is 1 unless the
+/// data structure is empty.
+///
+unsigned int
+SphereBVH::
+getNumRadii()
+  const {
+
+  return nodes.empty() ? 0 : 1;
+}
+
+/// Searches all spheres for the one whose surface is closest to the given
+/// query point, allowing for the given relative error in distance.  Computes
+/// both the closest sphere and the square distance to its center.
+///
+void
+SphereBVH::
+findNearestSphere(int radiusNum,
+		  Vector3<double> const & queryPoint,
+		  double fracErrorBound,
+		  Sphere<double> const * * nearestSphere,
+		  double * centerDistSqr)
+  const {
+
+  assert(radiusNum == 0);
+
+  double errorFactor = 1 + fracErrorBound;
+
+  double minDistance = std::numeric_limits<double>::max();
+
+  int nearestIndex = -1;
+
+  //each level of the tree pushes at most one node that is not popped
+  int    nodeStack[2 * maxDepth];
+  double boundStack[2 * maxDepth];
+
+  int stackSize = 0;
+
+  nodeStack[stackSize]  = 0;
+  boundStack[stackSize] = computeLowerBound(nodes[0], queryPoint);
+  stackSize ++;
+
+  while (stackSize > 0) {
+    stackSize --;
+
+    int    nodeNum    = nodeStack[stackSize];
+    double lowerBound = boundStack[stackSize];
+
+    if (lowerBound > 0) {
+      lowerBound *= errorFactor;
+    }
+
+    if (lowerBound >= minDistance) {
+      continue;
+    }
+
+    Node const & node = nodes[nodeNum];
+
+    if (node.numSpheres > 0) {
+      double const * sphere = &packedSpheres[4 * node.offset];
+
+      for (int i = 0; i < node.numSpheres; i++, sphere += 4) {
+	double dx = queryPoint.getX() - sphere[0];
+	double dy = queryPoint.getY() - sphere[1];
+	double dz = queryPoint.getZ() - sphere[2];
+
+	double distSqr = dx*dx + dy*dy + dz*dz;
+
+	//avoid the square root when this sphere cannot be closer
+	double maxCenterDist = minDistance + sphere[3];
+
+	if (maxCenterDist <= 0 || distSqr >= maxCenterDist * maxCenterDist) {
+	  continue;
+	}
+
+	double distance = sqrt(distSqr) - sphere[3];
+
+	if (distance < minDistance) {
+	  minDistance    = distance;
+	  nearestIndex   = node.offset + i;
+	  *centerDistSqr = distSqr;
+	}
+      }
+    }
+    else {
+      int firstChild  = nodeNum + 1;
+      int secondChild = node.offset;
+
+      double firstBound  = computeLowerBound(nodes[firstChild],  queryPoint);
+      double secondBound = computeLowerBound(nodes[secondChild], queryPoint);
+
+      //push the farther child first so the nearer one is searched first
+      if (firstBound < secondBound) {
+	std::swap(firstChild, secondChild);
+	std::swap(firstBound, secondBound);
+      }
+
+      nodeStack[stackSize]  = firstChild;
+      boundStack[stackSize] = firstBound;
+      stackSize ++;
+
+      nodeStack[stackSize]  = secondChild;
+      boundStack[stackSize] = secondBound;
+      stackSize ++;
+    }
+  }
+
+  assert(nearestIndex >= 0);
+
+  int sphereIndex = originalSphereIndexes[nearestIndex];
+
+  *nearestSphere = &(originalSpheres->at(sphereIndex));
+}
+
+/// Appends to the given list every sphere whose surface is within the given
+/// distance of the query point.
+///
+void
+SphereBVH::
+findNearbySpheres(int radiusNum,
+		  Vector3<double> const & queryPoint,
+		  double maxDistance,
+		  std::vector<Sphere<double> const *> * nearbySpheres)
+  const {
+
+  assert(radiusNum == 0);
+
+  int nodeStack[2 * maxDepth];
+
+  int stackSize = 0;
+
+  nodeStack[stackSize] = 0;
+  stackSize ++;
+
+  while (stackSize > 0) {
+    stackSize --;
+
+    int nodeNum = nodeStack[stackSize];
+
+    Node const & node = nodes[nodeNum];
+
+    if (computeLowerBound(node, queryPoint) > maxDistance) {
+      continue;
+    }
+
+    if (node.numSpheres > 0) {
+      double const * sphere = &packedSpheres[4 * node.offset];
+
+      for (int i = 0; i < node.numSpheres; i++, sphere += 4) {
+	double maxCenterDist = maxDistance + sphere[3];
+
+	if (maxCenterDist < 0) {
+	  continue;
+	}
+
+	double dx = queryPoint.getX() - sphere[0];
+	double dy = queryPoint.getY() - sphere[1];
+	double dz = queryPoint.getZ() - sphere[2];
+
+	if (dx*dx + dy*dy + dz*dz <= maxCenterDist * maxCenterDist) {
+	  int sphereIndex = originalSphereIndexes[node.offset + i];
+
+	  nearbySpheres->push_back(&(originalSpheres->at(sphereIndex)));
+	}
+      }
+    }
+    else {
+      nodeStack[stackSize] = nodeNum + 1;
+      stackSize ++;
+
+      nodeStack[stackSize] = node.offset;
+      stackSize ++;
+    }
+  }
+}
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// End:
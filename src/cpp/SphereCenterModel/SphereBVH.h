@@ -0,0 +1,117 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+#ifndef SPHEREBVH_H
+#define SPHEREBVH_H
+
+#include <vector>
+#include <cstdio>
+
+#include "../Geometry/Sphere.h"
+#include "../Geometry/Vector3.h"
+
+// ================================================================
+
+/// Spatial data structure for storing spheres of arbitrary radii.
+/// All spheres are stored in a single bounding volume hierarchy built over
+/// the sphere centers.  Each node also stores the largest radius of any sphere
+/// below it, so a subtree can be pruned using a lower bound on
+/// (center distance - radius) without first sorting the spheres by radius.
+///
+class SphereBVH {
+ public:
+  SphereBVH();
+
+  ~SphereBVH();
+
+  void preprocess(std::vector<Sphere<double> > const & spheres,
+		  double fracErrorBound,
+		  int numThreads);
+
+  bool save(FILE * file) const;
+
+  bool load(FILE * file,
+	    std::vector<Sphere<double> > const & spheres);
+
+  unsigned int getNumRadii() const;
+
+  void findNearestSphere(int radiusNum,
+			 Vector3<double> const & queryPoint,
+			 double fracErrorBound,
+			 Sphere<double> const * * nearestSphere,
+			 double * centerDistSqr) const;
+
+  void findNearbySpheres(int radiusNum,
+			 Vector3<double> const & queryPoint,
+			 double maxDistance,
+			 std::vector<Sphere<double> const *> * nearbySpheres)
+    const;
+
+  void printDataStructureStats() const;
+  void printSearchStats() const;
+
+ private:
+  /// Maximum number of spheres stored in a leaf node.
+  ///
+  static const int maxLeafSize = 4;
+
+  /// Maximum depth of the hierarchy, used to size the traversal stack.
+  ///
+  static const int maxDepth = 64;
+
+  struct Node {
+    double minCenterCoords[3];
+    double maxCenterCoords[3];
+
+    double maxRadius;
+
+    // For leaf nodes, the index of the first sphere in packedSpheres.
+    // For interior nodes, the index of the second child.  The first child
+    // always immediately follows its parent.
+    int offset;
+
+    // Number of spheres in a leaf node, or 0 for an interior node.
+    int numSpheres;
+  };
+
+  void buildNode(int begin, int end, int depth);
+
+  bool readArrays(FILE * file);
+
+  double computeLowerBound(Node const & node,
+			   Vector3<double> const & queryPoint) const;
+
+  const std::vector<Sphere<double> > * originalSpheres;
+
+  std::vector<Node> nodes;
+
+  // Sphere centers and radii in leaf order, packed as (x, y, z, r).
+  std::vector<double> packedSpheres;
+
+  std::vector<int> originalSphereIndexes;
+
+  int treeDepth;
+};
+
+#endif
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// End:
@@ -30,6 +30,7 @@
 
 #include <cmath>
 #include <cassert>
+#include <algorithm>
 
 #include "../Geometry/Sphere.h"
 #include "../Geometry/Vector3.h"
@@ -38,6 +39,11 @@
 /// distribution using a direct (non-iterative) method.  The distribution is
 /// suitable for reinserting random walkers that have left the launch sphere. 
 ///
+/// Points are generated around the Z axis and mapped into an orthonormal frame
+/// whose third axis points toward the distribution center.  Points can also
+/// be generated in bulk, in which case the frame is computed once and the
+/// points are computed in a loop the compiler can vectorize.
+///
 template <class T, 
           class RandomNumberGenerator, 
           class RandomSpherePointGenerator>
@@ -48,7 +54,30 @@ class BiasedSpherePointDirect {
 			     Vector3<T> const & distributionCenter,
 			     T alpha);
 
+  static void generate(RandomNumberGenerator * rng, 
+		       Sphere<T> const & sphere,
+		       Vector3<T> const & distributionCenter,
+		       T alpha,
+		       int numPoints,
+		       Vector3<T> * points);
+
  private:
+  /// Maximum number of points generated at a time in bulk generation.
+  ///
+  static const int maxBatchSize = 256;
+
+  static void computeFrame(Sphere<T> const & sphere,
+			   Vector3<T> const & distributionCenter,
+			   Vector3<T> * xAxis,
+			   Vector3<T> * yAxis,
+			   Vector3<T> * zAxis);
+
+  static Vector3<T> generateInFrame(T R, T phiFraction, T alpha,
+				    Sphere<T> const & sphere,
+				    Vector3<T> const & xAxis,
+				    Vector3<T> const & yAxis,
+				    Vector3<T> const & zAxis);
+
   static T computeCosTheta(T alpha, T R);
 };
 
@@ -67,44 +96,128 @@ BiasedSpherePointDirect<T,
 	   Vector3<T> const & distributionCenter,
 	   T alpha) {
 
-  //generate point on unit sphere centered at origin distributed around Z axis
-
   T R = rng->getRandInRange(0, 1);
 
-  T cosTheta = computeCosTheta(alpha, R);
+  T phiFraction = rng->getRandInRange(0, 1);
 
-  T sinTheta = sqrt(1 - pow(cosTheta, 2));
+  Vector3<T> xAxis, yAxis, zAxis;
 
-  T phi = rng->getRandInRange(0, 2*M_PI);
+  computeFrame(sphere, distributionCenter, &xAxis, &yAxis, &zAxis);
 
-  Vector3<T> point(sinTheta * cos(phi),
-		   sinTheta * sin(phi),
-		   cosTheta);
+  return generateInFrame(R, phiFraction, alpha, 
+			 sphere, xAxis, yAxis, zAxis);
+}
 
-  //rotate point to be distributed around requested distribution center
+/// Generates the given number of random points on the given sphere from a
+/// distribution centered at the given point with distribution parameter
+/// "alpha", and writes them to the given array.
+///
+template <class T, 
+          class RandomNumberGenerator, 
+          class RandomSpherePointGenerator>
+void
+BiasedSpherePointDirect<T, 
+                        RandomNumberGenerator,
+                        RandomSpherePointGenerator>::
+  generate(RandomNumberGenerator * rng, 
+	   Sphere<T> const & sphere,
+	   Vector3<T> const & distributionCenter,
+	   T alpha,
+	   int numPoints,
+	   Vector3<T> * points) {
 
-  Vector3<T> recenteredDistributionCenter =
-    distributionCenter - sphere.getCenter();
+  Vector3<T> xAxis, yAxis, zAxis;
 
-  recenteredDistributionCenter.normalize();
+  computeFrame(sphere, distributionCenter, &xAxis, &yAxis, &zAxis);
 
-  //will cause problems if recenteredDistributionCenter is close to <0, 0, 1>
-  Vector3<T> rotationAxis =
-    recenteredDistributionCenter.cross(Vector3<T>(0, 0, 1));
+  double nums[2*maxBatchSize];
 
-  T sinRotationAngle = rotationAxis.getMagnitude();
+  for (int firstPointNum = 0; 
+       firstPointNum < numPoints; 
+       firstPointNum += maxBatchSize) {
 
-  T cosRotationAngle =
-    recenteredDistributionCenter.dot(Vector3<T>(0, 0, 1));
+    int batchSize = std::min(numPoints - firstPointNum, maxBatchSize);
 
-  point.rotate(cosRotationAngle, sinRotationAngle, rotationAxis);
+    rng->fillRandIn01(nums, 2*batchSize);
 
-  //move point onto requested sphere
+    for (int i = 0; i < batchSize; i++) {
+      points[firstPointNum + i] = 
+	generateInFrame(nums[2*i], nums[2*i + 1], alpha,
+			sphere, xAxis, yAxis, zAxis);
+    }
+  }
+}
+
+/// Computes an orthonormal frame whose Z axis points from the center of the
+/// given sphere toward the given distribution center.  Uses the branchless
+/// construction of Duff et al., "Building an Orthonormal Basis, Revisited"
+/// (JCGT 2017), which is stable for every direction.
+///
+template <class T, 
+          class RandomNumberGenerator, 
+          class RandomSpherePointGenerator>
+void
+BiasedSpherePointDirect<T, 
+                        RandomNumberGenerator,
+                        RandomSpherePointGenerator>::
+  computeFrame(Sphere<T> const & sphere,
+	       Vector3<T> const & distributionCenter,
+	       Vector3<T> * xAxis,
+	       Vector3<T> * yAxis,
+	       Vector3<T> * zAxis) {
 
-  point *= sphere.getRadius();
-  point += sphere.getCenter();
+  *zAxis = distributionCenter - sphere.getCenter();
 
-  return point;
+  zAxis->normalize();
+
+  T sign = copysign((T)1, zAxis->getZ());
+
+  T a = -1 / (sign + zAxis->getZ());
+  T b = zAxis->getX() * zAxis->getY() * a;
+
+  xAxis->setXYZ(1 + sign * zAxis->getX() * zAxis->getX() * a,
+		sign * b,
+		-sign * zAxis->getX());
+
+  yAxis->setXYZ(b,
+		sign + zAxis->getY() * zAxis->getY() * a,
+		-zAxis->getY());
+}
+
+/// Generates the point on the given sphere, in the given frame, for the given
+/// uniform random numbers in [0, 1).
+///
+template <class T, 
+          class RandomNumberGenerator, 
+          class RandomSpherePointGenerator>
+Vector3<T> 
+BiasedSpherePointDirect<T, 
+                        RandomNumberGenerator,
+                        RandomSpherePointGenerator>::
+  generateInFrame(T R, T phiFraction, T alpha,
+		  Sphere<T> const & sphere,
+		  Vector3<T> const & xAxis,
+		  Vector3<T> const & yAxis,
+		  Vector3<T> const & zAxis) {
+
+  T cosTheta = computeCosTheta(alpha, R);
+
+  T sinTheta = sqrt(1 - cosTheta*cosTheta);
+
+  T phi = phiFraction * (2*M_PI);
+
+  //adjacent calls with the same argument are combined into one sincos call
+  T cosPhi = cos(phi);
+  T sinPhi = sin(phi);
+
+  Vector3<T> point = 
+    xAxis * (sinTheta * cosPhi) + 
+    yAxis * (sinTheta * sinPhi) + 
+    zAxis * cosTheta;
+
+  //move point onto requested sphere
+
+  return point * sphere.getRadius() + sphere.getCenter();
 }
 
 template <class T, 
@@ -116,24 +229,23 @@ BiasedSpherePointDirect<T,
                         RandomSpherePointGenerator>::
   computeCosTheta(T alpha, T R) {
 
-  
-    T num = (-pow(1 - alpha, 2) + 
-	     2*(1 - alpha)*(1 + pow(alpha, 2))*R + 
-	     2*alpha*(1 + pow(alpha, 2))*pow(R, 2));
+    T oneMinusAlpha = 1 - alpha;
+    T onePlusAlphaSqr = 1 + alpha*alpha;
+
+    T num = (-oneMinusAlpha*oneMinusAlpha + 
+	     2*oneMinusAlpha*onePlusAlphaSqr*R + 
+	     2*alpha*onePlusAlphaSqr*R*R);
 
-    T den = pow(1 - alpha + 2*alpha*R, 2);
+    T denRoot = oneMinusAlpha + 2*alpha*R;
+
+    T den = denRoot*denRoot;
 
     assert(den != 0);
 
     T cosTheta = num/den;
 
     //correct for numerical errors
-    if (cosTheta > 1) {
-      // std::cerr << "Warning: cosTheta > 1 (cosTheta == " << cosTheta << ")" 
-      //           << std::endl;
-
-      cosTheta = 1;
-    }
+    cosTheta = std::min(cosTheta, (T)1);
 
     return cosTheta;
 }
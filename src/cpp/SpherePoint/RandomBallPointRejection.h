@@ -28,16 +28,29 @@
 #ifndef RANDOM_BALL_POINT_REJECTION_H
 #define RANDOM_BALL_POINT_REJECTION_H
 
+#include <algorithm>
+
 #include "../Geometry/Sphere.h"
 #include "../Geometry/Vector3.h"
 
 /// Generates random sample points inside a sphere from a uniform
 /// distribution using a rejection (iterative) method. 
 ///
+/// Points can also be generated in bulk, drawing and rejecting candidates a
+/// batch at a time without branching, as in RandomSpherePointMarsaglia.
+///
 template <class T, class RNG>
 class RandomBallPointRejection {
  public:
   static Vector3<T> generate(RNG * rng, Sphere<T> const & ball);
+
+  static void generate(RNG * rng, Sphere<T> const & ball,
+		       int numPoints, Vector3<T> * points);
+
+ private:
+  /// Maximum number of candidate points drawn at a time in bulk generation.
+  ///
+  static const int maxBatchSize = 256;
 };
 
 /// Generates a random point inside the given sphere.
@@ -71,6 +84,62 @@ RandomBallPointRejection<T, RNG>::generate(RNG * rng,
   return ballPoint;
 }
 
+/// Generates the given number of random points inside the given sphere and
+/// writes them to the given array.
+///
+template <class T, class RNG>
+void
+RandomBallPointRejection<T, RNG>::generate(RNG * rng, 
+					   Sphere<T> const & ball,
+					   int numPoints,
+					   Vector3<T> * points) {
+
+  double nums[3*maxBatchSize];
+
+  T xs[maxBatchSize], ys[maxBatchSize], zs[maxBatchSize];
+
+  T lengthSqrs[maxBatchSize];
+
+  int numPointsDone = 0;
+
+  while (numPointsDone < numPoints) {
+    //about pi/6 of the candidates are accepted
+    int batchSize = std::min((numPoints - numPointsDone) * 2 + 4,
+			     maxBatchSize);
+
+    rng->fillRandIn01(nums, 3*batchSize);
+
+    for (int i = 0; i < batchSize; i++) {
+      xs[i] = 2*nums[3*i]     - 1;
+      ys[i] = 2*nums[3*i + 1] - 1;
+      zs[i] = 2*nums[3*i + 2] - 1;
+
+      lengthSqrs[i] = xs[i]*xs[i] + ys[i]*ys[i] + zs[i]*zs[i];
+    }
+
+    int numAccepted = 0;
+
+    for (int i = 0; i < batchSize; i++) {
+      xs[numAccepted] = xs[i];
+      ys[numAccepted] = ys[i];
+      zs[numAccepted] = zs[i];
+
+      numAccepted += (lengthSqrs[i] <= 1);
+    }
+
+    int numToUse = std::min(numAccepted, numPoints - numPointsDone);
+
+    for (int i = 0; i < numToUse; i++) {
+      Vector3<T> ballPoint(xs[i], ys[i], zs[i]);
+
+      points[numPointsDone + i] = 
+	ballPoint * ball.getRadius() + ball.getCenter();
+    }
+
+    numPointsDone += numToUse;
+  }
+}
+
 #endif
 
 // ================================================================
@@ -28,18 +28,34 @@
 #ifndef RANDOM_SPHERE_POINT_MARSAGLIA_H
 #define RANDOM_SPHERE_POINT_MARSAGLIA_H
 
+#include <cmath>
+#include <algorithm>
+
 #include "../Geometry/Sphere.h"
 #include "../Geometry/Vector3.h"
 
 /// Generates random sample points on a sphere from a uniform
 /// distribution using the Marsaglia method. 
 ///
+/// Points can also be generated in bulk.  Candidates are then drawn a batch at
+/// a time with the random number generator's block interface, and rejection
+/// is done by compacting the accepted candidates without branching, so the
+/// arithmetic on each batch is done in loops the compiler can vectorize.
+///
 /// Marsaglia, George. Choosing a Point from the Surface of a Sphere. Ann. Math. Statist. 43 (1972), no. 2, 645--646. doi:10.1214/aoms/1177692644. http://projecteuclid.org/euclid.aoms/1177692644.
 ///
 template <class T, class RNG>
 class RandomSpherePointMarsaglia {
  public:
   static Vector3<T> generate(RNG * rng, Sphere<T> const & sphere);
+
+  static void generate(RNG * rng, Sphere<T> const & sphere,
+		       int numPoints, Vector3<T> * points);
+
+ private:
+  /// Maximum number of candidate points drawn at a time in bulk generation.
+  ///
+  static const int maxBatchSize = 256;
 };
 
 /// Generates a random point on the given sphere.
@@ -76,6 +92,63 @@ RandomSpherePointMarsaglia<T, RNG>::generate(RNG * rng,
   return spherePoint;
 }
 
+/// Generates the given number of random points on the given sphere and writes
+/// them to the given array.
+///
+template <class T, class RNG>
+void
+RandomSpherePointMarsaglia<T, RNG>::generate(RNG * rng, 
+					     Sphere<T> const & sphere,
+					     int numPoints,
+					     Vector3<T> * points) {
+
+  double nums[2*maxBatchSize];
+
+  T xs[maxBatchSize], ys[maxBatchSize], lengthSqrs[maxBatchSize];
+
+  int numPointsDone = 0;
+
+  while (numPointsDone < numPoints) {
+    //about pi/4 of the candidates are accepted
+    int batchSize = std::min((numPoints - numPointsDone) * 4/3 + 4,
+			     maxBatchSize);
+
+    rng->fillRandIn01(nums, 2*batchSize);
+
+    for (int i = 0; i < batchSize; i++) {
+      xs[i] = 2*nums[2*i]     - 1;
+      ys[i] = 2*nums[2*i + 1] - 1;
+
+      lengthSqrs[i] = xs[i]*xs[i] + ys[i]*ys[i];
+    }
+
+    int numAccepted = 0;
+
+    for (int i = 0; i < batchSize; i++) {
+      xs[numAccepted]         = xs[i];
+      ys[numAccepted]         = ys[i];
+      lengthSqrs[numAccepted] = lengthSqrs[i];
+
+      numAccepted += (lengthSqrs[i] <= 1);
+    }
+
+    int numToUse = std::min(numAccepted, numPoints - numPointsDone);
+
+    for (int i = 0; i < numToUse; i++) {
+      T scale = 2*sqrt(1 - lengthSqrs[i]);
+
+      Vector3<T> spherePoint(scale*xs[i],
+			     scale*ys[i],
+			     2*lengthSqrs[i] - 1);
+
+      points[numPointsDone + i] = 
+	spherePoint * sphere.getRadius() + sphere.getCenter();
+    }
+
+    numPointsDone += numToUse;
+  }
+}
+
 #endif
 
 // ================================================================
@@ -0,0 +1,128 @@
+// ================================================================
+// 
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+// 
+// ================================================================
+
+#include "ThreadPool.h"
+
+// ================================================================
+
+/// Starts the given number of worker threads, which wait for tasks.
+///
+ThreadPool::ThreadPool(int numThreads) 
+  : workers(),
+    mutex(),
+    taskReady(),
+    taskDone(),
+    task(NULL),
+    taskNum(0),
+    numWorkersRunning(0),
+    stopping(false) {
+
+  workers.reserve(numThreads);
+
+  for (int threadNum = 0; threadNum < numThreads; threadNum++) {
+    workers.emplace_back(&ThreadPool::workerThread, this, threadNum);
+  }
+}
+
+/// Stops and joins the worker threads.
+///
+ThreadPool::~ThreadPool() {
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    stopping = true;
+  }
+
+  taskReady.notify_all();
+
+  for (std::thread & worker : workers) {
+    worker.join();
+  }
+}
+
+int
+ThreadPool::getNumThreads() const {
+
+  return workers.size();
+}
+
+/// Runs the given task once on each worker thread, passing the number of the
+/// worker, and returns when every worker has finished it.
+///
+void
+ThreadPool::run(std::function<void(int threadNum)> const & task) {
+
+  std::unique_lock<std::mutex> lock(mutex);
+
+  this->task = &task;
+
+  taskNum++;
+
+  numWorkersRunning = workers.size();
+
+  taskReady.notify_all();
+
+  taskDone.wait(lock, [this] { return numWorkersRunning == 0; });
+
+  this->task = NULL;
+}
+
+/// Waits for tasks and runs each one until the pool is destroyed.
+///
+void
+ThreadPool::workerThread(int threadNum) {
+
+  unsigned long long lastTaskNum = 0;
+
+  for (;;) {
+    std::function<void(int threadNum)> const * currentTask = NULL;
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+
+      taskReady.wait(lock, [this, lastTaskNum] { 
+	  return stopping || taskNum != lastTaskNum; 
+	});
+
+      if (stopping) {
+	return;
+      }
+
+      lastTaskNum = taskNum;
+
+      currentTask = task;
+    }
+
+    (*currentTask)(threadNum);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      numWorkersRunning--;
+    }
+
+    taskDone.notify_one();
+  }
+}
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// End:
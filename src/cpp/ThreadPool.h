@@ -0,0 +1,78 @@
+// ================================================================
+// 
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+// 
+// ================================================================
+
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+// ================================================================
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+
+// ================================================================
+
+/// A fixed set of worker threads that live for the whole run.  Each call to
+/// run() hands the same task to every worker and waits for all of them to
+/// finish, like launching and joining one std::thread per worker, but without
+/// the cost of creating threads each time.  Tasks must not call run().
+///
+class ThreadPool
+{
+public:
+  ThreadPool(int numThreads);
+  ~ThreadPool();
+
+  int getNumThreads() const;
+
+  void run(std::function<void(int threadNum)> const & task);
+
+private:
+  ThreadPool(ThreadPool const &) = delete;
+  ThreadPool & operator=(ThreadPool const &) = delete;
+
+  void workerThread(int threadNum);
+
+  std::vector<std::thread> workers;
+
+  std::mutex mutex;
+
+  std::condition_variable taskReady;
+  std::condition_variable taskDone;
+
+  std::function<void(int threadNum)> const * task;
+
+  unsigned long long taskNum;
+
+  int numWorkersRunning;
+
+  bool stopping;
+};
+
+// ================================================================
+
+#endif  // #ifndef THREAD_POOL_H_
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// mode: c++
+// End:
@@ -36,6 +36,9 @@
 /// Samples random points inside a bounding sphere and determines whether they
 /// hit an object, allowing for a given relative error in distance.
 ///
+/// Sample points are generated in bulk into a buffer and drawn from it as
+/// needed.
+///
 template <class T, 
   class RandomNumberGenerator, 
   class InsideOutsideTester,
@@ -50,13 +53,24 @@ class SamplerInterior {
   ~SamplerInterior();
 
   void sample(bool * hitObject,
-	      Vector3<T> * hitPoint);
+	      Vector3<T> * hitPoint,
+	      T * hitWeight,
+	      bool * keepHitPoint);
+
+  RandomNumberGenerator * getRandomNumberGenerator() const;
 
  private:
+  /// Number of points generated each time the buffer runs out.
+  ///
+  static const int numBufferedPoints = 64;
+
   RandomNumberGenerator * randomNumberGenerator;
   Sphere<T> const * boundingSphere;
   InsideOutsideTester const * insideOutsideTester;
   T fracErrorBound;
+
+  Vector3<T> bufferedPoints[numBufferedPoints];
+  int nextBufferedPoint;
 };
 
 template <class T, 
@@ -74,7 +88,8 @@ SamplerInterior<T,
   randomNumberGenerator(randomNumberGenerator), 
   boundingSphere(&boundingSphere),
   insideOutsideTester(&insideOutsideTester), 
-  fracErrorBound(fracErrorBound) {
+  fracErrorBound(fracErrorBound),
+  nextBufferedPoint(numBufferedPoints) {
 
 }
 
@@ -90,7 +105,24 @@ SamplerInterior<T,
 
 }
 
-/// Compute a random point and determine whether it hits the object.
+/// Returns the random number generator the samples are drawn with.
+///
+template <class T, 
+  class RandomNumberGenerator, 
+  class InsideOutsideTester,
+  class RandomBallPointGenerator>
+RandomNumberGenerator *
+SamplerInterior<T, 
+               RandomNumberGenerator, 
+               InsideOutsideTester, 
+               RandomBallPointGenerator>::
+  getRandomNumberGenerator() const {
+
+  return randomNumberGenerator;
+}
+
+/// Compute a random point and determine whether it hits the object.  Every
+/// sample has unit weight and every hit point is kept.
 ///
 template <class T, 
   class RandomNumberGenerator, 
@@ -102,16 +134,30 @@ SamplerInterior<T,
                InsideOutsideTester, 
                RandomBallPointGenerator>::
   sample(bool * hitObject,
-	 Vector3<T> * hitPoint) {
+	 Vector3<T> * hitPoint,
+	 T * hitWeight,
+	 bool * keepHitPoint) {
+
+  if (nextBufferedPoint == numBufferedPoints) {
+    RandomBallPointGenerator::generate(randomNumberGenerator, 
+				       *boundingSphere,
+				       numBufferedPoints,
+				       bufferedPoints);
+
+    nextBufferedPoint = 0;
+  }
 
-  Vector3<T> position = 
-    RandomBallPointGenerator::generate(randomNumberGenerator, *boundingSphere);
+  Vector3<T> position = bufferedPoints[nextBufferedPoint++];
 
   *hitObject = 
     insideOutsideTester->isInside(position,
 				  fracErrorBound);
 
   *hitPoint = position;
+
+  *hitWeight = 1;
+
+  *keepHitPoint = true;
 }
 
 #endif
@@ -0,0 +1,185 @@
+// ================================================================
+//
+// Disclaimer:  IMPORTANT:  This software was developed at the
+// National Institute of Standards and Technology by employees of the
+// Federal Government in the course of their official duties.
+// Pursuant to title 17 Section 105 of the United States Code this
+// software is not subject to copyright protection and is in the
+// public domain.  This is an experimental system.  NIST assumes no
+// responsibility whatsoever for its use by other parties, and makes
+// no guarantees, expressed or implied, about its quality,
+// reliability, or any other characteristic.  We would appreciate
+// acknowledgement if the software is used.  This software can be
+// redistributed and/or modified freely provided that any derivative
+// works bear some notice that they are derived from it, and any
+// modified versions bear some notice that they have been modified.
+//
+// ================================================================
+
+#ifndef SAMPLER_UNION_H
+#define SAMPLER_UNION_H
+
+#include <algorithm>
+#include <vector>
+
+#include "../Geometry/Sphere.h"
+#include "../Geometry/SphereVolumeTable.h"
+#include "../Geometry/Vector3.h"
+
+/// Samples random points inside an object represented as a union of spheres.
+/// A sphere is chosen with probability proportional to its volume, and a point
+/// is taken uniformly inside it.  Every sample hits the object, and is
+/// weighted by the inverse of the number of spheres containing it, so the
+/// mean weight times the summed volume of the spheres is an unbiased estimate
+/// of the volume of the union.
+///
+/// Points in overlapping regions are drawn more often than others, so hit
+/// points are thinned with probability equal to their weight before being
+/// kept as points distributed uniformly over the object.
+///
+template <class T, 
+  class RandomNumberGenerator, 
+  class InsideOutsideTester,
+  class RandomBallPointGenerator>
+class SamplerUnion {
+ public:
+  SamplerUnion(RandomNumberGenerator * randomNumberGenerator, 
+	       SphereVolumeTable<T> const & sphereVolumeTable, 
+	       InsideOutsideTester const & insideOutsideTester);
+
+  ~SamplerUnion();
+
+  void sample(bool * hitObject,
+	      Vector3<T> * hitPoint,
+	      T * hitWeight,
+	      bool * keepHitPoint);
+
+  RandomNumberGenerator * getRandomNumberGenerator() const;
+
+ private:
+  /// Number of points generated each time the buffer runs out.
+  ///
+  static const int numBufferedPoints = 64;
+
+  RandomNumberGenerator * randomNumberGenerator;
+  SphereVolumeTable<T> const * sphereVolumeTable;
+  InsideOutsideTester const * insideOutsideTester;
+
+  Vector3<T> bufferedPoints[numBufferedPoints];
+  double bufferedVolumeFractions[numBufferedPoints];
+  int nextBufferedPoint;
+
+  std::vector<Sphere<T> const *> candidateSpheres;
+};
+
+template <class T, 
+  class RandomNumberGenerator, 
+  class InsideOutsideTester,
+  class RandomBallPointGenerator>
+SamplerUnion<T, 
+             RandomNumberGenerator, 
+             InsideOutsideTester, 
+             RandomBallPointGenerator>::
+  SamplerUnion(RandomNumberGenerator * randomNumberGenerator, 
+	       SphereVolumeTable<T> const & sphereVolumeTable, 
+	       InsideOutsideTester const & insideOutsideTester) :
+  randomNumberGenerator(randomNumberGenerator), 
+  sphereVolumeTable(&sphereVolumeTable),
+  insideOutsideTester(&insideOutsideTester), 
+  nextBufferedPoint(numBufferedPoints),
+  candidateSpheres() {
+
+}
+
+template <class T, 
+  class RandomNumberGenerator, 
+  class InsideOutsideTester,
+  class RandomBallPointGenerator>
+SamplerUnion<T, 
+             RandomNumberGenerator, 
+             InsideOutsideTester, 
+             RandomBallPointGenerator>::
+  ~SamplerUnion() {
+
+}
+
+/// Returns the random number generator the samples are drawn with.
+///
+template <class T, 
+  class RandomNumberGenerator, 
+  class InsideOutsideTester,
+  class RandomBallPointGenerator>
+RandomNumberGenerator *
+SamplerUnion<T, 
+             RandomNumberGenerator, 
+             InsideOutsideTester, 
+             RandomBallPointGenerator>::
+  getRandomNumberGenerator() const {
+
+  return randomNumberGenerator;
+}
+
+/// Compute a random point inside the object, its weight, and whether it should
+/// be kept as a uniformly distributed hit point.
+///
+template <class T, 
+  class RandomNumberGenerator, 
+  class InsideOutsideTester,
+  class RandomBallPointGenerator>
+void 
+SamplerUnion<T, 
+             RandomNumberGenerator, 
+             InsideOutsideTester, 
+             RandomBallPointGenerator>::
+  sample(bool * hitObject,
+	 Vector3<T> * hitPoint,
+	 T * hitWeight,
+	 bool * keepHitPoint) {
+
+  if (nextBufferedPoint == numBufferedPoints) {
+    Sphere<T> unitBall(Vector3<T>(0, 0, 0), 1);
+
+    RandomBallPointGenerator::generate(randomNumberGenerator, 
+				       unitBall,
+				       numBufferedPoints,
+				       bufferedPoints);
+
+    randomNumberGenerator->fillRandIn01(bufferedVolumeFractions,
+					numBufferedPoints);
+
+    nextBufferedPoint = 0;
+  }
+
+  Sphere<T> const & sphere = 
+    sphereVolumeTable->findSphere(bufferedVolumeFractions[nextBufferedPoint]);
+
+  Vector3<T> position = 
+    sphere.getCenter() + 
+    bufferedPoints[nextBufferedPoint] * sphere.getRadius();
+
+  nextBufferedPoint++;
+
+  //the sampled sphere may be missed due to rounding at its surface
+  int numContaining = 
+    std::max(1, 
+	     insideOutsideTester->countContainingSpheres(position,
+							 &candidateSpheres));
+
+  *hitObject = true;
+
+  *hitPoint = position;
+
+  *hitWeight = (T)1 / numContaining;
+
+  *keepHitPoint = 
+    (numContaining == 1) ||
+    (randomNumberGenerator->getRandIn01() < *hitWeight);
+}
+
+#endif
+
+// ================================================================
+
+// Local Variables:
+// time-stamp-line-limit: 30
+// End:
@@ -36,6 +36,9 @@
 /// Performs random walks starting on a bounding sphere and determines whether 
 /// they hit an object, allowing for a given relative error in distance.
 ///
+/// The uniformly distributed directions used for the start point and for each
+/// step are generated in bulk into a buffer and drawn from it as needed.
+///
 template <class T, 
   class RandomNumberGenerator, 
   class NearestSurfacePointFinder,
@@ -51,16 +54,27 @@ class WalkerExterior {
 
   ~WalkerExterior();
 
-  void walk(bool * hitObject, int * numSteps,
+  void walk(bool * hitObject, int * numSteps, int * numGridSteps,
 	    Vector3<T> * startPoint, Vector3<T> * endPoint, 
 	    Vector3<T> * normal);
 
  private:
+  /// Number of directions generated each time the buffer runs out.
+  ///
+  static const int numBufferedDirections = 64;
+
+  Vector3<T> getRandomDirection();
+
   RandomNumberGenerator * randomNumberGenerator;
   Sphere<T> const * boundingSphere;
   NearestSurfacePointFinder const * nearestSurfacePointFinder;
   T fracErrorBound;
   T shellThickness;
+
+  typename NearestSurfacePointFinder::NeighborList neighborList;
+
+  Vector3<T> bufferedDirections[numBufferedDirections];
+  int nextBufferedDirection;
 };
 
 template <class T, 
@@ -82,7 +96,9 @@ WalkerExterior<T,
   boundingSphere(&boundingSphere),
   nearestSurfacePointFinder(&nearestSurfacePointFinder), 
   fracErrorBound(fracErrorBound),
-  shellThickness(shellThickness) {
+  shellThickness(shellThickness),
+  neighborList(),
+  nextBufferedDirection(numBufferedDirections) {
 
 }
 
@@ -102,7 +118,8 @@ WalkerExterior<T,
 
 /// Perform a random walk and determine whether it hits the object, the number
 /// of steps it took, its start and end points, and the surface normal of its
-/// hit point.
+/// hit point.  Also determines how many of the steps were sized using the
+/// distance grid instead of a nearest point search.
 ///
 template <class T, 
   class RandomNumberGenerator, 
@@ -115,42 +132,48 @@ WalkerExterior<T,
                NearestSurfacePointFinder, 
                RandomSpherePointGenerator,
                BiasedSpherePointGenerator>::
-  walk(bool * hitObject, int * numSteps,
+  walk(bool * hitObject, int * numSteps, int * numGridSteps,
        Vector3<T> * startPoint, Vector3<T> * endPoint,
        Vector3<T> * normal) {
 
-  *hitObject = false;
-  *numSteps  = 0;
+  *hitObject    = false;
+  *numSteps     = 0;
+  *numGridSteps = 0;
 
   Vector3<T> position = 
-    RandomSpherePointGenerator::generate(randomNumberGenerator, 
-					 *boundingSphere);
+    boundingSphere->getCenter() + 
+    getRandomDirection() * boundingSphere->getRadius();
 
   *startPoint = position;
 
   for (;;) {
 
-    T minDistance = 0;
-  
-    nearestSurfacePointFinder->findNearestPoint(position,
-						fracErrorBound, 
-						normal,
-						&minDistance);
-
-    if (minDistance < shellThickness) {
-      //walker is absorbed
+    //far from the surface, a lower bound on the distance is a safe step size
+    T minDistance = 
+      nearestSurfacePointFinder->getDistanceLowerBound(position);
 
-      *endPoint  = position;
-      *hitObject = true;
-      return;
+    if (minDistance > 0) {
+      (*numGridSteps)++;
+    }
+    else {
+      nearestSurfacePointFinder->findNearestPoint(position,
+						  fracErrorBound, 
+						  &neighborList,
+						  normal,
+						  &minDistance);
+
+      if (minDistance < shellThickness) {
+	//walker is absorbed
+
+	*endPoint  = position;
+	*hitObject = true;
+	return;
+      }
     }
 
     (*numSteps)++;
 
-    Sphere<T> stepSphere(position, minDistance);
-
-    position = RandomSpherePointGenerator::generate(randomNumberGenerator, 
-						    stepSphere);
+    position += getRandomDirection() * minDistance;
 
     T centerDistSqr = 
       (position - boundingSphere->getCenter()).getMagnitudeSqr();
@@ -178,6 +201,37 @@ WalkerExterior<T,
   }
 }
 
+/// Returns the next uniformly distributed unit vector from the buffer,
+/// refilling it first if it is empty.
+///
+template <class T, 
+  class RandomNumberGenerator, 
+  class NearestSurfacePointFinder,
+  class RandomSpherePointGenerator,
+  class BiasedSpherePointGenerator>
+inline
+Vector3<T> 
+WalkerExterior<T, 
+               RandomNumberGenerator, 
+               NearestSurfacePointFinder, 
+               RandomSpherePointGenerator,
+               BiasedSpherePointGenerator>::
+  getRandomDirection() {
+
+  if (nextBufferedDirection == numBufferedDirections) {
+    Sphere<T> unitSphere(Vector3<T>(0, 0, 0), 1);
+
+    RandomSpherePointGenerator::generate(randomNumberGenerator,
+					 unitSphere,
+					 numBufferedDirections,
+					 bufferedDirections);
+
+    nextBufferedDirection = 0;
+  }
+
+  return bufferedDirections[nextBufferedDirection++];
+}
+
 #endif
 
 // ================================================================
@@ -43,14 +43,29 @@ const char *gengetopt_args_info_full_help[] = {
   "      --max-rsd-capacitance=DOUBLE\n                                Perform walk-on-spheres walks until the\n                                  relative standard deviation of the\n                                  capacitance drops below this value.  Relative\n                                  standard deviation is defined as\n                                  (Standard_Deviation/Mean)*100%",
   "      --max-rsd-polarizability=DOUBLE\n                                Perform walk-on-spheres walks until the\n                                  relative standard deviation of the mean\n                                  electric polarizability drops below this\n                                  value.  Relative standard deviation is\n                                  defined as (Standard_Deviation/Mean)*100%",
   "      --max-rsd-volume=DOUBLE   Take interior samples until the relative\n                                  standard deviation of volume drops below this\n                                  value.  Relative standard deviation is\n                                  defined as (Standard_Deviation/Mean)*100%",
+  "      --max-run-time=DOUBLE     Stop walk-on-spheres walks and interior samples\n                                  early if needed to finish within this many\n                                  seconds of wall-clock time, and report the\n                                  results and errors achieved so far.  Walks\n                                  and samples are performed in rounds sized\n                                  from their measured rate so that the run ends\n                                  close to this time.  Combine with small\n                                  max-rsd values to get the smallest errors\n                                  achievable in the time",
+  "      --exterior-run-time-fraction=DOUBLE\n                                Fraction of the maximum run time available to\n                                  walk-on-spheres walks when interior samples\n                                  are taken after them.  Time the walks leave\n                                  unused is available to the interior samples\n                                  (default=`0.5')",
   "      --min-num-walks=LONGLONG  Minimum number of walk-on-spheres walks to\n                                  perform when using max-rsd stopping\n                                  conditions  (default=`1000')",
   "      --min-num-interior-samples=LONGLONG\n                                Minimum number of interior samples to take when\n                                  using max-rsd stopping conditions\n                                  (default=`10000')",
   "      --compute-form            Compute form factor",
+  "      --max-form-factor-points=LONGLONG\n                                Compute form factors from at most this many\n                                  interior sample points hit, chosen uniformly\n                                  at random from all of them, so memory does\n                                  not grow with the number of samples.  The\n                                  volume and gyration tensor still use every\n                                  sample",
+  "      --max-sd-form-factors=DOUBLE\n                                Estimate form factors from random pairs of\n                                  interior sample points, rather than all\n                                  pairs, taking pairs until the standard\n                                  deviation of every form factor drops below\n                                  this value.  Form factors are between -0.22\n                                  and 1.  All pairs are used if that would take\n                                  fewer",
+  "      --histogram-form-factors  Compute form factors from a fine histogram of\n                                  the distances between pairs of interior\n                                  sample points, rather than evaluating the\n                                  Debye formula for every pair.  The bin width\n                                  is chosen to keep the binning error well\n                                  below the sampling error of the form factors",
   "      --num-threads=INT         Number of threads to use  (default=Number of\n                                  logical cores)",
   "      --seed=INT                Seed for the random number generator\n                                  (default=Randomly set)",
   "      --frac-error-bound=DOUBLE Fractional error bound for nearest neighbor\n                                  search  (default=`0')",
+  "      --distance-grid-size=INT  Number of cells along each side of a grid of\n                                  precomputed lower bounds on the distance to\n                                  the object, used to take large\n                                  walk-on-spheres steps far from the surface\n                                  (default=No grid)",
+  "      --prune-buried-spheres    Leave spheres whose surface is entirely inside\n                                  other spheres out of the data structure used\n                                  for walk-on-spheres",
+  "      --minimal-launch-sphere   Launch walk-on-spheres walks and take interior\n                                  samples from a nearly minimal sphere\n                                  enclosing the object, rather than the sphere\n                                  enclosing its axis-aligned bounding box",
+  "      --concurrent-interior-sampling\n                                Take interior samples at the same time as\n                                  walk-on-spheres walks, on the same threads.\n                                  Each keeps its own stopping condition.  The\n                                  time for both is reported as exterior walk\n                                  time",
+  "      --expected-charges        Record the expected charge of each walk that\n                                  hits the object, computed from its launch\n                                  point, rather than a randomly assigned\n                                  charge.  Reduces the variance of the\n                                  polarizability",
+  "      --compensated-sums        Accumulate counts and compensated sums and sums\n                                  of squares of walk and sample results,\n                                  computing variances only when results are\n                                  combined, rather than updating running\n                                  variances after every walk and sample.\n                                  Misses only increment a count",
+  "      --union-interior-sampling Take interior samples uniformly inside spheres\n                                  of the object chosen at random in proportion\n                                  to their volume, weighting each sample by the\n                                  inverse of the number of spheres containing\n                                  it, rather than inside the launch sphere.\n                                  Converges much faster for objects that fill\n                                  little of their launch sphere",
+  "      --deterministic-blocks=INT\n                                Divide walk-on-spheres walks and interior\n                                  samples into this many blocks, each with its\n                                  own random number stream, and combine the\n                                  results of the blocks in a fixed order, so\n                                  that results for a given seed are identical\n                                  for any number of threads or MPI processes\n                                  (default=Not deterministic)",
   "      --surface-points-file=STRING\n                                Name of file for writing the surface points\n                                  from Walk-on-Spheres",
   "      --interior-points-file=STRING\n                                Name of file for writing the interior sample\n                                  points",
+  "      --stream-points-files     Write the surface and interior points files in\n                                  a binary format while walks and samples are\n                                  performed, from small per-thread buffers,\n                                  rather than keeping every point in memory and\n                                  writing text at the end.  Files whose names\n                                  end in .gz are compressed.  With MPI each\n                                  process writes its own file, named with its\n                                  rank.  Convert the files to text with\n                                  zeno-points-to-text",
+  "      --index-cache-dir=STRING  Directory in which to cache the parsed input\n                                  file and spatial data structure, so later\n                                  runs with the same input file and error bound\n                                  can skip parsing and preprocessing",
   "      --print-counts            Print statistics related to counts of hit\n                                  points",
   "      --print-benchmarks        Print detailed RAM and timing information",
     0
@@ -73,15 +88,30 @@ init_help_array(void)
   gengetopt_args_info_help[11] = gengetopt_args_info_full_help[11];
   gengetopt_args_info_help[12] = gengetopt_args_info_full_help[12];
   gengetopt_args_info_help[13] = gengetopt_args_info_full_help[13];
-  gengetopt_args_info_help[14] = gengetopt_args_info_full_help[15];
-  gengetopt_args_info_help[15] = gengetopt_args_info_full_help[16];
-  gengetopt_args_info_help[16] = gengetopt_args_info_full_help[17];
-  gengetopt_args_info_help[17] = gengetopt_args_info_full_help[18];
-  gengetopt_args_info_help[18] = 0; 
+  gengetopt_args_info_help[14] = gengetopt_args_info_full_help[14];
+  gengetopt_args_info_help[15] = gengetopt_args_info_full_help[15];
+  gengetopt_args_info_help[16] = gengetopt_args_info_full_help[16];
+  gengetopt_args_info_help[17] = gengetopt_args_info_full_help[17];
+  gengetopt_args_info_help[18] = gengetopt_args_info_full_help[18];
+  gengetopt_args_info_help[19] = gengetopt_args_info_full_help[20];
+  gengetopt_args_info_help[20] = gengetopt_args_info_full_help[21];
+  gengetopt_args_info_help[21] = gengetopt_args_info_full_help[22];
+  gengetopt_args_info_help[22] = gengetopt_args_info_full_help[23];
+  gengetopt_args_info_help[23] = gengetopt_args_info_full_help[24];
+  gengetopt_args_info_help[24] = gengetopt_args_info_full_help[25];
+  gengetopt_args_info_help[25] = gengetopt_args_info_full_help[26];
+  gengetopt_args_info_help[26] = gengetopt_args_info_full_help[27];
+  gengetopt_args_info_help[27] = gengetopt_args_info_full_help[28];
+  gengetopt_args_info_help[28] = gengetopt_args_info_full_help[29];
+  gengetopt_args_info_help[29] = gengetopt_args_info_full_help[30];
+  gengetopt_args_info_help[30] = gengetopt_args_info_full_help[31];
+  gengetopt_args_info_help[31] = gengetopt_args_info_full_help[32];
+  gengetopt_args_info_help[32] = gengetopt_args_info_full_help[33];
+  gengetopt_args_info_help[33] = 0; 
   
 }
 
-const char *gengetopt_args_info_help[19];
+const char *gengetopt_args_info_help[34];
 
 typedef enum {ARG_NO
   , ARG_STRING
@@ -117,14 +147,29 @@ void clear_given (struct gengetopt_args_info *args_info)
   args_info->max_rsd_capacitance_given = 0 ;
   args_info->max_rsd_polarizability_given = 0 ;
   args_info->max_rsd_volume_given = 0 ;
+  args_info->max_run_time_given = 0 ;
+  args_info->exterior_run_time_fraction_given = 0 ;
   args_info->min_num_walks_given = 0 ;
   args_info->min_num_interior_samples_given = 0 ;
   args_info->compute_form_given = 0 ;
+  args_info->max_form_factor_points_given = 0 ;
+  args_info->max_sd_form_factors_given = 0 ;
+  args_info->histogram_form_factors_given = 0 ;
   args_info->num_threads_given = 0 ;
   args_info->seed_given = 0 ;
   args_info->frac_error_bound_given = 0 ;
+  args_info->distance_grid_size_given = 0 ;
+  args_info->prune_buried_spheres_given = 0 ;
+  args_info->minimal_launch_sphere_given = 0 ;
+  args_info->concurrent_interior_sampling_given = 0 ;
+  args_info->expected_charges_given = 0 ;
+  args_info->compensated_sums_given = 0 ;
+  args_info->union_interior_sampling_given = 0 ;
+  args_info->deterministic_blocks_given = 0 ;
   args_info->surface_points_file_given = 0 ;
   args_info->interior_points_file_given = 0 ;
+  args_info->stream_points_files_given = 0 ;
+  args_info->index_cache_dir_given = 0 ;
   args_info->print_counts_given = 0 ;
   args_info->print_benchmarks_given = 0 ;
 }
@@ -140,18 +185,27 @@ void clear_args (struct gengetopt_args_info *args_info)
   args_info->max_rsd_capacitance_orig = NULL;
   args_info->max_rsd_polarizability_orig = NULL;
   args_info->max_rsd_volume_orig = NULL;
+  args_info->max_run_time_orig = NULL;
+  args_info->exterior_run_time_fraction_arg = 0.5;
+  args_info->exterior_run_time_fraction_orig = NULL;
   args_info->min_num_walks_arg = 1000;
   args_info->min_num_walks_orig = NULL;
   args_info->min_num_interior_samples_arg = 10000;
   args_info->min_num_interior_samples_orig = NULL;
+  args_info->max_form_factor_points_orig = NULL;
+  args_info->max_sd_form_factors_orig = NULL;
   args_info->num_threads_orig = NULL;
   args_info->seed_orig = NULL;
   args_info->frac_error_bound_arg = 0;
   args_info->frac_error_bound_orig = NULL;
+  args_info->distance_grid_size_orig = NULL;
+  args_info->deterministic_blocks_orig = NULL;
   args_info->surface_points_file_arg = NULL;
   args_info->surface_points_file_orig = NULL;
   args_info->interior_points_file_arg = NULL;
   args_info->interior_points_file_orig = NULL;
+  args_info->index_cache_dir_arg = NULL;
+  args_info->index_cache_dir_orig = NULL;
   
 }
 
@@ -169,16 +223,31 @@ void init_args_info(struct gengetopt_args_info *args_info)
   args_info->max_rsd_capacitance_help = gengetopt_args_info_full_help[6] ;
   args_info->max_rsd_polarizability_help = gengetopt_args_info_full_help[7] ;
   args_info->max_rsd_volume_help = gengetopt_args_info_full_help[8] ;
-  args_info->min_num_walks_help = gengetopt_args_info_full_help[9] ;
-  args_info->min_num_interior_samples_help = gengetopt_args_info_full_help[10] ;
-  args_info->compute_form_help = gengetopt_args_info_full_help[11] ;
-  args_info->num_threads_help = gengetopt_args_info_full_help[12] ;
-  args_info->seed_help = gengetopt_args_info_full_help[13] ;
-  args_info->frac_error_bound_help = gengetopt_args_info_full_help[14] ;
-  args_info->surface_points_file_help = gengetopt_args_info_full_help[15] ;
-  args_info->interior_points_file_help = gengetopt_args_info_full_help[16] ;
-  args_info->print_counts_help = gengetopt_args_info_full_help[17] ;
-  args_info->print_benchmarks_help = gengetopt_args_info_full_help[18] ;
+  args_info->max_run_time_help = gengetopt_args_info_full_help[9] ;
+  args_info->exterior_run_time_fraction_help = gengetopt_args_info_full_help[10] ;
+  args_info->min_num_walks_help = gengetopt_args_info_full_help[11] ;
+  args_info->min_num_interior_samples_help = gengetopt_args_info_full_help[12] ;
+  args_info->compute_form_help = gengetopt_args_info_full_help[13] ;
+  args_info->max_form_factor_points_help = gengetopt_args_info_full_help[14] ;
+  args_info->max_sd_form_factors_help = gengetopt_args_info_full_help[15] ;
+  args_info->histogram_form_factors_help = gengetopt_args_info_full_help[16] ;
+  args_info->num_threads_help = gengetopt_args_info_full_help[17] ;
+  args_info->seed_help = gengetopt_args_info_full_help[18] ;
+  args_info->frac_error_bound_help = gengetopt_args_info_full_help[19] ;
+  args_info->distance_grid_size_help = gengetopt_args_info_full_help[20] ;
+  args_info->prune_buried_spheres_help = gengetopt_args_info_full_help[21] ;
+  args_info->minimal_launch_sphere_help = gengetopt_args_info_full_help[22] ;
+  args_info->concurrent_interior_sampling_help = gengetopt_args_info_full_help[23] ;
+  args_info->expected_charges_help = gengetopt_args_info_full_help[24] ;
+  args_info->compensated_sums_help = gengetopt_args_info_full_help[25] ;
+  args_info->union_interior_sampling_help = gengetopt_args_info_full_help[26] ;
+  args_info->deterministic_blocks_help = gengetopt_args_info_full_help[27] ;
+  args_info->surface_points_file_help = gengetopt_args_info_full_help[28] ;
+  args_info->interior_points_file_help = gengetopt_args_info_full_help[29] ;
+  args_info->stream_points_files_help = gengetopt_args_info_full_help[30] ;
+  args_info->index_cache_dir_help = gengetopt_args_info_full_help[31] ;
+  args_info->print_counts_help = gengetopt_args_info_full_help[32] ;
+  args_info->print_benchmarks_help = gengetopt_args_info_full_help[33] ;
   
 }
 
@@ -278,15 +347,23 @@ cmdline_parser_release (struct gengetopt_args_info *args_info)
   free_string_field (&(args_info->max_rsd_capacitance_orig));
   free_string_field (&(args_info->max_rsd_polarizability_orig));
   free_string_field (&(args_info->max_rsd_volume_orig));
+  free_string_field (&(args_info->max_run_time_orig));
+  free_string_field (&(args_info->exterior_run_time_fraction_orig));
   free_string_field (&(args_info->min_num_walks_orig));
   free_string_field (&(args_info->min_num_interior_samples_orig));
+  free_string_field (&(args_info->max_form_factor_points_orig));
+  free_string_field (&(args_info->max_sd_form_factors_orig));
   free_string_field (&(args_info->num_threads_orig));
   free_string_field (&(args_info->seed_orig));
   free_string_field (&(args_info->frac_error_bound_orig));
+  free_string_field (&(args_info->distance_grid_size_orig));
+  free_string_field (&(args_info->deterministic_blocks_orig));
   free_string_field (&(args_info->surface_points_file_arg));
   free_string_field (&(args_info->surface_points_file_orig));
   free_string_field (&(args_info->interior_points_file_arg));
   free_string_field (&(args_info->interior_points_file_orig));
+  free_string_field (&(args_info->index_cache_dir_arg));
+  free_string_field (&(args_info->index_cache_dir_orig));
   
   
 
@@ -335,22 +412,52 @@ cmdline_parser_dump(FILE *outfile, struct gengetopt_args_info *args_info)
     write_into_file(outfile, "max-rsd-polarizability", args_info->max_rsd_polarizability_orig, 0);
   if (args_info->max_rsd_volume_given)
     write_into_file(outfile, "max-rsd-volume", args_info->max_rsd_volume_orig, 0);
+  if (args_info->max_run_time_given)
+    write_into_file(outfile, "max-run-time", args_info->max_run_time_orig, 0);
+  if (args_info->exterior_run_time_fraction_given)
+    write_into_file(outfile, "exterior-run-time-fraction", args_info->exterior_run_time_fraction_orig, 0);
   if (args_info->min_num_walks_given)
     write_into_file(outfile, "min-num-walks", args_info->min_num_walks_orig, 0);
   if (args_info->min_num_interior_samples_given)
     write_into_file(outfile, "min-num-interior-samples", args_info->min_num_interior_samples_orig, 0);
   if (args_info->compute_form_given)
     write_into_file(outfile, "compute-form", 0, 0 );
+  if (args_info->max_form_factor_points_given)
+    write_into_file(outfile, "max-form-factor-points", args_info->max_form_factor_points_orig, 0);
+  if (args_info->max_sd_form_factors_given)
+    write_into_file(outfile, "max-sd-form-factors", args_info->max_sd_form_factors_orig, 0);
+  if (args_info->histogram_form_factors_given)
+    write_into_file(outfile, "histogram-form-factors", 0, 0 );
   if (args_info->num_threads_given)
     write_into_file(outfile, "num-threads", args_info->num_threads_orig, 0);
   if (args_info->seed_given)
     write_into_file(outfile, "seed", args_info->seed_orig, 0);
   if (args_info->frac_error_bound_given)
     write_into_file(outfile, "frac-error-bound", args_info->frac_error_bound_orig, 0);
+  if (args_info->distance_grid_size_given)
+    write_into_file(outfile, "distance-grid-size", args_info->distance_grid_size_orig, 0);
+  if (args_info->prune_buried_spheres_given)
+    write_into_file(outfile, "prune-buried-spheres", 0, 0 );
+  if (args_info->minimal_launch_sphere_given)
+    write_into_file(outfile, "minimal-launch-sphere", 0, 0 );
+  if (args_info->concurrent_interior_sampling_given)
+    write_into_file(outfile, "concurrent-interior-sampling", 0, 0 );
+  if (args_info->expected_charges_given)
+    write_into_file(outfile, "expected-charges", 0, 0 );
+  if (args_info->compensated_sums_given)
+    write_into_file(outfile, "compensated-sums", 0, 0 );
+  if (args_info->union_interior_sampling_given)
+    write_into_file(outfile, "union-interior-sampling", 0, 0 );
+  if (args_info->deterministic_blocks_given)
+    write_into_file(outfile, "deterministic-blocks", args_info->deterministic_blocks_orig, 0);
   if (args_info->surface_points_file_given)
     write_into_file(outfile, "surface-points-file", args_info->surface_points_file_orig, 0);
   if (args_info->interior_points_file_given)
     write_into_file(outfile, "interior-points-file", args_info->interior_points_file_orig, 0);
+  if (args_info->stream_points_files_given)
+    write_into_file(outfile, "stream-points-files", 0, 0 );
+  if (args_info->index_cache_dir_given)
+    write_into_file(outfile, "index-cache-dir", args_info->index_cache_dir_orig, 0);
   if (args_info->print_counts_given)
     write_into_file(outfile, "print-counts", 0, 0 );
   if (args_info->print_benchmarks_given)
@@ -654,14 +761,29 @@ cmdline_parser_internal (
         { "max-rsd-capacitance",	1, NULL, 0 },
         { "max-rsd-polarizability",	1, NULL, 0 },
         { "max-rsd-volume",	1, NULL, 0 },
+        { "max-run-time",	1, NULL, 0 },
+        { "exterior-run-time-fraction",	1, NULL, 0 },
         { "min-num-walks",	1, NULL, 0 },
         { "min-num-interior-samples",	1, NULL, 0 },
         { "compute-form",	0, NULL, 0 },
+        { "max-form-factor-points",	1, NULL, 0 },
+        { "max-sd-form-factors",	1, NULL, 0 },
+        { "histogram-form-factors",	0, NULL, 0 },
         { "num-threads",	1, NULL, 0 },
         { "seed",	1, NULL, 0 },
         { "frac-error-bound",	1, NULL, 0 },
+        { "distance-grid-size",	1, NULL, 0 },
+        { "prune-buried-spheres",	0, NULL, 0 },
+        { "minimal-launch-sphere",	0, NULL, 0 },
+        { "concurrent-interior-sampling",	0, NULL, 0 },
+        { "expected-charges",	0, NULL, 0 },
+        { "compensated-sums",	0, NULL, 0 },
+        { "union-interior-sampling",	0, NULL, 0 },
+        { "deterministic-blocks",	1, NULL, 0 },
         { "surface-points-file",	1, NULL, 0 },
         { "interior-points-file",	1, NULL, 0 },
+        { "stream-points-files",	0, NULL, 0 },
+        { "index-cache-dir",	1, NULL, 0 },
         { "print-counts",	0, NULL, 0 },
         { "print-benchmarks",	0, NULL, 0 },
         { 0,  0, 0, 0 }
@@ -772,6 +894,34 @@ cmdline_parser_internal (
                 additional_error))
               goto failure;
           
+          }
+          /* Stop walk-on-spheres walks and interior samples early if needed to finish within this many seconds of wall-clock time, and report the results and errors achieved so far.  Walks and samples are performed in rounds sized from their measured rate so that the run ends close to this time.  Combine with small max-rsd values to get the smallest errors achievable in the time.  */
+          else if (strcmp (long_options[option_index].name, "max-run-time") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->max_run_time_arg), 
+                 &(args_info->max_run_time_orig), &(args_info->max_run_time_given),
+                &(local_args_info.max_run_time_given), optarg, 0, 0, ARG_DOUBLE,
+                check_ambiguity, override, 0, 0,
+                "max-run-time", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Fraction of the maximum run time available to walk-on-spheres walks when interior samples are taken after them.  Time the walks leave unused is available to the interior samples.  */
+          else if (strcmp (long_options[option_index].name, "exterior-run-time-fraction") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->exterior_run_time_fraction_arg), 
+                 &(args_info->exterior_run_time_fraction_orig), &(args_info->exterior_run_time_fraction_given),
+                &(local_args_info.exterior_run_time_fraction_given), optarg, 0, "0.5", ARG_DOUBLE,
+                check_ambiguity, override, 0, 0,
+                "exterior-run-time-fraction", '-',
+                additional_error))
+              goto failure;
+          
           }
           /* Minimum number of walk-on-spheres walks to perform when using max-rsd stopping conditions.  */
           else if (strcmp (long_options[option_index].name, "min-num-walks") == 0)
@@ -814,6 +964,48 @@ cmdline_parser_internal (
                 additional_error))
               goto failure;
           
+          }
+          /* Compute form factors from at most this many interior sample points hit, chosen uniformly at random from all of them, so memory does not grow with the number of samples.  The volume and gyration tensor still use every sample.  */
+          else if (strcmp (long_options[option_index].name, "max-form-factor-points") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->max_form_factor_points_arg), 
+                 &(args_info->max_form_factor_points_orig), &(args_info->max_form_factor_points_given),
+                &(local_args_info.max_form_factor_points_given), optarg, 0, 0, ARG_LONGLONG,
+                check_ambiguity, override, 0, 0,
+                "max-form-factor-points", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Estimate form factors from random pairs of interior sample points, rather than all pairs, taking pairs until the standard deviation of every form factor drops below this value.  Form factors are between -0.22 and 1.  All pairs are used if that would take fewer.  */
+          else if (strcmp (long_options[option_index].name, "max-sd-form-factors") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->max_sd_form_factors_arg), 
+                 &(args_info->max_sd_form_factors_orig), &(args_info->max_sd_form_factors_given),
+                &(local_args_info.max_sd_form_factors_given), optarg, 0, 0, ARG_DOUBLE,
+                check_ambiguity, override, 0, 0,
+                "max-sd-form-factors", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Compute form factors from a fine histogram of the distances between pairs of interior sample points, rather than evaluating the Debye formula for every pair.  The bin width is chosen to keep the binning error well below the sampling error of the form factors.  */
+          else if (strcmp (long_options[option_index].name, "histogram-form-factors") == 0)
+          {
+          
+          
+            if (update_arg( 0 , 
+                 0 , &(args_info->histogram_form_factors_given),
+                &(local_args_info.histogram_form_factors_given), optarg, 0, 0, ARG_NO,
+                check_ambiguity, override, 0, 0,
+                "histogram-form-factors", '-',
+                additional_error))
+              goto failure;
+          
           }
           /* Number of threads to use  (default=Number of logical cores).  */
           else if (strcmp (long_options[option_index].name, "num-threads") == 0)
@@ -856,6 +1048,118 @@ cmdline_parser_internal (
                 additional_error))
               goto failure;
           
+          }
+          /* Number of cells along each side of a grid of precomputed lower bounds on the distance to the object, used to take large walk-on-spheres steps far from the surface  (default=No grid).  */
+          else if (strcmp (long_options[option_index].name, "distance-grid-size") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->distance_grid_size_arg), 
+                 &(args_info->distance_grid_size_orig), &(args_info->distance_grid_size_given),
+                &(local_args_info.distance_grid_size_given), optarg, 0, 0, ARG_INT,
+                check_ambiguity, override, 0, 0,
+                "distance-grid-size", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Leave spheres whose surface is entirely inside other spheres out of the data structure used for walk-on-spheres.  */
+          else if (strcmp (long_options[option_index].name, "prune-buried-spheres") == 0)
+          {
+          
+          
+            if (update_arg( 0 , 
+                 0 , &(args_info->prune_buried_spheres_given),
+                &(local_args_info.prune_buried_spheres_given), optarg, 0, 0, ARG_NO,
+                check_ambiguity, override, 0, 0,
+                "prune-buried-spheres", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Launch walk-on-spheres walks and take interior samples from a nearly minimal sphere enclosing the object, rather than the sphere enclosing its axis-aligned bounding box.  */
+          else if (strcmp (long_options[option_index].name, "minimal-launch-sphere") == 0)
+          {
+          
+          
+            if (update_arg( 0 , 
+                 0 , &(args_info->minimal_launch_sphere_given),
+                &(local_args_info.minimal_launch_sphere_given), optarg, 0, 0, ARG_NO,
+                check_ambiguity, override, 0, 0,
+                "minimal-launch-sphere", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Take interior samples at the same time as walk-on-spheres walks, on the same threads.  Each keeps its own stopping condition.  The time for both is reported as exterior walk time.  */
+          else if (strcmp (long_options[option_index].name, "concurrent-interior-sampling") == 0)
+          {
+          
+          
+            if (update_arg( 0 , 
+                 0 , &(args_info->concurrent_interior_sampling_given),
+                &(local_args_info.concurrent_interior_sampling_given), optarg, 0, 0, ARG_NO,
+                check_ambiguity, override, 0, 0,
+                "concurrent-interior-sampling", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Record the expected charge of each walk that hits the object, computed from its launch point, rather than a randomly assigned charge.  Reduces the variance of the polarizability.  */
+          else if (strcmp (long_options[option_index].name, "expected-charges") == 0)
+          {
+          
+          
+            if (update_arg( 0 , 
+                 0 , &(args_info->expected_charges_given),
+                &(local_args_info.expected_charges_given), optarg, 0, 0, ARG_NO,
+                check_ambiguity, override, 0, 0,
+                "expected-charges", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Accumulate counts and compensated sums and sums of squares of walk and sample results, computing variances only when results are combined, rather than updating running variances after every walk and sample.  Misses only increment a count.  */
+          else if (strcmp (long_options[option_index].name, "compensated-sums") == 0)
+          {
+          
+          
+            if (update_arg( 0 , 
+                 0 , &(args_info->compensated_sums_given),
+                &(local_args_info.compensated_sums_given), optarg, 0, 0, ARG_NO,
+                check_ambiguity, override, 0, 0,
+                "compensated-sums", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Take interior samples uniformly inside spheres of the object chosen at random in proportion to their volume, weighting each sample by the inverse of the number of spheres containing it, rather than inside the launch sphere.  Converges much faster for objects that fill little of their launch sphere.  */
+          else if (strcmp (long_options[option_index].name, "union-interior-sampling") == 0)
+          {
+          
+          
+            if (update_arg( 0 , 
+                 0 , &(args_info->union_interior_sampling_given),
+                &(local_args_info.union_interior_sampling_given), optarg, 0, 0, ARG_NO,
+                check_ambiguity, override, 0, 0,
+                "union-interior-sampling", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Divide walk-on-spheres walks and interior samples into this many blocks, each with its own random number stream, and combine the results of the blocks in a fixed order, so that results for a given seed are identical for any number of threads or MPI processes  (default=Not deterministic).  */
+          else if (strcmp (long_options[option_index].name, "deterministic-blocks") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->deterministic_blocks_arg), 
+                 &(args_info->deterministic_blocks_orig), &(args_info->deterministic_blocks_given),
+                &(local_args_info.deterministic_blocks_given), optarg, 0, 0, ARG_INT,
+                check_ambiguity, override, 0, 0,
+                "deterministic-blocks", '-',
+                additional_error))
+              goto failure;
+          
           }
           /* Name of file for writing the surface points from Walk-on-Spheres.  */
           else if (strcmp (long_options[option_index].name, "surface-points-file") == 0)
@@ -884,6 +1188,34 @@ cmdline_parser_internal (
                 additional_error))
               goto failure;
           
+          }
+          /* Write the surface and interior points files in a binary format while walks and samples are performed, from small per-thread buffers, rather than keeping every point in memory and writing text at the end.  Files whose names end in .gz are compressed.  With MPI each process writes its own file, named with its rank.  Convert the files to text with zeno-points-to-text.  */
+          else if (strcmp (long_options[option_index].name, "stream-points-files") == 0)
+          {
+          
+          
+            if (update_arg( 0 , 
+                 0 , &(args_info->stream_points_files_given),
+                &(local_args_info.stream_points_files_given), optarg, 0, 0, ARG_NO,
+                check_ambiguity, override, 0, 0,
+                "stream-points-files", '-',
+                additional_error))
+              goto failure;
+          
+          }
+          /* Directory in which to cache the parsed input file and spatial data structure, so later runs with the same input file and error bound can skip parsing and preprocessing.  */
+          else if (strcmp (long_options[option_index].name, "index-cache-dir") == 0)
+          {
+          
+          
+            if (update_arg( (void *)&(args_info->index_cache_dir_arg), 
+                 &(args_info->index_cache_dir_orig), &(args_info->index_cache_dir_given),
+                &(local_args_info.index_cache_dir_given), optarg, 0, 0, ARG_STRING,
+                check_ambiguity, override, 0, 0,
+                "index-cache-dir", '-',
+                additional_error))
+              goto failure;
+          
           }
           /* Print statistics related to counts of hit points.  */
           else if (strcmp (long_options[option_index].name, "print-counts") == 0)
@@ -66,6 +66,12 @@ struct gengetopt_args_info
   double max_rsd_volume_arg;	/**< @brief Take interior samples until the relative standard deviation of volume drops below this value.  Relative standard deviation is defined as (Standard_Deviation/Mean)*100%.  */
   char * max_rsd_volume_orig;	/**< @brief Take interior samples until the relative standard deviation of volume drops below this value.  Relative standard deviation is defined as (Standard_Deviation/Mean)*100% original value given at command line.  */
   const char *max_rsd_volume_help; /**< @brief Take interior samples until the relative standard deviation of volume drops below this value.  Relative standard deviation is defined as (Standard_Deviation/Mean)*100% help description.  */
+  double max_run_time_arg;	/**< @brief Stop walk-on-spheres walks and interior samples early if needed to finish within this many seconds of wall-clock time, and report the results and errors achieved so far.  Walks and samples are performed in rounds sized from their measured rate so that the run ends close to this time.  Combine with small max-rsd values to get the smallest errors achievable in the time.  */
+  char * max_run_time_orig;	/**< @brief Stop walk-on-spheres walks and interior samples early if needed to finish within this many seconds of wall-clock time, and report the results and errors achieved so far.  Walks and samples are performed in rounds sized from their measured rate so that the run ends close to this time.  Combine with small max-rsd values to get the smallest errors achievable in the time original value given at command line.  */
+  const char *max_run_time_help; /**< @brief Stop walk-on-spheres walks and interior samples early if needed to finish within this many seconds of wall-clock time, and report the results and errors achieved so far.  Walks and samples are performed in rounds sized from their measured rate so that the run ends close to this time.  Combine with small max-rsd values to get the smallest errors achievable in the time help description.  */
+  double exterior_run_time_fraction_arg;	/**< @brief Fraction of the maximum run time available to walk-on-spheres walks when interior samples are taken after them.  Time the walks leave unused is available to the interior samples (default='0.5').  */
+  char * exterior_run_time_fraction_orig;	/**< @brief Fraction of the maximum run time available to walk-on-spheres walks when interior samples are taken after them.  Time the walks leave unused is available to the interior samples original value given at command line.  */
+  const char *exterior_run_time_fraction_help; /**< @brief Fraction of the maximum run time available to walk-on-spheres walks when interior samples are taken after them.  Time the walks leave unused is available to the interior samples help description.  */
   #if defined(HAVE_LONG_LONG) || defined(HAVE_LONG_LONG_INT)
   long long int min_num_walks_arg;	/**< @brief Minimum number of walk-on-spheres walks to perform when using max-rsd stopping conditions (default=1000).  */
   #else
@@ -81,6 +87,17 @@ struct gengetopt_args_info
   char * min_num_interior_samples_orig;	/**< @brief Minimum number of interior samples to take when using max-rsd stopping conditions original value given at command line.  */
   const char *min_num_interior_samples_help; /**< @brief Minimum number of interior samples to take when using max-rsd stopping conditions help description.  */
   const char *compute_form_help; /**< @brief Compute form factor help description.  */
+  #if defined(HAVE_LONG_LONG) || defined(HAVE_LONG_LONG_INT)
+  long long int max_form_factor_points_arg;	/**< @brief Compute form factors from at most this many interior sample points hit, chosen uniformly at random from all of them, so memory does not grow with the number of samples.  The volume and gyration tensor still use every sample.  */
+  #else
+  long max_form_factor_points_arg;	/**< @brief Compute form factors from at most this many interior sample points hit, chosen uniformly at random from all of them, so memory does not grow with the number of samples.  The volume and gyration tensor still use every sample.  */
+  #endif
+  char * max_form_factor_points_orig;	/**< @brief Compute form factors from at most this many interior sample points hit, chosen uniformly at random from all of them, so memory does not grow with the number of samples.  The volume and gyration tensor still use every sample original value given at command line.  */
+  const char *max_form_factor_points_help; /**< @brief Compute form factors from at most this many interior sample points hit, chosen uniformly at random from all of them, so memory does not grow with the number of samples.  The volume and gyration tensor still use every sample help description.  */
+  double max_sd_form_factors_arg;	/**< @brief Estimate form factors from random pairs of interior sample points, rather than all pairs, taking pairs until the standard deviation of every form factor drops below this value.  Form factors are between -0.22 and 1.  All pairs are used if that would take fewer.  */
+  char * max_sd_form_factors_orig;	/**< @brief Estimate form factors from random pairs of interior sample points, rather than all pairs, taking pairs until the standard deviation of every form factor drops below this value.  Form factors are between -0.22 and 1.  All pairs are used if that would take fewer original value given at command line.  */
+  const char *max_sd_form_factors_help; /**< @brief Estimate form factors from random pairs of interior sample points, rather than all pairs, taking pairs until the standard deviation of every form factor drops below this value.  Form factors are between -0.22 and 1.  All pairs are used if that would take fewer help description.  */
+  const char *histogram_form_factors_help; /**< @brief Compute form factors from a fine histogram of the distances between pairs of interior sample points, rather than evaluating the Debye formula for every pair.  The bin width is chosen to keep the binning error well below the sampling error of the form factors help description.  */
   int num_threads_arg;	/**< @brief Number of threads to use  (default=Number of logical cores).  */
   char * num_threads_orig;	/**< @brief Number of threads to use  (default=Number of logical cores) original value given at command line.  */
   const char *num_threads_help; /**< @brief Number of threads to use  (default=Number of logical cores) help description.  */
@@ -90,12 +107,28 @@ struct gengetopt_args_info
   double frac_error_bound_arg;	/**< @brief Fractional error bound for nearest neighbor search (default='0').  */
   char * frac_error_bound_orig;	/**< @brief Fractional error bound for nearest neighbor search original value given at command line.  */
   const char *frac_error_bound_help; /**< @brief Fractional error bound for nearest neighbor search help description.  */
+  int distance_grid_size_arg;	/**< @brief Number of cells along each side of a grid of precomputed lower bounds on the distance to the object, used to take large walk-on-spheres steps far from the surface  (default=No grid).  */
+  char * distance_grid_size_orig;	/**< @brief Number of cells along each side of a grid of precomputed lower bounds on the distance to the object, used to take large walk-on-spheres steps far from the surface  (default=No grid) original value given at command line.  */
+  const char *distance_grid_size_help; /**< @brief Number of cells along each side of a grid of precomputed lower bounds on the distance to the object, used to take large walk-on-spheres steps far from the surface  (default=No grid) help description.  */
+  const char *prune_buried_spheres_help; /**< @brief Leave spheres whose surface is entirely inside other spheres out of the data structure used for walk-on-spheres help description.  */
+  const char *minimal_launch_sphere_help; /**< @brief Launch walk-on-spheres walks and take interior samples from a nearly minimal sphere enclosing the object, rather than the sphere enclosing its axis-aligned bounding box help description.  */
+  const char *concurrent_interior_sampling_help; /**< @brief Take interior samples at the same time as walk-on-spheres walks, on the same threads.  Each keeps its own stopping condition.  The time for both is reported as exterior walk time help description.  */
+  const char *expected_charges_help; /**< @brief Record the expected charge of each walk that hits the object, computed from its launch point, rather than a randomly assigned charge.  Reduces the variance of the polarizability help description.  */
+  const char *compensated_sums_help; /**< @brief Accumulate counts and compensated sums and sums of squares of walk and sample results, computing variances only when results are combined, rather than updating running variances after every walk and sample.  Misses only increment a count help description.  */
+  const char *union_interior_sampling_help; /**< @brief Take interior samples uniformly inside spheres of the object chosen at random in proportion to their volume, weighting each sample by the inverse of the number of spheres containing it, rather than inside the launch sphere.  Converges much faster for objects that fill little of their launch sphere help description.  */
+  int deterministic_blocks_arg;	/**< @brief Divide walk-on-spheres walks and interior samples into this many blocks, each with its own random number stream, and combine the results of the blocks in a fixed order, so that results for a given seed are identical for any number of threads or MPI processes  (default=Not deterministic).  */
+  char * deterministic_blocks_orig;	/**< @brief Divide walk-on-spheres walks and interior samples into this many blocks, each with its own random number stream, and combine the results of the blocks in a fixed order, so that results for a given seed are identical for any number of threads or MPI processes  (default=Not deterministic) original value given at command line.  */
+  const char *deterministic_blocks_help; /**< @brief Divide walk-on-spheres walks and interior samples into this many blocks, each with its own random number stream, and combine the results of the blocks in a fixed order, so that results for a given seed are identical for any number of threads or MPI processes  (default=Not deterministic) help description.  */
   char * surface_points_file_arg;	/**< @brief Name of file for writing the surface points from Walk-on-Spheres.  */
   char * surface_points_file_orig;	/**< @brief Name of file for writing the surface points from Walk-on-Spheres original value given at command line.  */
   const char *surface_points_file_help; /**< @brief Name of file for writing the surface points from Walk-on-Spheres help description.  */
   char * interior_points_file_arg;	/**< @brief Name of file for writing the interior sample points.  */
   char * interior_points_file_orig;	/**< @brief Name of file for writing the interior sample points original value given at command line.  */
   const char *interior_points_file_help; /**< @brief Name of file for writing the interior sample points help description.  */
+  const char *stream_points_files_help; /**< @brief Write the surface and interior points files in a binary format while walks and samples are performed, from small per-thread buffers, rather than keeping every point in memory and writing text at the end.  Files whose names end in .gz are compressed.  With MPI each process writes its own file, named with its rank.  Convert the files to text with zeno-points-to-text help description.  */
+  char * index_cache_dir_arg;	/**< @brief Directory in which to cache the parsed input file and spatial data structure, so later runs with the same input file and error bound can skip parsing and preprocessing.  */
+  char * index_cache_dir_orig;	/**< @brief Directory in which to cache the parsed input file and spatial data structure, so later runs with the same input file and error bound can skip parsing and preprocessing original value given at command line.  */
+  const char *index_cache_dir_help; /**< @brief Directory in which to cache the parsed input file and spatial data structure, so later runs with the same input file and error bound can skip parsing and preprocessing help description.  */
   const char *print_counts_help; /**< @brief Print statistics related to counts of hit points help description.  */
   const char *print_benchmarks_help; /**< @brief Print detailed RAM and timing information help description.  */
   
@@ -108,14 +141,29 @@ struct gengetopt_args_info
   unsigned int max_rsd_capacitance_given ;	/**< @brief Whether max-rsd-capacitance was given.  */
   unsigned int max_rsd_polarizability_given ;	/**< @brief Whether max-rsd-polarizability was given.  */
   unsigned int max_rsd_volume_given ;	/**< @brief Whether max-rsd-volume was given.  */
+  unsigned int max_run_time_given ;	/**< @brief Whether max-run-time was given.  */
+  unsigned int exterior_run_time_fraction_given ;	/**< @brief Whether exterior-run-time-fraction was given.  */
   unsigned int min_num_walks_given ;	/**< @brief Whether min-num-walks was given.  */
   unsigned int min_num_interior_samples_given ;	/**< @brief Whether min-num-interior-samples was given.  */
   unsigned int compute_form_given ;	/**< @brief Whether compute-form was given.  */
+  unsigned int max_form_factor_points_given ;	/**< @brief Whether max-form-factor-points was given.  */
+  unsigned int max_sd_form_factors_given ;	/**< @brief Whether max-sd-form-factors was given.  */
+  unsigned int histogram_form_factors_given ;	/**< @brief Whether histogram-form-factors was given.  */
   unsigned int num_threads_given ;	/**< @brief Whether num-threads was given.  */
   unsigned int seed_given ;	/**< @brief Whether seed was given.  */
   unsigned int frac_error_bound_given ;	/**< @brief Whether frac-error-bound was given.  */
+  unsigned int distance_grid_size_given ;	/**< @brief Whether distance-grid-size was given.  */
+  unsigned int prune_buried_spheres_given ;	/**< @brief Whether prune-buried-spheres was given.  */
+  unsigned int minimal_launch_sphere_given ;	/**< @brief Whether minimal-launch-sphere was given.  */
+  unsigned int concurrent_interior_sampling_given ;	/**< @brief Whether concurrent-interior-sampling was given.  */
+  unsigned int expected_charges_given ;	/**< @brief Whether expected-charges was given.  */
+  unsigned int compensated_sums_given ;	/**< @brief Whether compensated-sums was given.  */
+  unsigned int union_interior_sampling_given ;	/**< @brief Whether union-interior-sampling was given.  */
+  unsigned int deterministic_blocks_given ;	/**< @brief Whether deterministic-blocks was given.  */
   unsigned int surface_points_file_given ;	/**< @brief Whether surface-points-file was given.  */
   unsigned int interior_points_file_given ;	/**< @brief Whether interior-points-file was given.  */
+  unsigned int stream_points_files_given ;	/**< @brief Whether stream-points-files was given.  */
+  unsigned int index_cache_dir_given ;	/**< @brief Whether index-cache-dir was given.  */
   unsigned int print_counts_given ;	/**< @brief Whether print-counts was given.  */
   unsigned int print_benchmarks_given ;	/**< @brief Whether print-benchmarks was given.  */
 